@@ -0,0 +1,262 @@
+/* Exception.bench.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/Exception.hpp"
+#include "IOCore/sys/debuginfo.hpp"
+#include "IOCore/sys/symbol_cache.hpp"
+#include "IOCore/sys/throw_sites.hpp"
+
+#if defined(ELF_STACKTRACER)
+#include "IOCore/sys/elf_symbolizer.hpp"
+#endif
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <stdexcept>
+#include <string>
+
+using IOCore::Exception;
+using IOCore::StackCapture;
+
+namespace {
+// The stack trace backend this binary was configured with; part of every
+// benchmark name so results from differently configured builds can be
+// told apart in the JSON output.
+#if defined(HAVE_FRAME_POINTERS)
+constexpr auto kCaptureBackend = "frame-pointers";
+#elif defined(HAVE_EXECINFO_H)
+constexpr auto kCaptureBackend = "execinfo";
+#elif defined(BOOST_STACKTRACER)
+constexpr auto kCaptureBackend = "boost";
+#else
+constexpr auto kCaptureBackend = "none";
+#endif
+
+#if defined(ELF_STACKTRACER)
+constexpr auto kSymbolizerBackend = "elf";
+#elif defined(BOOST_STACKTRACER)
+constexpr auto kSymbolizerBackend = "boost";
+#elif defined(HAVE_EXECINFO_H)
+constexpr auto kSymbolizerBackend = "execinfo";
+#else
+constexpr auto kSymbolizerBackend = "none";
+#endif
+
+auto name(const std::string& benchmark) -> std::string
+{
+	return benchmark + " [" + kCaptureBackend + "/" + kSymbolizerBackend +
+	       "]";
+}
+
+/// Forgets everything symbolization has cached: resolved frames, the
+/// canonical trace of each throw site and, for the ELF backend, its
+/// mapped objects and line tables
+void reset_symbolization_caches()
+{
+	IOCore::SymbolCache::global().clear();
+	IOCore::ThrowSiteRegistry::global().clear();
+#if defined(ELF_STACKTRACER)
+	IOCore::ElfSymbolizer::global().clear();
+#endif
+}
+
+/// Restores the default capture policy when a test case ends
+struct ScopedCaptureMode {
+	explicit ScopedCaptureMode(StackCapture mode, unsigned rate = 100)
+	{
+		Exception::setStackCapture(mode, rate);
+	}
+	~ScopedCaptureMode()
+	{
+		Exception::setStackCapture(StackCapture::Symbolized);
+	}
+};
+
+// Each level adds one real frame for the unwinder and the stack walker
+[[gnu::noinline]] void throw_at_depth(int depth)
+{
+	if (depth <= 1) {
+		throw Exception("benchmark");
+	}
+	throw_at_depth(depth - 1);
+	asm volatile("" ::: "memory"); // keep the call out of tail position
+}
+
+[[gnu::noinline]] void throw_wrapped(int layers)
+{
+	if (layers <= 0) {
+		throw std::runtime_error("inner");
+	}
+	try {
+		throw_wrapped(layers - 1);
+	} catch (const std::exception& inner) {
+		throw Exception(inner);
+	}
+}
+
+[[gnu::noinline]] auto stacktrace_at_depth(int depth) -> std::string
+{
+	if (depth <= 1) {
+		return IOCore::generate_stacktrace();
+	}
+	auto result = stacktrace_at_depth(depth - 1);
+	asm volatile("" ::: "memory");
+	return result;
+}
+
+template<typename TCallable>
+auto catch_exception(TCallable&& callable) -> std::size_t
+{
+	try {
+		callable();
+	} catch (const Exception& exception) {
+		return exception.stacktrace().size();
+	}
+	return 0;
+}
+
+template<typename TCallable>
+auto catch_what(TCallable&& callable) -> std::size_t
+{
+	try {
+		callable();
+	} catch (const Exception& exception) {
+		return std::char_traits<char>::length(exception.what());
+	}
+	return 0;
+}
+
+constexpr int kDepths[] = { 1, 8, 32, 64 };
+} // namespace
+
+TEST_CASE("throw + catch by stack depth and capture mode", "[exception]")
+{
+	struct Mode {
+		const char* label;
+		StackCapture mode;
+	};
+	constexpr Mode kModes[] = {
+		{ "none", StackCapture::None },
+		{ "raw", StackCapture::RawAddresses },
+		{ "symbolized", StackCapture::Symbolized },
+		{ "sampled", StackCapture::Sampled },
+	};
+
+	for (const auto& mode : kModes) {
+		ScopedCaptureMode policy(mode.mode);
+
+		for (int depth : kDepths) {
+			BENCHMARK(name(
+			    "throw+catch depth=" + std::to_string(depth) +
+			    " capture=" + mode.label
+			))
+			{
+				return catch_exception([depth] {
+					throw_at_depth(depth);
+				});
+			};
+		}
+	}
+}
+
+TEST_CASE("throw + catch + what() with cold and warm caches", "[exception]")
+{
+	ScopedCaptureMode policy(StackCapture::Symbolized);
+
+	for (int depth : kDepths) {
+		auto label = " depth=" + std::to_string(depth);
+
+		// Every run pays for loading the symbol tables and symbolizing;
+		// the resets are timed too, but cost far less than what they
+		// expose.
+		BENCHMARK(name("throw+catch+what() cold" + label))
+		{
+			reset_symbolization_caches();
+			return catch_what([depth] { throw_at_depth(depth); });
+		};
+
+		BENCHMARK(name("throw+catch+what() warm" + label))
+		{
+			return catch_what([depth] { throw_at_depth(depth); });
+		};
+	}
+}
+
+TEST_CASE("nested Exception(const std::exception&) wrapping", "[exception]")
+{
+	ScopedCaptureMode policy(StackCapture::Symbolized);
+
+	for (int layers : { 1, 2, 4, 8 }) {
+		BENCHMARK(name("wrap layers=" + std::to_string(layers)))
+		{
+			return catch_exception([layers] { throw_wrapped(layers); });
+		};
+
+		BENCHMARK(name("wrap+what() layers=" + std::to_string(layers)))
+		{
+			return catch_what([layers] { throw_wrapped(layers); });
+		};
+	}
+}
+
+TEST_CASE("ASSERT and ASSERT_MSG", "[assert]")
+{
+	ScopedCaptureMode policy(StackCapture::Symbolized);
+	volatile int value = 1;
+
+	BENCHMARK(name("ASSERT passing"))
+	{
+		ASSERT(value == 1);
+		return value;
+	};
+
+	BENCHMARK(name("ASSERT failing"))
+	{
+		return catch_exception([&value] { ASSERT(value == 0); });
+	};
+
+	BENCHMARK(name("ASSERT_MSG failing"))
+	{
+		return catch_exception([&value] {
+			ASSERT_MSG(value == 0, "value must be zero");
+		});
+	};
+}
+
+TEST_CASE("stack capture and generate_stacktrace", "[stacktrace]")
+{
+	BENCHMARK(name("capture_stackframes"))
+	{
+		return IOCore::capture_stackframes().count;
+	};
+
+	BENCHMARK(name("capture_stackframes_fp"))
+	{
+		return IOCore::capture_stackframes_fp().count;
+	};
+
+	for (int depth : kDepths) {
+		auto label = " depth=" + std::to_string(depth);
+
+		BENCHMARK(name("generate_stacktrace cold" + label))
+		{
+			reset_symbolization_caches();
+			return stacktrace_at_depth(depth);
+		};
+
+		BENCHMARK(name("generate_stacktrace warm" + label))
+		{
+			return stacktrace_at_depth(depth);
+		};
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,215 @@
+/* TimerWheel.bench.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/TimerWheel.hpp"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using IOCore::Timer;
+using IOCore::TimerWheel;
+
+namespace {
+using Clock = TimerWheel::Clock;
+
+const auto kStart = Clock::time_point{} + std::chrono::hours{ 1 };
+constexpr std::size_t kCounts[] = { 1000, 100000, 1000000 };
+// Deadlines spread over 10 s of 1 ms ticks, like per-request timeouts
+constexpr std::int64_t kHorizonTicks = 10000;
+
+auto make_deadlines(std::size_t count) -> std::vector<std::int64_t>
+{
+	std::mt19937_64 random(count);
+	std::uniform_int_distribution<std::int64_t> tick(1, kHorizonTicks);
+	std::vector<std::int64_t> deadlines(count);
+	for (auto& deadline : deadlines) {
+		deadline = tick(random);
+	}
+	return deadlines;
+}
+
+/// The usual baseline: a binary heap of (deadline, id), where cancelling
+/// bumps a generation and stale entries are skipped when popped
+class HeapTimers {
+    public:
+	explicit HeapTimers(std::size_t count) : generations(count, 0)
+	{
+		std::vector<Entry> storage;
+		storage.reserve(count);
+		heap = Heap(std::greater<>(), std::move(storage));
+	}
+
+	void schedule(std::size_t id, std::int64_t deadline)
+	{
+		heap.push(Entry{ deadline, id, ++generations[id] });
+	}
+
+	void cancel(std::size_t id) { ++generations[id]; }
+
+	auto advance(std::int64_t now) -> std::size_t
+	{
+		std::size_t fired = 0;
+		while (!heap.empty() && heap.top().deadline <= now) {
+			auto entry = heap.top();
+			heap.pop();
+			if (entry.generation == generations[entry.id]) {
+				++fired;
+			}
+		}
+		return fired;
+	}
+
+	[[nodiscard]] auto empty() const -> bool { return heap.empty(); }
+
+    private:
+	struct Entry {
+		std::int64_t deadline;
+		std::size_t id;
+		std::uint32_t generation;
+
+		auto operator>(const Entry& other) const -> bool
+		{
+			return deadline > other.deadline;
+		}
+	};
+	using Heap =
+	    std::priority_queue<Entry, std::vector<Entry>, std::greater<>>;
+
+	Heap heap;
+	std::vector<std::uint32_t> generations;
+};
+} // namespace
+
+TEST_CASE("schedule then cancel every timer", "[timers]")
+{
+	for (auto count : kCounts) {
+		auto deadlines = make_deadlines(count);
+		std::vector<Timer> timers(count);
+		auto label = " timers=" + std::to_string(count);
+
+		BENCHMARK("wheel schedule+cancel" + label)
+		{
+			TimerWheel wheel(std::chrono::milliseconds{ 1 }, kStart);
+			for (std::size_t index = 0; index < count; ++index) {
+				wheel.schedule(
+				    timers[index],
+				    std::chrono::milliseconds{ deadlines[index] }
+				);
+			}
+			for (auto& timer : timers) {
+				wheel.cancel(timer);
+			}
+			return wheel.size();
+		};
+
+		BENCHMARK("priority_queue schedule+cancel" + label)
+		{
+			HeapTimers heap(count);
+			for (std::size_t index = 0; index < count; ++index) {
+				heap.schedule(index, deadlines[index]);
+			}
+			for (std::size_t index = 0; index < count; ++index) {
+				heap.cancel(index);
+			}
+			// Stale entries still have to be popped eventually
+			return heap.advance(kHorizonTicks);
+		};
+	}
+}
+
+TEST_CASE("schedule then expire every timer tick by tick", "[timers]")
+{
+	for (auto count : kCounts) {
+		auto deadlines = make_deadlines(count);
+		std::vector<Timer> timers(count);
+		auto label = " timers=" + std::to_string(count);
+
+		BENCHMARK("wheel schedule+expire" + label)
+		{
+			TimerWheel wheel(std::chrono::milliseconds{ 1 }, kStart);
+			for (std::size_t index = 0; index < count; ++index) {
+				wheel.schedule(
+				    timers[index],
+				    std::chrono::milliseconds{ deadlines[index] }
+				);
+			}
+			std::size_t fired = 0;
+			for (std::int64_t tick = 1; tick <= kHorizonTicks; ++tick) {
+				fired += wheel.advance(
+				    kStart + std::chrono::milliseconds{ tick },
+				    [](Timer&) {}
+				);
+			}
+			return fired;
+		};
+
+		BENCHMARK("priority_queue schedule+expire" + label)
+		{
+			HeapTimers heap(count);
+			for (std::size_t index = 0; index < count; ++index) {
+				heap.schedule(index, deadlines[index]);
+			}
+			std::size_t fired = 0;
+			for (std::int64_t tick = 1; tick <= kHorizonTicks; ++tick) {
+				fired += heap.advance(tick);
+			}
+			return fired;
+		};
+	}
+}
+
+TEST_CASE("re-arm a live timer (keep-alive refresh)", "[timers]")
+{
+	for (auto count : kCounts) {
+		auto deadlines = make_deadlines(count);
+		std::vector<Timer> timers(count);
+		auto label = " timers=" + std::to_string(count);
+
+		TimerWheel wheel(std::chrono::milliseconds{ 1 }, kStart);
+		HeapTimers heap(count);
+		for (std::size_t index = 0; index < count; ++index) {
+			wheel.schedule(
+			    timers[index],
+			    std::chrono::milliseconds{ deadlines[index] }
+			);
+			heap.schedule(index, deadlines[index]);
+		}
+
+		std::size_t next = 0;
+		BENCHMARK("wheel re-arm" + label)
+		{
+			auto index = next++ % count;
+			wheel.schedule(
+			    timers[index],
+			    std::chrono::milliseconds{ deadlines[index] }
+			);
+			return wheel.size();
+		};
+
+		// The heap grows by one stale entry per refresh
+		BENCHMARK("priority_queue re-arm" + label)
+		{
+			auto index = next++ % count;
+			heap.schedule(index, deadlines[index]);
+			return heap.empty();
+		};
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
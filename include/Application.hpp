@@ -10,13 +10,26 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <format>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <fmt/core.h>
 
 #include "Exception.hpp"
+#include "Executor.hpp"
+#include "IoEngine.hpp"
+#include "Reactor.hpp"
+#include "Scheduler.hpp"
+#include "Subsystems.hpp"
 
 #include "types.hpp"
 
@@ -24,26 +37,173 @@ namespace IOCore {
 
 struct DoubleConstructionException;
 
+/// \brief Where Application keeps the strings of argv and envp.
+enum class ArgumentStorage {
+	/// Copy every string into one contiguous allocation owned by the
+	/// Application; safe even if the caller later modifies the originals.
+	Arena,
+	/// Keep pointing at the caller's argv/envp, which must outlive the
+	/// Application (true for the arrays passed to main()).
+	InPlace
+};
+
 class Application // NOLINT(readability-identifier-naming)
 {
     public:
+	/// Bits of the lifecycle state word; the reload generation occupies
+	/// the bits from kReloadIncrement up
+	enum LifecycleFlags : std::uint32_t {
+		ShutdownRequested = 1U << 0,
+		Draining = 1U << 1,
+	};
+	static constexpr std::uint32_t kReloadIncrement = 1U << 8;
+	static constexpr std::chrono::milliseconds kDefaultDrainTimeout{ 5000 };
+
+	/// \brief Tears down the I/O engine, executor, scheduler and reactor,
+	/// calling shutdown() first if nothing has drained yet.
+	///
+	/// By then a subclass's members are gone, so tasks still using them
+	/// must have finished: subclasses that never return through
+	/// Application::run() should call shutdown() in their own destructor.
 	virtual ~Application();
 
-	virtual auto run() -> int = 0;
+	/// \brief The application's main loop.
+	///
+	/// By default this runs getReactor() until Reactor::stop() is called,
+	/// then calls shutdown() and returns the loop's exit code; daemons
+	/// register their sources first and call Application::run() at the
+	/// end of their own override.
+	virtual auto run() -> int;
 
+	/// \brief The arguments as owning strings, built on first use.
 	[[nodiscard]] virtual auto getArguments() const
-	    -> const std::vector<std::string>&
+	    -> const std::vector<std::string>&;
+
+	/// \brief The environment as an owning dictionary, built on first
+	/// use. Prefer getEnv() for lookups.
+	[[nodiscard]] virtual auto getEnvironment() const
+	    -> const Dictionary<const std::string>&;
+
+	[[nodiscard]] auto getArgumentCount() const noexcept -> std::size_t
 	{
-		return this->arguments;
+		return this->argument_list.size();
 	}
-	[[nodiscard]] virtual auto getEnvironment() const
-	    -> const Dictionary<const std::string>&
+
+	/// \brief Argument \p index, or an empty view if out of range.
+	[[nodiscard]] auto getArgument(std::size_t index) const noexcept
+	    -> std::string_view;
+
+	/// \brief The value of environment variable \p name.
+	///
+	/// The first lookup builds a sorted index over envp; lookups never
+	/// allocate. As with getenv(), the first of duplicate names wins.
+	[[nodiscard]] auto getEnv(std::string_view name) const
+	    -> std::optional<std::string_view>;
+
+	/// \brief The application's shared thread pool, started on first use
+	/// and shut down (after finishing queued work) with the Application.
+	auto getExecutor() -> Executor&;
+
+	/// \brief The application's event loop, created on first use.
+	auto getReactor() -> Reactor&;
+
+	/// \brief Resumes coroutines on getExecutor() and, on Linux, on
+	/// getReactor(); created on first use, from the loop thread.
+	auto getScheduler() -> Scheduler&;
+
+	/// \brief Asynchronous file I/O: io_uring where available, else
+	/// getExecutor(). On Linux its completions run on getReactor();
+	/// created on first use, from the loop thread.
+	auto getIoEngine() -> IoEngine&;
+
+	/// \brief Where subclasses register their subsystems (configs,
+	/// caches, pools) together with the subsystems each one needs.
+	auto getSubsystems() noexcept -> SubsystemGraph&
+	{
+		return this->subsystems;
+	}
+
+	/// \brief Initializes every registered subsystem on getExecutor(),
+	/// independent ones concurrently.
+	/// \throws SubsystemException, see SubsystemGraph::initialize()
+	void initializeSubsystems();
+
+	/// \brief Turns SIGTERM and SIGINT into requestShutdown() and SIGHUP
+	/// into requestReload() followed by onReload().
+	///
+	/// On Linux the signals are blocked and read through signalfd by
+	/// getReactor(), so this must run on the main thread before
+	/// getExecutor() starts the workers (they inherit the signal mask);
+	/// it throws IOCore::Exception otherwise. Elsewhere a plain signal
+	/// handler updates the state word and onReload() is not called.
+	void handleSignals();
+
+	/// \brief Publishes a shutdown request and stops the reactor so run()
+	/// returns \p exit_code. Only the first request counts. Lock-free and
+	/// async-signal-safe.
+	void requestShutdown(int exit_code = 0) noexcept;
+
+	/// \brief Bumps the reload generation. Lock-free and
+	/// async-signal-safe.
+	void requestReload() noexcept
+	{
+		this->lifecycle_state.fetch_add(
+		    kReloadIncrement, std::memory_order_release
+		);
+	}
+
+	/// \brief The lifecycle state word; a single atomic load, cheap enough
+	/// for workers to poll between units of work.
+	[[nodiscard]] auto lifecycleState() const noexcept -> std::uint32_t
+	{
+		return this->lifecycle_state.load(std::memory_order_acquire);
+	}
+
+	[[nodiscard]] auto shutdownRequested() const noexcept -> bool
+	{
+		return (lifecycleState() & ShutdownRequested) != 0;
+	}
+
+	/// \brief Changes whenever a reload is requested; workers compare it
+	/// with the generation they last acted on.
+	[[nodiscard]] auto reloadGeneration() const noexcept -> std::uint32_t
+	{
+		return lifecycleState() / kReloadIncrement;
+	}
+
+	/// \brief How long drain() waits for queued work.
+	void setDrainTimeout(std::chrono::milliseconds timeout) noexcept
+	{
+		this->drain_timeout = timeout;
+	}
+	[[nodiscard]] auto getDrainTimeout() const noexcept
+	    -> std::chrono::milliseconds
 	{
-		return this->environment_variables;
+		return this->drain_timeout;
 	}
 
+	/// \brief Sets the Draining flag and lets the executor finish queued
+	/// and running work for up to getDrainTimeout(). Work still queued
+	/// after that is dropped.
+	/// \returns true if everything finished in time
+	auto drain() -> bool;
+
+	/// \brief Drains the executor and writes any pending startup trace,
+	/// while the subclass's members its tasks may use are still alive.
+	/// \throws what drain() throws: the first error of a task
+	void shutdown();
+
     protected:
-	Application(int argc, c::const_string argv[], c::const_string env[]);
+	/// \brief Runs on the loop thread after SIGHUP, once handleSignals()
+	/// has been called. Does nothing by default.
+	virtual void onReload() {}
+
+	Application(
+	    int argc,
+	    c::const_string argv[],
+	    c::const_string env[],
+	    ArgumentStorage storage = ArgumentStorage::Arena
+	);
 
 	/// @{
 	/// @name Disable copy and move operators / constructors
@@ -51,13 +211,53 @@ class Application // NOLINT(readability-identifier-naming)
 	auto operator=(const Application&) -> Application& = delete;
 	/// @}
 
+    private:
+	struct EnvEntry {
+		std::string_view name;
+		std::string_view value;
+	};
+
+	void pack_into_arena(
+	    c::count_t argc, c::const_string argv[], c::const_string envp[]
+	);
+	void build_env_index() const;
 	void read_arguments(int argc, c::const_string argv[]);
 	void create_env_dictionary(c::const_string envp[]);
 
-	std::vector<std::string> arguments;
-	Dictionary<const std::string> environment_variables;
+	// Filled on the first getArguments() / getEnvironment() call, so
+	// subclasses go through those accessors
+	mutable std::vector<std::string> arguments;
+	mutable Dictionary<const std::string> environment_variables;
+
+	std::unique_ptr<char[]> argument_arena;
+	std::span<c::const_string> argument_list;
+	std::span<c::const_string> environment_list;
+
+	mutable std::once_flag arguments_copied;
+	mutable std::once_flag environment_copied;
+	mutable std::once_flag env_index_built;
+	mutable std::vector<EnvEntry> env_index;
+
+	std::once_flag executor_started;
+	std::unique_ptr<Executor> executor;
+
+	std::once_flag reactor_created;
+	std::unique_ptr<Reactor> reactor;
+	// Published for requestShutdown(), which may run on any thread
+	std::atomic<Reactor*> active_reactor{ nullptr };
+
+	SubsystemGraph subsystems;
+
+	std::once_flag scheduler_created;
+	std::unique_ptr<Scheduler> scheduler;
+
+	std::once_flag io_engine_created;
+	std::unique_ptr<IoEngine> io_engine;
+
+	static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+	std::atomic<std::uint32_t> lifecycle_state{ 0 };
+	std::chrono::milliseconds drain_timeout = kDefaultDrainTimeout;
 
-    private:
 	static std::atomic_bool is_initialized;
 };
 
@@ -0,0 +1,111 @@
+/* Assert.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <source_location>
+#include <string_view>
+#include <utility>
+
+#include <fmt/format.h>
+
+/// \name Assertion levels
+/// IOCORE_ASSERT_LEVEL selects which assertions are compiled in (CMake
+/// option IOCORE_ASSERT_LEVEL). It defaults to Debug, or Critical when
+/// NDEBUG is defined.
+/// @{
+#define IOCORE_ASSERT_LEVEL_OFF 0      ///< no assertions are checked
+#define IOCORE_ASSERT_LEVEL_CRITICAL 1 ///< only IOCORE_VERIFY and ASSERT
+#define IOCORE_ASSERT_LEVEL_DEBUG 2    ///< IOCORE_ASSERT as well
+/// @}
+
+#ifndef IOCORE_ASSERT_LEVEL
+#ifdef NDEBUG
+#define IOCORE_ASSERT_LEVEL IOCORE_ASSERT_LEVEL_CRITICAL
+#else
+#define IOCORE_ASSERT_LEVEL IOCORE_ASSERT_LEVEL_DEBUG
+#endif
+#endif
+
+// The passing case is a single compare-and-branch: the source location and
+// any message arguments are only evaluated inside the failure branch, which
+// calls an out-of-line, cold, noreturn function.
+#define IOCORE_ASSERT_CHECK(condition, ...)                                     \
+	do {                                                                    \
+		if (!static_cast<bool>(condition)) [[unlikely]] {               \
+			IOCore::assert_detail::fail(                            \
+			    #condition,                                         \
+			    std::source_location::current()                     \
+			    __VA_OPT__(, ) __VA_ARGS__                          \
+			);                                                      \
+		}                                                               \
+	} while (false)
+
+// Keeps the condition type-checked, but never evaluates it
+#define IOCORE_ASSERT_DISCARD(condition, ...)                                   \
+	static_cast<void>(sizeof(!static_cast<bool>(condition)))
+
+/// \brief Development-time check; compiled out below the Debug level.
+///
+/// Optional arguments are a fmt format string and its arguments:
+/// `IOCORE_ASSERT(index < size, "index {} out of range", index);`
+#if IOCORE_ASSERT_LEVEL >= IOCORE_ASSERT_LEVEL_DEBUG
+#define IOCORE_ASSERT(condition, ...)                                           \
+	IOCORE_ASSERT_CHECK(condition __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define IOCORE_ASSERT(condition, ...) IOCORE_ASSERT_DISCARD(condition)
+#endif
+
+/// \brief Check that stays in release builds; only removed when assertions
+/// are turned off entirely.
+#if IOCORE_ASSERT_LEVEL >= IOCORE_ASSERT_LEVEL_CRITICAL
+#define IOCORE_VERIFY(condition, ...)                                           \
+	IOCORE_ASSERT_CHECK(condition __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define IOCORE_VERIFY(condition, ...) IOCORE_ASSERT_DISCARD(condition)
+#endif
+
+#define ASSERT(condition) IOCORE_VERIFY(condition)
+#define ASSERT_MSG(condition, msg) IOCORE_VERIFY(condition, "{}", msg)
+
+namespace IOCore {
+
+/// \brief Throws IOCore::AssertionException for a failed check.
+[[noreturn, gnu::cold, gnu::noinline]] void assertion_failed(
+    std::string_view failed_condition,
+    std::string_view message,
+    const std::source_location& location
+);
+
+namespace assert_detail {
+[[noreturn, gnu::cold]] inline void
+fail(std::string_view failed_condition, const std::source_location& location)
+{
+	assertion_failed(failed_condition, {}, location);
+}
+
+template<typename... TArgs>
+[[noreturn, gnu::cold, gnu::noinline]] void
+fail(std::string_view failed_condition,
+     const std::source_location& location,
+     fmt::format_string<TArgs...> format,
+     TArgs&&... args)
+{
+	assertion_failed(
+	    failed_condition,
+	    fmt::format(format, std::forward<TArgs>(args)...),
+	    location
+	);
+}
+} // namespace assert_detail
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
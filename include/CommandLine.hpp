@@ -0,0 +1,622 @@
+/* CommandLine.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "Exception.hpp"
+#include "types.hpp"
+#include "util/macros.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <source_location>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace IOCore {
+
+struct CommandLineException : public Exception {
+	explicit CommandLineException(
+	    const std::string& message,
+	    std::source_location site = std::source_location::current()
+	)
+	    : Exception(message, capturePolicy<CommandLineException>(), site)
+	{
+	}
+	~CommandLineException() override = default;
+};
+
+/// \brief Declarative, typed command-line parsing.
+///
+/// A Schema binds option names to fields of a plain struct. It is meant to
+/// be a `constexpr` object, so the option-name lookup table (a perfect hash)
+/// is computed by the compiler:
+///
+/// \code
+/// struct Options {
+///	bool verbose = false;
+///	int jobs = 1;
+///	std::string_view input;
+/// };
+///
+/// constexpr auto kOptions = CommandLine::make_schema(
+///     CommandLine::flag<&Options::verbose>("verbose", 'v'),
+///     CommandLine::option<&Options::jobs>("jobs", 'j', "worker count"),
+///     CommandLine::positional<&Options::input>("input")
+/// );
+///
+/// Options options = kOptions.parse(application);
+/// \endcode
+///
+/// Accepted forms are `--name`, `--name=value`, `--name value`, `-n`,
+/// `-nvalue`, `-n value`, grouped short flags (`-abc`) and `--` to end
+/// option processing. Values are converted in place with std::from_chars;
+/// std::string_view fields point straight into the argument strings.
+namespace CommandLine {
+
+enum class OptionKind : std::uint8_t {
+	Flag,       ///< takes no value; sets a bool or increments an integer
+	Valued,     ///< takes one value
+	Positional, ///< bound by position, in declaration order
+	Subcommand  ///< a leading bare word, e.g. `tool build ...`
+};
+
+template<typename TOptions>
+struct Option {
+	std::string_view name;
+	char short_name = '\0';
+	OptionKind kind = OptionKind::Flag;
+	std::string_view help;
+
+	/// Converts \p text into the bound field; false if it is not valid
+	bool (*assign)(TOptions& options, std::string_view text) = nullptr;
+};
+
+[[noreturn]] void
+throw_command_line_error(std::string_view problem, std::string_view argument);
+
+namespace detail {
+template<typename TMember>
+struct member_pointer;
+
+template<typename TClass, typename TField>
+struct member_pointer<TField TClass::*> {
+	using class_type = TClass;
+	using field_type = TField;
+};
+
+template<auto TMember>
+using options_of = typename member_pointer<decltype(TMember)>::class_type;
+
+template<auto TMember>
+using field_of = typename member_pointer<decltype(TMember)>::field_type;
+
+template<typename TValue>
+struct is_optional : std::false_type {};
+
+template<typename TValue>
+struct is_optional<std::optional<TValue>> : std::true_type {};
+
+template<typename TValue>
+constexpr bool kUnsupportedField = false;
+
+template<typename TValue>
+auto convert(std::string_view text, TValue& output) -> bool
+{
+	if constexpr (std::is_same_v<TValue, std::string_view>) {
+		output = text;
+		return true;
+	} else if constexpr (std::is_same_v<TValue, std::string>) {
+		output.assign(text);
+		return true;
+	} else if constexpr (std::is_same_v<TValue, bool>) {
+		if (text == "true" || text == "1" || text == "yes") {
+			output = true;
+		} else if (text == "false" || text == "0" || text == "no") {
+			output = false;
+		} else {
+			return false;
+		}
+		return true;
+	} else if constexpr (is_optional<TValue>::value) {
+		typename TValue::value_type value{};
+		if (!convert(text, value)) {
+			return false;
+		}
+		output = std::move(value);
+		return true;
+	} else if constexpr (std::is_arithmetic_v<TValue>) {
+		const char* end = text.data() + text.size();
+		auto [last, error] = std::from_chars(text.data(), end, output);
+		return error == std::errc{} && last == end;
+	} else {
+		static_assert(
+		    kUnsupportedField<TValue>,
+		    "CommandLine fields must be arithmetic, bool, std::string, "
+		    "std::string_view or std::optional of those"
+		);
+	}
+}
+
+template<auto TMember>
+auto set_flag(options_of<TMember>& options, std::string_view /*text*/)
+    -> bool
+{
+	using field_type = field_of<TMember>;
+
+	if constexpr (std::is_same_v<field_type, bool>) {
+		options.*TMember = true;
+	} else if constexpr (std::is_integral_v<field_type>) {
+		++(options.*TMember); // -vvv
+	} else {
+		static_assert(
+		    kUnsupportedField<field_type>,
+		    "CommandLine flags must be bound to bool or integer fields"
+		);
+	}
+	return true;
+}
+
+template<auto TMember>
+auto set_value(options_of<TMember>& options, std::string_view text) -> bool
+{
+	return convert(text, options.*TMember);
+}
+
+template<auto TMember>
+auto set_subcommand(options_of<TMember>& options, std::string_view text)
+    -> bool
+{
+	if constexpr (std::is_same_v<field_of<TMember>, bool>) {
+		return set_flag<TMember>(options, text);
+	} else {
+		return set_value<TMember>(options, text);
+	}
+}
+
+/// FNV-1a with a seed and a final mix, so the low bits used for the table
+/// index depend on every character
+constexpr auto hash_name(std::string_view name, std::uint32_t seed) noexcept
+    -> std::uint32_t
+{
+	std::uint32_t hash = 2166136261U ^ (seed * 0x9E3779B9U);
+	for (char character : name) {
+		hash ^= static_cast<unsigned char>(character);
+		hash *= 16777619U;
+	}
+	return hash ^ (hash >> 15);
+}
+} // namespace detail
+
+template<typename TOptions, std::size_t TCount>
+class Schema {
+    public:
+	static_assert(TCount > 0, "a Schema needs at least one option");
+	static_assert(TCount < 255, "too many options for one Schema");
+
+	/// Quadratic in the option count (capped), which keeps the
+	/// compile-time seed search short
+	static constexpr std::size_t kSlotCount = std::bit_ceil(
+	    std::min<std::size_t>(std::max<std::size_t>(TCount * TCount, 8), 4096)
+	);
+
+	constexpr explicit Schema(
+	    const std::array<Option<TOptions>, TCount>& option_list
+	)
+	    : options(option_list)
+	{
+		build_index();
+	}
+
+	/// \brief Parses main()-style arguments; argv[0] is skipped.
+	auto parse(int argc, c::const_string argv[]) const -> TOptions
+	{
+		TOptions result{};
+		auto count = (argc > 1) ? static_cast<std::size_t>(argc) - 1 : 0;
+
+		parse_arguments(result, count, [argv](std::size_t index) {
+			return std::string_view(argv[index + 1]);
+		});
+		return result;
+	}
+
+	/// \brief Parses the arguments of an IOCore::Application (or anything
+	/// with the same accessors); the program name is skipped.
+	template<typename TApplication>
+	    requires requires(const TApplication& application) {
+		    application.getArgumentCount();
+		    application.getArgument(std::size_t{});
+	    }
+	auto parse(const TApplication& application) const -> TOptions
+	{
+		TOptions result{};
+		auto total = application.getArgumentCount();
+		auto count = (total > 1) ? total - 1 : 0;
+
+		parse_arguments(result, count, [&application](std::size_t index) {
+			return application.getArgument(index + 1);
+		});
+		return result;
+	}
+
+	/// \brief Parses \p arguments, all of which are treated as arguments.
+	void parseInto(
+	    TOptions& result, std::span<const std::string_view> arguments
+	) const
+	{
+		parse_arguments(
+		    result, arguments.size(), [arguments](std::size_t index) {
+			    return arguments[index];
+		    }
+		);
+	}
+
+	/// \brief The flag, valued option or subcommand called \p name.
+	[[nodiscard]] constexpr auto find(std::string_view name) const noexcept
+	    -> const Option<TOptions>*
+	{
+		auto slot = slots[detail::hash_name(name, seed) & (kSlotCount - 1)];
+		if (slot == kEmpty || options[slot].name != name) {
+			return nullptr;
+		}
+		return &options[slot];
+	}
+
+	/// \brief The option with the single-character name \p short_name.
+	[[nodiscard]] constexpr auto find(char short_name) const noexcept
+	    -> const Option<TOptions>*
+	{
+		auto index = static_cast<unsigned char>(short_name);
+		if (index >= short_slots.size() || short_slots[index] == kEmpty) {
+			return nullptr;
+		}
+		return &options[short_slots[index]];
+	}
+
+	[[nodiscard]] auto usage(std::string_view program) const -> std::string;
+
+    private:
+	static constexpr std::uint8_t kEmpty = 0xFF;
+	static constexpr std::uint32_t kMaxSeeds = 1U << 16;
+
+	static constexpr auto is_named(const Option<TOptions>& option) -> bool
+	{
+		return option.kind != OptionKind::Positional;
+	}
+
+	constexpr void build_index()
+	{
+		short_slots.fill(kEmpty);
+
+		for (std::size_t index = 0; index < TCount; ++index) {
+			auto short_name =
+			    static_cast<unsigned char>(options[index].short_name);
+			if (short_name == 0) {
+				continue;
+			}
+			if (short_name >= short_slots.size() ||
+			    short_slots[short_name] != kEmpty) {
+				throw CommandLineException(
+				    "Duplicate or non-ASCII short option name"
+				);
+			}
+			short_slots[short_name] = static_cast<std::uint8_t>(index);
+		}
+
+		for (std::size_t index = 0; index < TCount; ++index) {
+			for (std::size_t other = 0; other < index; ++other) {
+				if (is_named(options[index]) &&
+				    is_named(options[other]) &&
+				    options[index].name == options[other].name) {
+					throw CommandLineException(
+					    "Duplicate option name"
+					);
+				}
+			}
+		}
+
+		for (seed = 0; seed < kMaxSeeds; ++seed) {
+			if (try_seed()) {
+				return;
+			}
+		}
+		throw CommandLineException("No perfect hash for option names");
+	}
+
+	constexpr auto try_seed() -> bool
+	{
+		slots.fill(kEmpty);
+
+		for (std::size_t index = 0; index < TCount; ++index) {
+			if (!is_named(options[index])) {
+				continue;
+			}
+			auto& slot = slots
+			    [detail::hash_name(options[index].name, seed) &
+			     (kSlotCount - 1)];
+			if (slot != kEmpty) {
+				return false;
+			}
+			slot = static_cast<std::uint8_t>(index);
+		}
+		return true;
+	}
+
+	[[nodiscard]] auto positional_at(std::size_t position) const noexcept
+	    -> const Option<TOptions>*
+	{
+		for (const auto& option : options) {
+			if (option.kind == OptionKind::Positional &&
+			    position-- == 0) {
+				return &option;
+			}
+		}
+		return nullptr;
+	}
+
+	static void store(
+	    const Option<TOptions>& option,
+	    TOptions& result,
+	    std::string_view value,
+	    std::string_view argument
+	)
+	{
+		if (!option.assign(result, value)) {
+			throw_command_line_error("Invalid value", argument);
+		}
+	}
+
+	template<typename TArgumentAt>
+	void parse_arguments(
+	    TOptions& result, std::size_t count, TArgumentAt&& argument_at
+	) const
+	{
+		std::size_t next_positional = 0;
+		bool options_ended = false;
+		bool subcommand_seen = false;
+
+		// Valued options take the rest of their argument, or the next one
+		auto take_value = [&](std::string_view inline_value,
+				      std::string_view argument,
+				      std::size_t& index) {
+			if (!inline_value.empty()) {
+				return inline_value;
+			}
+			if (index + 1 >= count) {
+				throw_command_line_error(
+				    "Missing value for option", argument
+				);
+			}
+			return std::string_view(argument_at(++index));
+		};
+
+		for (std::size_t index = 0; index < count; ++index) {
+			std::string_view argument = argument_at(index);
+
+			if (options_ended || argument.size() < 2 ||
+			    argument[0] != '-') {
+				if (!subcommand_seen && next_positional == 0) {
+					const auto* command = find(argument);
+					if (command != nullptr &&
+					    command->kind ==
+						OptionKind::Subcommand) {
+						store(*command, result, argument, argument);
+						subcommand_seen = true;
+						continue;
+					}
+				}
+
+				const auto* positional =
+				    positional_at(next_positional++);
+				if (positional == nullptr) {
+					throw_command_line_error(
+					    "Unexpected argument", argument
+					);
+				}
+				store(*positional, result, argument, argument);
+			} else if (argument == "--") {
+				options_ended = true;
+			} else if (argument[1] == '-') {
+				auto text = argument.substr(2);
+				auto equals = text.find('=');
+				const auto* option = find(text.substr(0, equals));
+
+				if (option == nullptr ||
+				    option->kind == OptionKind::Subcommand) {
+					throw_command_line_error(
+					    "Unknown option", argument
+					);
+				}
+				if (option->kind == OptionKind::Flag) {
+					if (equals != text.npos) {
+						throw_command_line_error(
+						    "Option takes no value",
+						    argument
+						);
+					}
+					option->assign(result, {});
+					continue;
+				}
+
+				auto value = (equals != text.npos)
+				                 ? text.substr(equals + 1)
+				                 : take_value({}, argument, index);
+				store(*option, result, value, argument);
+			} else {
+				for (std::size_t pos = 1; pos < argument.size();
+				     ++pos) {
+					const auto* option = find(argument[pos]);
+					if (option == nullptr) {
+						throw_command_line_error(
+						    "Unknown option", argument
+						);
+					}
+					if (option->kind == OptionKind::Flag) {
+						option->assign(result, {});
+						continue;
+					}
+					store(*option,
+					      result,
+					      take_value(
+						  argument.substr(pos + 1),
+						  argument,
+						  index
+					      ),
+					      argument);
+					break;
+				}
+			}
+		}
+	}
+
+	std::array<Option<TOptions>, TCount> options;
+	std::array<std::uint8_t, kSlotCount> slots{};
+	std::array<std::uint8_t, 128> short_slots{};
+	std::uint32_t seed = 0;
+};
+
+template<typename TOptions, std::size_t TCount>
+auto Schema<TOptions, TCount>::usage(std::string_view program) const
+    -> std::string
+{
+	std::string text = "usage: ";
+	text.append(program);
+
+	for (const auto& option : options) {
+		if (option.kind == OptionKind::Subcommand) {
+			text.append(" <command>");
+			break;
+		}
+	}
+	text.append(" [options]");
+	for (const auto& option : options) {
+		if (option.kind == OptionKind::Positional) {
+			text.append(" <").append(option.name).append(">");
+		}
+	}
+	text.append("\n");
+
+	for (const auto& option : options) {
+		text.append("  ");
+		if (option.kind == OptionKind::Flag ||
+		    option.kind == OptionKind::Valued) {
+			if (option.short_name != '\0') {
+				text.append("-").append(1, option.short_name);
+				text.append(", ");
+			}
+			text.append("--");
+		}
+		text.append(option.name);
+		if (option.kind == OptionKind::Valued) {
+			text.append(" <value>");
+		}
+		if (!option.help.empty()) {
+			text.append("\t").append(option.help);
+		}
+		text.append("\n");
+	}
+	return text;
+}
+
+/// \brief An option without a value, bound to a bool (set) or an integer
+/// (incremented per occurrence).
+template<auto TMember>
+constexpr auto flag(
+    std::string_view name, char short_name = '\0', std::string_view help = {}
+) -> Option<detail::options_of<TMember>>
+{
+	return { name, short_name, OptionKind::Flag, help,
+		 &detail::set_flag<TMember> };
+}
+
+/// \brief An option that takes one value, converted to the field's type.
+template<auto TMember>
+constexpr auto option(
+    std::string_view name, char short_name = '\0', std::string_view help = {}
+) -> Option<detail::options_of<TMember>>
+{
+	return { name, short_name, OptionKind::Valued, help,
+		 &detail::set_value<TMember> };
+}
+
+/// \brief A bare argument, bound in declaration order.
+template<auto TMember>
+constexpr auto positional(std::string_view name, std::string_view help = {})
+    -> Option<detail::options_of<TMember>>
+{
+	return { name, '\0', OptionKind::Positional, help,
+		 &detail::set_value<TMember> };
+}
+
+/// \brief A leading bare word; a bool field is set, any other field
+/// receives the command name.
+template<auto TMember>
+constexpr auto subcommand(std::string_view name, std::string_view help = {})
+    -> Option<detail::options_of<TMember>>
+{
+	return { name, '\0', OptionKind::Subcommand, help,
+		 &detail::set_subcommand<TMember> };
+}
+
+/// \brief flag() for bool fields, option() for everything else.
+template<auto TMember>
+constexpr auto field(std::string_view name)
+    -> Option<detail::options_of<TMember>>
+{
+	if constexpr (std::is_same_v<detail::field_of<TMember>, bool>) {
+		return flag<TMember>(name);
+	} else {
+		return option<TMember>(name);
+	}
+}
+
+template<typename TOptions, std::size_t TCount>
+constexpr auto make_schema(const std::array<Option<TOptions>, TCount>& options)
+    -> Schema<TOptions, TCount>
+{
+	return Schema<TOptions, TCount>(options);
+}
+
+template<typename TOptions, typename... TMoreOptions>
+constexpr auto make_schema(Option<TOptions> first, TMoreOptions... rest)
+    -> Schema<TOptions, 1 + sizeof...(TMoreOptions)>
+{
+	return make_schema(std::array<Option<TOptions>, 1 + sizeof...(rest)>{
+	    first, rest... });
+}
+} // namespace CommandLine
+} // namespace IOCore
+
+#define IOCORE_CLI_FIELD(FIELD)                                                 \
+	IOCore::CommandLine::field<&TCliOptions::FIELD>(#FIELD),
+
+/// \brief A Schema with one long option per listed field, named after it;
+/// bool fields become flags.
+///
+/// `constexpr auto kOptions = IOCORE_CLI_OPTIONS(Options, verbose, jobs);`
+#define IOCORE_CLI_OPTIONS(OPTIONS_TYPE, ...)                                   \
+	[]() constexpr {                                                        \
+		using TCliOptions = OPTIONS_TYPE;                               \
+		return IOCore::CommandLine::make_schema(                        \
+		    std::to_array<IOCore::CommandLine::Option<TCliOptions>>(    \
+			{ FOREACH_PARAM(IOCORE_CLI_FIELD, __VA_ARGS__) }        \
+		    )                                                           \
+		);                                                              \
+	}()
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,102 @@
+/* ConfigSubscriptions.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "TomlTable.hpp"
+
+namespace IOCore {
+
+/// \brief The dotted paths of every key whose value differs between
+/// \p before and \p after: changed, added and removed keys alike.
+///
+/// Tables are compared key by key and only their differing leaves are
+/// reported; a key whose type changes (or a whole table that is added or
+/// removed) is reported once, at that key. Arrays are compared as single
+/// values. Paths are in key order, e.g. "server.limits.max_conn".
+auto diff_toml(const toml::table& before, const toml::table& after)
+    -> std::vector<std::string>;
+
+/// \brief Callbacks registered on dotted key paths, fired by the changes
+/// they can observe.
+///
+/// A subscriber on "server.limits" fires when anything under that table
+/// changes, as well as when "server" itself is replaced or removed; a
+/// subscriber on "" fires on any change. Subscribers are kept in a tree
+/// of path segments, so notify() costs time in proportion to the changed
+/// paths and the subscribers they reach, not to the size of the config.
+///
+/// Keys that themselves contain a '.' cannot be subscribed to separately.
+class ConfigSubscriptions {
+    public:
+	using Callback = std::function<void(const TomlTable&)>;
+	using SubscriptionId = std::uint64_t;
+
+	ConfigSubscriptions();
+	~ConfigSubscriptions();
+
+	ConfigSubscriptions(const ConfigSubscriptions&) = delete;
+	auto operator=(const ConfigSubscriptions&)
+	    -> ConfigSubscriptions& = delete;
+
+	auto subscribe(std::string_view path, Callback callback)
+	    -> SubscriptionId;
+
+	/// \brief Does nothing for an unknown \p id; safe to call from a
+	/// callback.
+	void unsubscribe(SubscriptionId id);
+
+	/// \brief Calls, once each and in subscription order, every
+	/// subscriber that \p changed_paths reach, passing \p config.
+	/// Callbacks run without any lock held. A throwing callback does not
+	/// stop the others; the first exception is rethrown once all have run.
+	/// \returns the number of subscribers called
+	auto notify(
+	    const std::vector<std::string>& changed_paths, const TomlTable& config
+	) -> std::size_t;
+
+	[[nodiscard]] auto size() const -> std::size_t;
+
+    private:
+	struct Subscriber {
+		SubscriptionId id;
+		std::shared_ptr<const Callback> callback;
+	};
+
+	struct PathNode {
+		std::map<std::string, std::unique_ptr<PathNode>, std::less<>>
+		    children;
+		std::vector<Subscriber> subscribers;
+	};
+
+	static void collect_subtree(
+	    const PathNode& node, std::vector<const Subscriber*>& found
+	);
+
+	mutable std::mutex mutex;
+	PathNode root;
+	std::unordered_map<SubscriptionId, std::string> path_by_id;
+	SubscriptionId next_id = 1;
+};
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -9,76 +9,164 @@
 
 #pragma once
 
+#include "Assert.hpp"
+#include "sys/debuginfo.hpp"
+#include "sys/throw_sites.hpp"
 #include "types.hpp"
 
-#include <cstring>
+#include <atomic>
 #include <exception>
-#include <sstream>
+#include <source_location>
 #include <stdexcept>
 #include <string>
 
-void inline assert_impl(
-    c::const_string failed_condition, c::const_string assert_reason = ""
-);
+namespace IOCore {
 
-#define ASSERT(condition)                                                       \
-	if (static_cast<bool>(condition) == false) {                            \
-		IOCore::assert_impl(#condition);                                \
-	}
-#define ASSERT_MSG(condition, msg)                                              \
-	if (static_cast<bool>(condition) == false) {                            \
-		IOCore::assert_impl(#condition, msg);                           \
-	}
+/// \brief How much of the call stack an exception records when constructed.
+///
+/// The ceiling can be lowered at compile time with IOCORE_STACK_CAPTURE_MAX
+/// (0 = None, 1 = RawAddresses, 2 = Symbolized; CMake option
+/// IOCORE_EXCEPTION_STACKTRACES), which removes the capture code entirely.
+enum class StackCapture : int {
+	None = 0,         ///< no frames are captured
+	RawAddresses = 1, ///< frames are captured but printed as addresses
+	Symbolized = 2,   ///< frames are symbolized on the first what()
+	Sampled = 3       ///< 1-in-N throws per throw site are Symbolized
+};
 
-namespace IOCore {
+/// \brief Runtime capture settings shared by every exception of one type.
+struct StackCapturePolicy {
+	static constexpr unsigned kDefaultSampleRate = 100;
+
+	std::atomic<StackCapture> mode{ StackCapture::Symbolized };
+	std::atomic<unsigned> sample_rate{ kDefaultSampleRate };
+};
 
+/// \brief Base of every IOCore exception.
+///
+/// Every constructor takes the source location of the throw, defaulted at
+/// the call site; StackCapture::Sampled counts throws per location.
+/// Derived types should take and forward one the same way, or all their
+/// throws count as one site: their own constructor.
 class Exception : public std::exception {
     public:
 	constexpr static auto kDefault_Error = "An exception has ocurred!";
 
-	Exception(c::const_string message = kDefault_Error);
-	Exception(const std::string& message);
+	Exception(
+	    c::const_string message = kDefault_Error,
+	    std::source_location site = std::source_location::current()
+	);
+	Exception(
+	    const std::string& message,
+	    std::source_location site = std::source_location::current()
+	);
 
-	Exception(const Exception& other) = default;
-	Exception(const std::exception& inner);
+	Exception(const Exception& other) noexcept;
+	Exception(
+	    const std::exception& inner,
+	    std::source_location site = std::source_location::current()
+	);
+	~Exception() override;
 
 	auto operator=(const Exception&) -> Exception& = delete;
 
 	auto what() const noexcept -> const char* override;
 	auto stacktrace() const noexcept -> const std::string&;
 
+	/// \brief The capture policy for \p TException.
+	///
+	/// Each exception type that passes its own policy to the Exception
+	/// constructor can be tuned independently, e.g. to keep traces for
+	/// rare faults but not for hot validation errors.
+	template<typename TException = Exception>
+	static auto capturePolicy() noexcept -> StackCapturePolicy&
+	{
+		static StackCapturePolicy policy;
+		return policy;
+	}
+
+	template<typename TException = Exception>
+	static void setStackCapture(
+	    StackCapture mode,
+	    unsigned sample_rate = StackCapturePolicy::kDefaultSampleRate
+	) noexcept
+	{
+		auto& policy = capturePolicy<TException>();
+		policy.sample_rate.store(
+		    sample_rate > 0 ? sample_rate : 1, std::memory_order_relaxed
+		);
+		policy.mode.store(mode, std::memory_order_relaxed);
+	}
+
     protected:
+	Exception(
+	    const std::string& message,
+	    StackCapturePolicy& policy,
+	    std::source_location site = std::source_location::current()
+	);
+
+	/// \brief As above, also recording the class name and extra data
+	/// shown by what(), in the same allocation as the message.
+	///
+	/// The message itself is only formatted on the first call to what(),
+	/// so exceptions that are caught and dropped never pay for it.
+	Exception(
+	    const std::string& message,
+	    StackCapturePolicy& policy,
+	    c::const_string class_name,
+	    c::const_string optional_data,
+	    std::source_location site = std::source_location::current()
+	);
+
+	/// \brief Records the class name and extra data shown by what() after
+	/// construction. This reallocates the payload; prefer the constructor
+	/// above.
 	void generate_final_what_message(
 	    c::const_string class_name = "", c::const_string optional_data = ""
 	);
 
     private:
-	std::string error_message;
-	std::string what_message;
-	std::string stack_trace;
+	/// Everything an exception carries lives in one reference-counted,
+	/// single-allocation block, so copying an exception (catch by value,
+	/// std::exception_ptr rethrow) is one atomic increment.
+	struct Payload;
 
-	std::exception_ptr inner_exception_ptr;
+	void capture_stack(
+	    StackCapturePolicy& policy, const std::source_location& site
+	);
+
+	Payload* payload;
 };
 
 struct NotImplementedException : public Exception {
-	NotImplementedException() : Exception("Method not implemented") {}
+	NotImplementedException(
+	    std::source_location site = std::source_location::current()
+	)
+	    : Exception("Method not implemented", site)
+	{
+	}
 	~NotImplementedException() override = default;
 };
 
-void inline assert_impl(
-    c::const_string failed_condition, c::const_string assert_reason = ""
-)
-{
-	std::stringstream assert_buffer;
-	assert_buffer << failed_condition << " is false!";
-
-	if (std::strlen(assert_reason) > 0) {
-		assert_buffer << std::endl
-			      << "\tassert_resion: " << assert_reason;
+/// \brief Thrown by a failed ASSERT, ASSERT_MSG, IOCORE_ASSERT or
+/// IOCORE_VERIFY; the data field holds the source location of the check.
+struct AssertionException : public Exception {
+	AssertionException(
+	    const std::string& message,
+	    const std::string& location,
+	    std::source_location site = std::source_location::current()
+	)
+	    : Exception(
+		  message,
+		  capturePolicy<AssertionException>(),
+		  "IOCore::AssertionException",
+		  location.c_str(),
+		  site
+	      )
+	{
 	}
-	assert_buffer << std::flush;
-	throw Exception(assert_buffer.str());
-}
+	~AssertionException() override = default;
+};
 } // namespace IOCore
 
 // clang-format off
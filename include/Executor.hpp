@@ -0,0 +1,283 @@
+/* Executor.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace IOCore {
+
+namespace executor_detail {
+/// \brief A type-erased, move-only callable with inline storage.
+///
+/// Callables that fit kInlineSize (a lambda capturing a few pointers) are
+/// stored in place; larger ones fall back to one heap allocation. Tasks are
+/// recycled through a per-thread free list; those submitted from outside
+/// the pool are handed back to outside submitters once run, so
+/// steady-state submission does not allocate on either kind of thread.
+class Task {
+    public:
+	static constexpr std::size_t kInlineSize = 6 * sizeof(void*);
+
+	Task() = default;
+	Task(const Task&) = delete;
+	auto operator=(const Task&) -> Task& = delete;
+
+	template<typename TCallable>
+	void emplace(TCallable&& callable)
+	{
+		using TFunctor = std::decay_t<TCallable>;
+
+		if constexpr (sizeof(TFunctor) <= kInlineSize &&
+		              alignof(TFunctor) <= alignof(std::max_align_t)) {
+			new (storage) TFunctor(std::forward<TCallable>(callable));
+			invoke_fn = [](Task& task) {
+				(*task.inline_functor<TFunctor>())();
+			};
+			destroy_fn = [](Task& task) noexcept {
+				task.inline_functor<TFunctor>()->~TFunctor();
+			};
+		} else {
+			new (storage) TFunctor*(
+			    new TFunctor(std::forward<TCallable>(callable))
+			);
+			invoke_fn = [](Task& task) {
+				(**task.inline_functor<TFunctor*>())();
+			};
+			destroy_fn = [](Task& task) noexcept {
+				delete *task.inline_functor<TFunctor*>();
+			};
+		}
+	}
+
+	void run() { invoke_fn(*this); }
+	void reset() noexcept { destroy_fn(*this); }
+
+	/// Free-list link; only meaningful while the task is not queued
+	Task* next_free = nullptr;
+	/// Acquired by a thread outside the pool that runs it
+	bool external = false;
+
+    private:
+	template<typename TFunctor>
+	auto inline_functor() noexcept -> TFunctor*
+	{
+		return std::launder(reinterpret_cast<TFunctor*>(storage));
+	}
+
+	alignas(std::max_align_t) std::byte storage[kInlineSize];
+	void (*invoke_fn)(Task&) = nullptr;
+	void (*destroy_fn)(Task&) noexcept = nullptr;
+};
+} // namespace executor_detail
+
+/// \brief A work-stealing thread pool.
+///
+/// Each worker owns a Chase-Lev deque: it pushes and pops its own work
+/// LIFO, while idle workers steal FIFO from the others. Tasks submitted from
+/// threads outside the pool go through a shared injection queue. Idle
+/// workers sleep on a condition variable instead of spinning.
+///
+/// Exceptions escaping submitted tasks are kept and rethrown by the next
+/// waitIdle(); parallelFor() rethrows in the calling thread.
+class Executor {
+    public:
+	/// \brief Worker count derived from the CPUs this process may run on
+	/// (its affinity mask on Linux), never less than one.
+	static auto defaultThreadCount() noexcept -> unsigned;
+
+	explicit Executor(unsigned thread_count = defaultThreadCount());
+
+	/// \brief Finishes all queued work, then joins the workers.
+	~Executor();
+
+	Executor(const Executor&) = delete;
+	auto operator=(const Executor&) -> Executor& = delete;
+
+	[[nodiscard]] auto threadCount() const noexcept -> unsigned
+	{
+		return static_cast<unsigned>(workers.size());
+	}
+
+	/// \brief Queues \p callable to run on a worker.
+	template<typename TCallable>
+	void submit(TCallable&& callable)
+	{
+		auto* task = acquire_task();
+		task->emplace(std::forward<TCallable>(callable));
+		enqueue(&task, 1);
+	}
+
+	/// \brief Queues \p count tasks, calling `callable(index)` for each
+	/// index; the callable is copied into every task.
+	template<typename TCallable>
+	void bulkSubmit(std::size_t count, const TCallable& callable)
+	{
+		constexpr std::size_t kBatch = 64;
+		executor_detail::Task* batch[kBatch];
+
+		for (std::size_t first = 0; first < count; first += kBatch) {
+			auto size = std::min(kBatch, count - first);
+			for (std::size_t offset = 0; offset < size; ++offset) {
+				batch[offset] = acquire_task();
+				batch[offset]->emplace(
+				    [callable, index = first + offset]() {
+					    callable(index);
+				    }
+				);
+			}
+			enqueue(batch, size);
+		}
+	}
+
+	/// \brief Calls `body(index)` for every index in [begin, end) and
+	/// returns once all calls have finished.
+	///
+	/// The range is split into chunks of \p grain indices (by default
+	/// about four per worker). The calling thread runs queued work while it
+	/// waits, so nested parallelFor() calls from inside tasks are safe. The
+	/// first exception thrown by \p body is rethrown here.
+	template<typename TBody>
+	void parallelFor(
+	    std::size_t begin, std::size_t end, TBody&& body, std::size_t grain = 0
+	)
+	{
+		if (begin >= end) {
+			return;
+		}
+		auto length = end - begin;
+		if (grain == 0) {
+			grain = std::max<std::size_t>(
+			    1, length / (std::size_t{ threadCount() } * 4)
+			);
+		}
+		auto chunks = (length + grain - 1) / grain;
+
+		ParallelForState state;
+		state.remaining.store(chunks, std::memory_order_relaxed);
+
+		bulkSubmit(
+		    chunks,
+		    [&state, &body, begin, end, grain](std::size_t chunk) {
+			    auto first = begin + chunk * grain;
+			    auto last = std::min(end, first + grain);
+			    try {
+				    for (auto index = first; index < last;
+				         ++index) {
+					    body(index);
+				    }
+			    } catch (...) {
+				    state.fail(std::current_exception());
+			    }
+			    state.remaining.fetch_sub(
+				1, std::memory_order_acq_rel
+			    );
+		    }
+		);
+
+		help_until([&state]() {
+			return state.remaining.load(std::memory_order_acquire) ==
+			       0;
+		});
+		if (state.error) {
+			std::rethrow_exception(state.error);
+		}
+	}
+
+	/// \brief Runs queued work on the calling thread until every submitted
+	/// task has finished, then rethrows the first exception a task threw.
+	void waitIdle();
+
+	/// \brief Like waitIdle(), but gives up after \p timeout and never
+	/// runs tasks on the calling thread.
+	/// \returns false if work was still pending when time ran out
+	auto waitIdleFor(std::chrono::nanoseconds timeout) -> bool;
+
+	/// \brief Drops every task that has not started yet; tasks already
+	/// running are left to finish.
+	/// \returns the number of tasks dropped
+	auto discardQueued() -> std::size_t;
+
+    private:
+	struct Worker;
+
+	struct ParallelForState {
+		std::atomic<std::size_t> remaining{ 0 };
+		std::mutex error_mutex;
+		std::exception_ptr error;
+
+		void fail(std::exception_ptr exception)
+		{
+			std::lock_guard lock(error_mutex);
+			if (!error) {
+				error = std::move(exception);
+			}
+		}
+	};
+
+	auto acquire_task() -> executor_detail::Task*;
+	void release_task(executor_detail::Task* task) noexcept;
+
+	void enqueue(executor_detail::Task* const tasks[], std::size_t count);
+	void worker_loop(Worker& worker);
+	auto find_task(Worker* worker) -> executor_detail::Task*;
+	void execute(executor_detail::Task* task) noexcept;
+	auto run_one() -> bool;
+
+	template<typename TDone>
+	void help_until(TDone&& done)
+	{
+		while (!done()) {
+			if (!run_one()) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	std::vector<std::unique_ptr<Worker>> workers;
+
+	std::mutex injection_mutex;
+	// FIFO: tasks before injection_head have been taken. The storage is
+	// compacted rather than freed, so a warm queue does not allocate.
+	std::vector<executor_detail::Task*> injection_queue;
+	std::size_t injection_head = 0;
+	std::atomic<std::size_t> injection_size{ 0 };
+
+	// Tasks run for outside submitters, on their way back to them; a
+	// stack that is only ever pushed to or taken whole, so ABA-free
+	std::atomic<executor_detail::Task*> returned_tasks{ nullptr };
+
+	std::atomic<std::size_t> pending{ 0 };
+	std::atomic<std::uint64_t> work_epoch{ 0 };
+	std::atomic<unsigned> sleeping{ 0 };
+	std::atomic<bool> stopping{ false };
+	std::mutex sleep_mutex;
+	std::condition_variable wake;
+
+	std::mutex error_mutex;
+	std::exception_ptr first_error;
+};
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -10,10 +10,13 @@
 #pragma once
 
 #include "Exception.hpp"
+#include "sys/durable_write.hpp"
 #include "types.hpp"
 
 #include <filesystem>
 #include <fstream>
+#include <source_location>
+#include <string_view>
 
 namespace IOCore {
 enum class CreateDirs : bool {
@@ -34,17 +37,34 @@ class FileResource {
 	virtual ~FileResource() = default;
 
 	auto getFilePath() const noexcept -> const auto&  { return file_path; }
+
+	/// \brief Selects how writes make themselves durable; GroupCommit
+	/// lets concurrent writers in one directory share a directory fsync.
+	void setSyncMode(SyncMode mode) noexcept { sync_mode = mode; }
+	auto getSyncMode() const noexcept -> SyncMode { return sync_mode; }
     protected:
+	/// \brief Atomically and durably replaces the file's contents (see
+	/// write_file_atomically()).
+	void replace_contents(std::string_view contents) const;
+
 	std::filesystem::path file_path;
+	SyncMode sync_mode = SyncMode::PerWrite;
 };
 
 struct UnreachablePathException : public Exception {
-	UnreachablePathException(const std::filesystem::path& path)
-	    : Exception("Unreachable path or directory"), unreachable_path(path)
+	UnreachablePathException(
+	    const std::filesystem::path& path,
+	    std::source_location site = std::source_location::current()
+	)
+	    : Exception(
+		  "Unreachable path or directory",
+		  capturePolicy<UnreachablePathException>(),
+		  "IOCore::UnreachablePathException",
+		  path.c_str(),
+		  site
+	      )
+	    , unreachable_path(path)
 	{
-		this->generate_final_what_message(
-		    "IOCore::UnreachablePathException", path.c_str()
-		);
 	}
 
 	auto what() const noexcept -> const char* override
@@ -0,0 +1,66 @@
+/* FileWatcher.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Reactor.hpp"
+
+namespace IOCore {
+
+/// \brief Calls back when a file is rewritten, through a Reactor.
+///
+/// Uses inotify on the file's directory rather than on the file itself, so
+/// editors and deploy tools that write a temporary file and rename() it over
+/// the original are followed too (a watch on the file would stay attached
+/// to the replaced inode). All events read in one go trigger one callback.
+///
+/// An inotify queue overflow counts as a change, since the lost events
+/// may have named the file. If the directory itself is removed, the watch
+/// is re-added on a directory recreated at the same path and the callback
+/// runs; when that fails, IOCore::Exception escapes from the Reactor call
+/// that dispatched the event.
+///
+/// Only available on Linux; elsewhere the constructor throws
+/// IOCore::NotImplementedException.
+class FileWatcher {
+    public:
+	using Callback = std::function<void()>;
+
+	/// \brief Must be called on \p reactor's loop thread; \p on_change
+	/// runs there too.
+	FileWatcher(
+	    Reactor& reactor, const std::filesystem::path& file, Callback on_change
+	);
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	auto operator=(const FileWatcher&) -> FileWatcher& = delete;
+
+    private:
+	void add_watch();
+	void drain_events();
+
+	Reactor& reactor;
+	std::filesystem::path directory;
+	std::string file_name;
+	Callback on_change;
+	int inotify_fd = -1;
+	Reactor::SourceId source = 0;
+	std::vector<char> event_buffer;
+};
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
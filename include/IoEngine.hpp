@@ -0,0 +1,218 @@
+/* IoEngine.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+
+#include "Task.hpp"
+
+namespace IOCore {
+
+class Executor;
+class Reactor;
+
+/// \brief Outcome of an IoEngine operation: a byte count or descriptor on
+/// success, a negated errno value on failure (the io_uring convention).
+struct IoResult {
+	std::int64_t value = 0;
+
+	[[nodiscard]] auto ok() const noexcept -> bool { return value >= 0; }
+	[[nodiscard]] auto error() const noexcept -> int
+	{
+		return ok() ? 0 : static_cast<int>(-value);
+	}
+};
+
+/// \brief The parts of statx()/stat() that IOCore uses.
+struct FileStatus {
+	std::uint64_t size = 0;
+	std::uint64_t device = 0;
+	std::uint64_t inode = 0;
+	std::int64_t mtime_ns = 0;
+	std::uint32_t mode = 0;
+};
+
+/// \brief Asynchronous file I/O with batched submission.
+///
+/// Operations are queued by read(), write(), fsync(), open(), close() and
+/// stat(), and handed to the kernel together by submit(). Their
+/// completions run on whichever thread calls poll() or wait(), or on the
+/// loop thread once attach()ed to a Reactor. Buffers, paths' owners and
+/// FileStatus targets must stay alive until the completion has run.
+///
+/// Two backends implement it:
+/// - IoUring: a ring set up with raw io_uring syscalls. Submitting a batch
+///   costs one io_uring_enter(), and registered buffers and files skip the
+///   kernel's per-operation page pinning and descriptor lookup. No more
+///   operations are in flight than the completion ring holds; the rest
+///   wait in the submission ring (\p queue_depth entries), and queueing
+///   throws IOCore::Exception once that is full too.
+/// - ThreadPool: pread()/pwrite() and friends run on an Executor. It is
+///   used where io_uring is missing, disabled (io_uring_disabled, seccomp)
+///   or not Linux. Registration is accepted and ignored. Operations the
+///   executor refuses or discards complete with ECANCELED.
+///
+/// Queueing and submit() may be called from any thread; poll() and wait()
+/// from one thread at a time.
+class IoEngine {
+    public:
+	using Completion = std::function<void(IoResult)>;
+
+	enum class Backend { Auto, IoUring, ThreadPool };
+	enum class Sync { All, DataOnly };
+
+	static constexpr unsigned kDefaultQueueDepth = 256;
+
+	/// \brief An io_uring engine when \p backend allows and the kernel
+	/// supports it, else one running on \p executor.
+	/// \throws IOCore::Exception if Backend::IoUring was requested but is
+	/// unavailable
+	static auto create(
+	    Executor& executor,
+	    Backend backend = Backend::Auto,
+	    unsigned queue_depth = kDefaultQueueDepth
+	) -> std::unique_ptr<IoEngine>;
+
+	virtual ~IoEngine() = default;
+
+	IoEngine(const IoEngine&) = delete;
+	auto operator=(const IoEngine&) -> IoEngine& = delete;
+
+	[[nodiscard]] virtual auto backend() const noexcept -> Backend = 0;
+
+	virtual void read(
+	    int fd,
+	    std::span<std::byte> buffer,
+	    std::uint64_t offset,
+	    Completion on_complete
+	) = 0;
+	virtual void write(
+	    int fd,
+	    std::span<const std::byte> data,
+	    std::uint64_t offset,
+	    Completion on_complete
+	) = 0;
+	virtual void fsync(int fd, Sync sync, Completion on_complete) = 0;
+	/// \brief Completes with the new descriptor.
+	virtual void open(
+	    std::filesystem::path path,
+	    int flags,
+	    unsigned mode,
+	    Completion on_complete
+	) = 0;
+	virtual void close(int fd, Completion on_complete) = 0;
+	virtual void stat(
+	    std::filesystem::path path, FileStatus& status, Completion on_complete
+	) = 0;
+
+	/// \brief Registers buffers that later reads and writes inside them
+	/// use without re-pinning pages; replaces any earlier set.
+	/// \returns false if the kernel refused (e.g. RLIMIT_MEMLOCK)
+	virtual auto registerBuffers(std::span<const std::span<std::byte>> buffers)
+	    -> bool = 0;
+
+	/// \brief Registers descriptors that later operations on them use
+	/// without a descriptor table lookup; replaces any earlier set.
+	virtual auto registerFiles(std::span<const int> fds) -> bool = 0;
+
+	/// \brief Starts every queued operation.
+	/// \returns how many were started
+	virtual auto submit() -> std::size_t = 0;
+
+	/// \brief Runs the completions that are ready, without blocking.
+	/// \returns how many ran
+	virtual auto poll() -> std::size_t = 0;
+
+	/// \brief Submits, then blocks up to \p timeout for at least one
+	/// completion if any operation is in flight, and runs those ready.
+	/// \returns how many ran
+	virtual auto wait(std::chrono::milliseconds timeout) -> std::size_t = 0;
+
+	/// \brief Operations submitted whose completions have not yet run.
+	[[nodiscard]] virtual auto inFlight() const noexcept -> std::size_t = 0;
+
+	/// \brief Runs completions from \p reactor's loop. Must be called on
+	/// the loop thread.
+	virtual void attach(Reactor& reactor) = 0;
+	virtual void detach() noexcept = 0;
+
+	/// \brief Awaitable form of a single operation; the coroutine resumes
+	/// on the thread that runs the completion.
+	class Operation {
+	    public:
+		using Start = std::function<void(IoEngine&, Completion)>;
+
+		static auto await_ready() noexcept -> bool { return false; }
+		void await_suspend(std::coroutine_handle<> handle);
+		[[nodiscard]] auto await_resume() const noexcept -> IoResult
+		{
+			return result;
+		}
+
+	    private:
+		friend class IoEngine;
+		Operation(IoEngine& owner, Start starter)
+		    : engine(&owner), start(std::move(starter))
+		{
+		}
+
+		IoEngine* engine;
+		Start start;
+		IoResult result;
+	};
+
+	[[nodiscard]] auto asyncRead(
+	    int fd, std::span<std::byte> buffer, std::uint64_t offset
+	) -> Operation;
+	[[nodiscard]] auto asyncWrite(
+	    int fd, std::span<const std::byte> data, std::uint64_t offset
+	) -> Operation;
+	[[nodiscard]] auto asyncFsync(int fd, Sync sync = Sync::All) -> Operation;
+	[[nodiscard]] auto asyncOpen(
+	    std::filesystem::path path, int flags, unsigned mode = 0644
+	) -> Operation;
+	[[nodiscard]] auto asyncClose(int fd) -> Operation;
+	[[nodiscard]] auto asyncStat(std::filesystem::path path, FileStatus& status)
+	    -> Operation;
+
+	/// \brief Reads the whole of \p path.
+	/// \throws IOCore::Exception naming the failed step
+	auto readFile(std::filesystem::path path) -> Task<std::string>;
+
+	/// \brief Replaces the contents of \p path, creating it if needed.
+	/// \throws IOCore::Exception naming the failed step
+	auto writeFile(std::filesystem::path path, std::string contents)
+	    -> Task<void>;
+
+    protected:
+	IoEngine() = default;
+};
+
+namespace io_detail {
+/// An io_uring engine, or nullptr where io_uring cannot be set up
+auto create_io_uring_engine(unsigned queue_depth) -> std::unique_ptr<IoEngine>;
+
+auto create_thread_pool_engine(Executor& executor)
+    -> std::unique_ptr<IoEngine>;
+} // namespace io_detail
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,99 @@
+/* MappedFileResource.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+#include "FileResource.hpp"
+
+namespace IOCore {
+
+/// \brief A file mapped read-only into memory.
+///
+/// bytes() and view() expose the file's contents without copying them, so
+/// parsers can work on the page cache directly. Views stay valid until the
+/// next remap() or the end of the object's life.
+///
+/// The mapping follows the file that was opened: if it is replaced by
+/// rename(), construct a new MappedFileResource. Truncating the file while
+/// it is mapped makes reads past the new end raise SIGBUS, as with any
+/// mmap(). The config readers therefore copy files with read(); map only
+/// files that nothing else truncates while they are in use.
+class MappedFileResource : public FileResource {
+    public:
+	enum class Advice {
+		Normal,
+		Sequential, ///< read ahead aggressively, drop pages behind
+		Random,     ///< disable read-ahead
+		WillNeed,   ///< start reading the whole mapping in now
+		HugePage,   ///< back the mapping with huge pages if possible
+	};
+
+	/// \throws IOCore::Exception if the file cannot be opened or mapped
+	explicit MappedFileResource(
+	    const std::filesystem::path& file_path,
+	    CreateDirs mode = CreateDirs::Disable
+	);
+	~MappedFileResource() override;
+
+	MappedFileResource(const MappedFileResource&) = delete;
+	auto operator=(const MappedFileResource&) -> MappedFileResource& = delete;
+
+	[[nodiscard]] auto bytes() const noexcept -> std::span<const std::byte>
+	{
+		return { static_cast<const std::byte*>(mapping), mapped_size };
+	}
+
+	[[nodiscard]] auto view() const noexcept -> std::string_view
+	{
+		return { static_cast<const char*>(mapping), mapped_size };
+	}
+
+	[[nodiscard]] auto size() const noexcept -> std::size_t
+	{
+		return mapped_size;
+	}
+
+	[[nodiscard]] auto empty() const noexcept -> bool
+	{
+		return mapped_size == 0;
+	}
+
+	/// \brief The open file descriptor behind the mapping.
+	[[nodiscard]] auto nativeHandle() const noexcept -> int
+	{
+		return descriptor;
+	}
+
+	/// \brief Passes \p advice to madvise().
+	/// \returns false if the kernel does not support or declined it
+	auto advise(Advice advice) const noexcept -> bool;
+
+	/// \brief Maps the file again if its size has changed.
+	/// \returns true if the mapping changed, invalidating earlier views
+	/// \throws IOCore::Exception if the new size cannot be mapped
+	auto remap() -> bool;
+
+    private:
+	void map(std::size_t size);
+	void unmap() noexcept;
+
+	int descriptor = -1;
+	void* mapping = nullptr;
+	std::size_t mapped_size = 0;
+};
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
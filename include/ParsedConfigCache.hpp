@@ -0,0 +1,112 @@
+/* ParsedConfigCache.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "TomlTable.hpp"
+
+namespace IOCore {
+
+struct ParsedConfigCacheStats {
+	std::uint64_t hits = 0;
+	std::uint64_t misses = 0;
+	std::uint64_t evictions = 0;
+	std::size_t entries = 0;
+};
+
+/// \brief A size-bounded LRU cache of parsed TOML files, shared by every
+/// TomlConfigFile in the process.
+///
+/// Entries are keyed by the file's device and inode, which is what its
+/// canonical path resolves to, so symlinks and different spellings of a
+/// path share one entry, while a file replaced by rename() gets a new one.
+/// An entry is reused while the file's mtime and size are unchanged,
+/// costing one stat() and no read or parse.
+///
+/// Files modified within a couple of seconds of being cached could change
+/// again without their mtime moving, so those entries are checked against
+/// a hash of the file's contents until they are old enough to trust.
+/// setVerifyContent(true) applies that check to every lookup.
+class ParsedConfigCache {
+    public:
+	static constexpr std::size_t kDefaultCapacity = 64;
+
+	explicit ParsedConfigCache(std::size_t capacity = kDefaultCapacity);
+	~ParsedConfigCache();
+
+	ParsedConfigCache(const ParsedConfigCache&) = delete;
+	auto operator=(const ParsedConfigCache&) -> ParsedConfigCache& = delete;
+
+	/// \brief The cache used by TomlConfigFile.
+	static auto global() -> ParsedConfigCache&;
+
+	/// \brief Returns the parsed contents of \p path, parsing it only when
+	/// it is not cached or has changed. An empty file is an empty table.
+	/// \throws IOCore::Exception if \p path cannot be read, or the
+	/// toml::parse_error if it is not valid TOML
+	auto load(const std::filesystem::path& path)
+	    -> std::shared_ptr<const TomlTable>;
+
+	/// \brief Drops the entry for \p path, if any.
+	void invalidate(const std::filesystem::path& path);
+	void clear();
+
+	/// \brief Bounds the number of cached files; 0 disables caching.
+	void setCapacity(std::size_t capacity);
+	[[nodiscard]] auto capacity() const -> std::size_t;
+
+	void setVerifyContent(bool enabled);
+
+	[[nodiscard]] auto stats() const -> ParsedConfigCacheStats;
+	void resetStats();
+
+    private:
+	struct FileKey {
+		std::uint64_t device;
+		std::uint64_t inode;
+
+		auto operator==(const FileKey&) const -> bool = default;
+	};
+	struct FileKeyHash {
+		auto operator()(const FileKey& key) const noexcept -> std::size_t;
+	};
+
+	struct Entry {
+		FileKey key;
+		std::int64_t mtime_ns;
+		std::uint64_t size;
+		std::uint64_t content_hash;
+		bool racy; ///< recently modified; verify contents before reuse
+		std::shared_ptr<const TomlTable> table;
+	};
+
+	void insert_locked(Entry entry);
+	void evict_locked();
+
+	mutable std::mutex mutex;
+	std::list<Entry> entries; ///< most recently used first
+	std::unordered_map<FileKey, std::list<Entry>::iterator, FileKeyHash>
+	    index;
+	std::size_t max_entries;
+	bool verify_content = false;
+	ParsedConfigCacheStats counters;
+};
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,173 @@
+/* Reactor.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+struct epoll_event;
+
+namespace IOCore {
+
+/// \brief An edge-triggered epoll event loop.
+///
+/// Sources are file descriptors, timers (timerfd), cross-thread notifiers
+/// (eventfd) and signals (signalfd). Each source has one callback that runs
+/// on the thread calling run(); its argument depends on the source:
+///
+/// | source        | callback argument                          |
+/// |---------------|--------------------------------------------|
+/// | watchFd()     | ready events (Readable, Writable, Hangup)  |
+/// | addTimer()    | expirations since the last callback        |
+/// | addNotifier() | notifications since the last callback      |
+/// | addSignal()   | the signal number                          |
+///
+/// Up to kMaxEventsPerWait ready events are collected per epoll_wait() into
+/// a buffer owned by the reactor, so dispatching does not allocate. Watched
+/// descriptors are edge-triggered: callbacks must read or write until the
+/// call would block.
+///
+/// Sources are added and removed on the loop thread; stop() and
+/// Notifier::notify() may be called from any thread. Only available on
+/// Linux; elsewhere the constructor throws IOCore::NotImplementedException.
+class Reactor {
+    public:
+	using SourceId = std::uint64_t;
+	using Callback = std::function<void(std::uint64_t)>;
+
+	static constexpr std::size_t kMaxEventsPerWait = 64;
+
+	enum Events : std::uint32_t {
+		Readable = 1U << 0,
+		Writable = 1U << 1,
+		Hangup = 1U << 2, ///< peer closed, or an error is pending
+	};
+
+	/// \brief Thread-safe handle that wakes an addNotifier() source.
+	class Notifier {
+	    public:
+		Notifier() = default;
+		void notify() const noexcept;
+
+	    private:
+		friend class Reactor;
+		explicit Notifier(int event_fd) : fd(event_fd) {}
+		int fd = -1;
+	};
+
+	Reactor();
+	~Reactor();
+
+	Reactor(const Reactor&) = delete;
+	auto operator=(const Reactor&) -> Reactor& = delete;
+
+	/// \brief Calls \p callback when \p fd becomes ready for \p events.
+	/// The descriptor is not owned and is not closed by remove().
+	auto watchFd(int fd, std::uint32_t events, Callback callback)
+	    -> SourceId;
+
+	/// \brief A timer first firing after \p initial, then every
+	/// \p interval (zero for a one-shot timer).
+	auto addTimer(
+	    std::chrono::nanoseconds initial,
+	    std::chrono::nanoseconds interval,
+	    Callback callback
+	) -> SourceId;
+
+	/// \brief Restarts an addTimer() source with a new schedule; its
+	/// callback and id are kept.
+	void rearmTimer(
+	    SourceId timer,
+	    std::chrono::nanoseconds initial,
+	    std::chrono::nanoseconds interval
+	);
+
+	/// \brief Stops an addTimer() source from firing until rearmTimer().
+	void disarmTimer(SourceId timer);
+
+	/// \brief An eventfd source; \p notifier receives the handle other
+	/// threads use to trigger it.
+	auto addNotifier(Callback callback, Notifier* notifier) -> SourceId;
+
+	/// \brief Delivers \p signal_number through the loop.
+	///
+	/// The signal is blocked for the calling thread, so this should be
+	/// called before other threads are started (they inherit the mask).
+	auto addSignal(int signal_number, Callback callback) -> SourceId;
+
+	/// \brief Unregisters a source. Safe from inside any callback, including
+	/// the source's own; events already collected for it are dropped.
+	///
+	/// Removing the last source of a signal restores the calling thread's
+	/// mask for it as addSignal() found it. Instances still pending are
+	/// consumed first, so they never get the default action.
+	void remove(SourceId source);
+
+	/// \brief Dispatches events until stop() is called.
+	/// \returns the exit code passed to stop()
+	auto run() -> int;
+
+	/// \brief Waits up to \p timeout (negative: forever) for one batch of
+	/// events and dispatches it.
+	///
+	/// A throwing callback does not cut the batch short: edge-triggered
+	/// events left in it would not be reported again. The first exception
+	/// is rethrown once every callback has run.
+	/// \returns the number of callbacks run
+	auto runOnce(std::chrono::milliseconds timeout) -> std::size_t;
+
+	/// \brief Makes run() return \p exit_code; callable from any thread.
+	void stop(int exit_code = 0) noexcept;
+
+    private:
+	enum class SourceKind : std::uint8_t { Fd, Timer, Notifier, Signal };
+
+	struct Source {
+		int fd = -1;
+		SourceKind kind = SourceKind::Fd;
+		bool active = false;
+		int signal_number = 0;
+		bool unblock_on_remove = false; ///< not blocked before addSignal()
+		std::uint32_t generation = 0;
+		Callback callback;
+	};
+
+	auto add_source(
+	    int fd,
+	    SourceKind kind,
+	    std::uint32_t epoll_events,
+	    Callback&& callback,
+	    int signal_number = 0
+	) -> SourceId;
+	void dispatch(const epoll_event& event);
+	auto find_timer(SourceId source_id) -> Source&;
+
+	int epoll_fd = -1;
+	int wake_fd = -1;
+	std::atomic<bool> stopped{ false };
+	std::atomic<int> exit_code{ 0 };
+
+	// A deque, so adding sources from a callback never moves the callback
+	// that is running
+	std::deque<Source> sources;
+	std::vector<std::uint32_t> free_slots;
+	// Removed during dispatch; recycled once the batch is done
+	std::vector<std::uint32_t> retired_slots;
+	std::vector<epoll_event> ready_events;
+};
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
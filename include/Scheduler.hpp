@@ -0,0 +1,170 @@
+/* Scheduler.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Executor.hpp"
+#include "Reactor.hpp"
+#include "Task.hpp"
+#include "TimerWheel.hpp"
+
+namespace IOCore {
+
+class FileResource;
+class TomlConfigFile;
+
+/// \brief Resumes coroutines on an Executor or on a Reactor's loop thread.
+///
+/// Awaiting schedule() moves a coroutine onto a pool worker; awaiting
+/// resumeOnLoop() or sleepFor() moves it onto the thread running the
+/// reactor. The loop-side awaitables need a reactor and throw
+/// IOCore::Exception when the scheduler was built without one.
+///
+/// Coroutines still suspended in sleepFor() when the scheduler is destroyed
+/// are never resumed.
+class Scheduler {
+    public:
+	class ExecutorAwaiter {
+	    public:
+		static auto await_ready() noexcept -> bool { return false; }
+		void await_suspend(std::coroutine_handle<> handle);
+		static void await_resume() noexcept {}
+
+	    private:
+		friend class Scheduler;
+		explicit ExecutorAwaiter(Executor& pool) : executor(&pool) {}
+		Executor* executor;
+	};
+
+	class LoopAwaiter {
+	    public:
+		static auto await_ready() noexcept -> bool { return false; }
+		void await_suspend(std::coroutine_handle<> handle);
+		static void await_resume() noexcept {}
+
+	    private:
+		friend class Scheduler;
+		LoopAwaiter(Scheduler& owner, std::chrono::nanoseconds wait)
+		    : scheduler(&owner), delay(wait)
+		{
+		}
+		Scheduler* scheduler;
+		std::chrono::nanoseconds delay; ///< negative: no timer
+	};
+
+	/// \brief Must be constructed on the thread that runs \p reactor.
+	explicit Scheduler(Executor& executor, Reactor* reactor = nullptr);
+	~Scheduler();
+
+	Scheduler(const Scheduler&) = delete;
+	auto operator=(const Scheduler&) -> Scheduler& = delete;
+
+	/// \brief Continues the awaiting coroutine on a pool worker.
+	[[nodiscard]] auto schedule() noexcept -> ExecutorAwaiter
+	{
+		return ExecutorAwaiter(executor);
+	}
+
+	/// \brief Continues the awaiting coroutine on the loop thread.
+	[[nodiscard]] auto resumeOnLoop() -> LoopAwaiter;
+
+	/// \brief Continues the awaiting coroutine on the loop thread once
+	/// \p duration has elapsed, rounded up to the millisecond. All sleeps
+	/// share one TimerWheel, and so one timerfd.
+	[[nodiscard]] auto sleepFor(std::chrono::nanoseconds duration)
+	    -> LoopAwaiter;
+
+	/// \brief Starts \p task on a pool worker without waiting for it.
+	///
+	/// An exception escaping the task is handed to the executor, which
+	/// rethrows it from its next Executor::waitIdle(). Once the executor
+	/// is shutting down the task is not started and the error is dropped.
+	template<typename TResult>
+	void spawn(Task<TResult> task)
+	{
+		spawn_body(*this, std::move(task));
+	}
+
+	/// \brief Reads the whole of \p file on a pool worker.
+	auto readFile(const FileResource& file) -> Task<std::string>;
+
+	/// \brief Atomically replaces the contents of \p file on a pool worker,
+	/// honouring its SyncMode.
+	auto writeFile(const FileResource& file, std::string contents)
+	    -> Task<void>;
+
+	/// \brief Re-reads \p config on a pool worker. The awaiting coroutine
+	/// must not touch \p config until this completes.
+	auto reloadConfig(TomlConfigFile& config) -> Task<void>;
+
+    private:
+	struct LoopRequest {
+		std::coroutine_handle<> handle;
+		std::chrono::nanoseconds delay;
+	};
+
+	// Embeds its wheel timer, so putting a coroutine to sleep allocates
+	// nothing once the pool has grown
+	struct Sleeper : Timer {
+		Sleeper(Scheduler& owner, std::size_t slot)
+		    : Timer(wake_sleeper), scheduler(&owner), index(slot)
+		{
+		}
+
+		Scheduler* scheduler;
+		std::size_t index;
+		std::coroutine_handle<> handle;
+	};
+
+	template<typename TResult>
+	static auto spawn_body(Scheduler& scheduler, Task<TResult> task)
+	    -> coroutine_detail::DetachedTask
+	{
+		try {
+			co_await scheduler.schedule();
+			co_await std::move(task);
+		} catch (...) {
+			scheduler.report_error(std::current_exception());
+		}
+	}
+
+	void report_error(std::exception_ptr error) noexcept;
+	void post_to_loop(const LoopRequest& request);
+	void run_loop_requests();
+	static void wake_sleeper(Timer& timer);
+
+	Executor& executor;
+	Reactor* reactor;
+	Reactor::Notifier loop_notifier;
+	Reactor::SourceId loop_source = 0;
+
+	std::mutex loop_mutex;
+	std::vector<LoopRequest> loop_requests;
+	// Loop thread only
+	std::vector<LoopRequest> loop_batch;
+	TimerWheel sleep_wheel;
+	// A deque, since armed timers must not move; declared after the
+	// wheel so they are cancelled before it goes
+	std::deque<Sleeper> sleepers;
+	std::vector<std::size_t> free_sleepers;
+};
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,137 @@
+/* Subsystems.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <source_location>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Exception.hpp"
+
+namespace IOCore {
+
+class Executor;
+
+/// \brief Thrown by SubsystemGraph for unknown dependencies, cycles and
+/// failed initializers; \p subsystem names the node at fault.
+///
+/// For a failed initializer, \p inner holds the exception it threw, so
+/// callers can rethrow it and handle the original type.
+struct SubsystemException : public Exception {
+	SubsystemException(
+	    const std::string& message,
+	    std::string subsystem,
+	    std::exception_ptr inner = nullptr,
+	    std::source_location site = std::source_location::current()
+	)
+	    : Exception(
+		  message,
+		  capturePolicy<SubsystemException>(),
+		  "IOCore::SubsystemException",
+		  subsystem.c_str(),
+		  site
+	      )
+	    , subsystem(std::move(subsystem))
+	    , inner(std::move(inner))
+	{
+	}
+	~SubsystemException() override = default;
+
+	std::string subsystem;
+	std::exception_ptr inner;
+};
+
+/// \brief Per-subsystem timing from SubsystemGraph::initialize().
+struct SubsystemTiming {
+	std::string name;
+	std::chrono::nanoseconds start{};    ///< since initialize() began
+	std::chrono::nanoseconds duration{};
+	bool ran = false; ///< false if skipped because a dependency failed
+};
+
+/// \brief Initializes named subsystems in dependency order, running
+/// independent ones concurrently.
+///
+/// Each subsystem names the subsystems it needs; initialize() starts every
+/// subsystem whose dependencies are done on an Executor, so the wall-clock
+/// cost approaches the longest dependency chain instead of the sum. Every
+/// initializer also shows up as a StartupPhase.
+///
+/// When an initializer throws, its dependents are skipped, independent
+/// subsystems still finish, and initialize() then throws a
+/// SubsystemException naming the first failure.
+class SubsystemGraph {
+    public:
+	using Initializer = std::function<void()>;
+
+	SubsystemGraph() = default;
+	SubsystemGraph(const SubsystemGraph&) = delete;
+	auto operator=(const SubsystemGraph&) -> SubsystemGraph& = delete;
+
+	/// \brief Registers \p name; \p dependencies may name subsystems that
+	/// are added later.
+	/// \throws SubsystemException if \p name is already registered
+	void add(
+	    std::string name,
+	    std::vector<std::string> dependencies,
+	    Initializer initializer
+	);
+
+	/// \brief Runs every initializer on \p executor, blocking until all
+	/// have finished. Call it from outside the executor's workers.
+	/// \throws SubsystemException for an unknown dependency or a cycle
+	/// (before anything runs), or naming the first initializer that threw
+	void initialize(Executor& executor);
+
+	[[nodiscard]] auto size() const noexcept -> std::size_t
+	{
+		return nodes.size();
+	}
+
+	/// \brief Timings of the last initialize(), in registration order.
+	[[nodiscard]] auto timings() const -> std::vector<SubsystemTiming>;
+
+    private:
+	struct Node {
+		std::string name;
+		std::vector<std::string> dependency_names;
+		Initializer initializer;
+
+		std::vector<std::size_t> dependents;
+		std::size_t dependency_count = 0;
+		std::atomic<std::size_t> waiting_on{ 0 };
+		std::atomic<bool> blocked{ false };
+		SubsystemTiming timing;
+	};
+
+	struct Run;
+
+	void resolve();
+	[[nodiscard]] auto find_cycle() const -> std::string;
+	void start(Run& run, std::size_t index);
+	void finish(Run& run, std::size_t index, bool succeeded);
+
+	// A deque, since nodes hold atomics and must not move
+	std::deque<Node> nodes;
+	std::unordered_map<std::string, std::size_t> index_by_name;
+};
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
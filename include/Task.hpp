@@ -0,0 +1,303 @@
+/* Task.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace IOCore {
+
+/// \brief Counters for the calling thread's coroutine frame allocator.
+struct FrameAllocatorStats {
+	std::size_t fresh = 0;    ///< frames that needed a new allocation
+	std::size_t recycled = 0; ///< frames served from the free lists
+};
+
+namespace coroutine_detail {
+/// Coroutine frames are rounded up to a size class and recycled through
+/// per-thread free lists; frames larger than the biggest class go straight
+/// to operator new.
+auto allocate_frame(std::size_t size) -> void*;
+void deallocate_frame(void* frame, std::size_t size) noexcept;
+
+/// Shared by every IOCore coroutine promise, so all frames are recycled
+struct FramePromise {
+	static auto operator new(std::size_t size) -> void*
+	{
+		return allocate_frame(size);
+	}
+	static void operator delete(void* frame, std::size_t size) noexcept
+	{
+		deallocate_frame(frame, size);
+	}
+};
+} // namespace coroutine_detail
+
+auto frame_allocator_stats() noexcept -> FrameAllocatorStats;
+
+template<typename TResult = void>
+class Task;
+
+namespace coroutine_detail {
+template<typename TResult>
+struct TaskPromise;
+
+/// Resumes whoever awaited the task (symmetric transfer, so long chains of
+/// tasks completing synchronously do not grow the stack)
+struct FinalAwaiter {
+	static auto await_ready() noexcept -> bool { return false; }
+
+	template<typename TPromise>
+	auto await_suspend(std::coroutine_handle<TPromise> handle) noexcept
+	    -> std::coroutine_handle<>
+	{
+		auto continuation = handle.promise().continuation;
+		return continuation ? continuation : std::noop_coroutine();
+	}
+
+	static void await_resume() noexcept {}
+};
+
+struct TaskPromiseBase : FramePromise {
+	std::coroutine_handle<> continuation;
+	std::exception_ptr error;
+
+	static auto initial_suspend() noexcept -> std::suspend_always
+	{
+		return {};
+	}
+	static auto final_suspend() noexcept -> FinalAwaiter { return {}; }
+
+	void unhandled_exception() noexcept
+	{
+		error = std::current_exception();
+	}
+};
+
+template<typename TResult>
+struct TaskPromise : TaskPromiseBase {
+	std::variant<std::monostate, TResult> value;
+
+	auto get_return_object() noexcept -> Task<TResult>;
+
+	template<typename TValue>
+	    requires std::is_convertible_v<TValue&&, TResult>
+	void return_value(TValue&& result)
+	{
+		value.template emplace<1>(std::forward<TValue>(result));
+	}
+
+	auto result() -> TResult
+	{
+		if (error) {
+			std::rethrow_exception(error);
+		}
+		return std::move(std::get<1>(value));
+	}
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase {
+	auto get_return_object() noexcept -> Task<void>;
+
+	void return_void() noexcept {}
+
+	void result()
+	{
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+};
+} // namespace coroutine_detail
+
+/// \brief A lazily started coroutine producing a \p TResult.
+///
+/// The body starts running when the task is awaited and the awaiting
+/// coroutine resumes directly when it finishes. Exceptions propagate to the
+/// awaiter. Use Scheduler::spawn() to run a task without awaiting it, or
+/// sync_wait() to block on it from ordinary code.
+template<typename TResult>
+class [[nodiscard]] Task {
+    public:
+	using promise_type = coroutine_detail::TaskPromise<TResult>;
+	using handle_type = std::coroutine_handle<promise_type>;
+
+	Task() noexcept = default;
+	explicit Task(handle_type coroutine) noexcept : handle(coroutine) {}
+
+	Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+	auto operator=(Task&& other) noexcept -> Task&
+	{
+		if (this != &other) {
+			destroy();
+			handle = std::exchange(other.handle, {});
+		}
+		return *this;
+	}
+	Task(const Task&) = delete;
+	auto operator=(const Task&) -> Task& = delete;
+
+	~Task() { destroy(); }
+
+	[[nodiscard]] auto done() const noexcept -> bool
+	{
+		return !handle || handle.done();
+	}
+
+	auto operator co_await() && noexcept
+	{
+		struct Awaiter {
+			handle_type coroutine;
+
+			[[nodiscard]] auto await_ready() const noexcept -> bool
+			{
+				return !coroutine || coroutine.done();
+			}
+			auto await_suspend(std::coroutine_handle<> awaiting) noexcept
+			    -> std::coroutine_handle<>
+			{
+				coroutine.promise().continuation = awaiting;
+				return coroutine;
+			}
+			auto await_resume() -> TResult
+			{
+				return coroutine.promise().result();
+			}
+		};
+		return Awaiter{ handle };
+	}
+
+    private:
+	void destroy() noexcept
+	{
+		if (handle) {
+			handle.destroy();
+			handle = {};
+		}
+	}
+
+	handle_type handle;
+};
+
+namespace coroutine_detail {
+template<typename TResult>
+auto TaskPromise<TResult>::get_return_object() noexcept -> Task<TResult>
+{
+	return Task<TResult>(
+	    std::coroutine_handle<TaskPromise<TResult>>::from_promise(*this)
+	);
+}
+
+inline auto TaskPromise<void>::get_return_object() noexcept -> Task<void>
+{
+	return Task<void>(
+	    std::coroutine_handle<TaskPromise<void>>::from_promise(*this)
+	);
+}
+
+/// A coroutine that starts immediately and frees itself when it finishes;
+/// the building block for sync_wait() and Scheduler::spawn()
+struct DetachedTask {
+	struct promise_type : FramePromise {
+		static auto get_return_object() noexcept -> DetachedTask
+		{
+			return {};
+		}
+		static auto initial_suspend() noexcept -> std::suspend_never
+		{
+			return {};
+		}
+		static auto final_suspend() noexcept -> std::suspend_never
+		{
+			return {};
+		}
+		static void return_void() noexcept {}
+		// Bodies catch everything themselves
+		static void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+
+struct SyncWaitState {
+	std::mutex mutex;
+	std::condition_variable finished;
+	bool done = false;
+	std::exception_ptr error;
+};
+
+template<typename TResult>
+auto sync_wait_body(
+    Task<TResult>& task,
+    SyncWaitState& state,
+    std::variant<std::monostate, TResult>& result
+) -> DetachedTask
+{
+	try {
+		result.template emplace<1>(co_await std::move(task));
+	} catch (...) {
+		state.error = std::current_exception();
+	}
+	std::lock_guard lock(state.mutex);
+	state.done = true;
+	state.finished.notify_one();
+}
+
+inline auto sync_wait_body(
+    Task<void>& task, SyncWaitState& state, std::variant<std::monostate>&
+) -> DetachedTask
+{
+	try {
+		co_await std::move(task);
+	} catch (...) {
+		state.error = std::current_exception();
+	}
+	std::lock_guard lock(state.mutex);
+	state.done = true;
+	state.finished.notify_one();
+}
+} // namespace coroutine_detail
+
+/// \brief Runs \p task, blocking the calling thread until it finishes.
+///
+/// Meant for main() and tests; never call it from a coroutine or an
+/// Executor task, since it blocks a worker.
+template<typename TResult>
+auto sync_wait(Task<TResult> task) -> TResult
+{
+	using TStorage = std::conditional_t<
+	    std::is_void_v<TResult>,
+	    std::variant<std::monostate>,
+	    std::variant<std::monostate, TResult>>;
+
+	coroutine_detail::SyncWaitState state;
+	TStorage result;
+	coroutine_detail::sync_wait_body(task, state, result);
+
+	std::unique_lock lock(state.mutex);
+	state.finished.wait(lock, [&state]() { return state.done; });
+
+	if (state.error) {
+		std::rethrow_exception(state.error);
+	}
+	if constexpr (!std::is_void_v<TResult>) {
+		return std::move(std::get<1>(result));
+	}
+}
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
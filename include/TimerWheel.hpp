@@ -0,0 +1,209 @@
+/* TimerWheel.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "Assert.hpp"
+#include "Reactor.hpp"
+
+namespace IOCore {
+
+class TimerWheel;
+
+namespace timer_detail {
+/// Intrusive circular list link; a lone hook points at itself
+struct ListHook {
+	ListHook* next = this;
+	ListHook* prev = this;
+
+	[[nodiscard]] auto empty() const noexcept -> bool
+	{
+		return next == this;
+	}
+
+	void unlink() noexcept
+	{
+		prev->next = next;
+		next->prev = prev;
+		next = prev = this;
+	}
+
+	void pushBack(ListHook& hook) noexcept
+	{
+		hook.prev = prev;
+		hook.next = this;
+		prev->next = &hook;
+		prev = &hook;
+	}
+};
+} // namespace timer_detail
+
+/// \brief A timeout node, embedded in the object it times out.
+///
+/// The wheel only links timers together, so arming one never allocates.
+/// A timer cancels itself when destroyed and cannot be copied or moved
+/// while armed.
+class Timer : private timer_detail::ListHook {
+    public:
+	using Callback = void (*)(Timer&);
+
+	Timer() = default;
+	explicit Timer(Callback on_expired) : callback(on_expired) {}
+	~Timer();
+
+	Timer(const Timer&) = delete;
+	auto operator=(const Timer&) -> Timer& = delete;
+
+	[[nodiscard]] auto armed() const noexcept -> bool
+	{
+		return wheel != nullptr;
+	}
+
+	/// Called by TimerWheel::advance(now) when no visitor is given
+	Callback callback = nullptr;
+
+    private:
+	friend class TimerWheel;
+
+	std::uint64_t deadline = 0; // in ticks
+	TimerWheel* wheel = nullptr;
+	std::uint8_t level = 0;
+	std::uint8_t slot = 0;
+};
+
+/// \brief A hierarchical hashed timer wheel (Varghese & Lauck).
+///
+/// Four levels of 256 slots cover 2^32 ticks; later deadlines wait in an
+/// overflow list. schedule() and cancel() are O(1). advance() skips empty
+/// stretches of time using per-level occupancy bitmaps, cascades timers
+/// down as their slot comes up, and delivers everything that expired in one
+/// batch after the wheel has been updated, so callbacks may re-arm or
+/// cancel any timer (including their own).
+///
+/// A timer fires on the first advance() at or after its deadline, rounded
+/// up to the tick resolution. The wheel is not thread-safe; attach() it to
+/// a Reactor to have it driven by a single timerfd from the loop thread.
+class TimerWheel {
+    public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr unsigned kLevels = 4;
+	static constexpr unsigned kSlotBits = 8;
+	static constexpr unsigned kSlots = 1U << kSlotBits;
+
+	explicit TimerWheel(
+	    std::chrono::nanoseconds resolution = std::chrono::milliseconds{ 1 },
+	    Clock::time_point start = Clock::now()
+	);
+	~TimerWheel();
+
+	TimerWheel(const TimerWheel&) = delete;
+	auto operator=(const TimerWheel&) -> TimerWheel& = delete;
+
+	/// \brief Arms \p timer for \p deadline, re-arming it if it is armed.
+	void schedule(Timer& timer, Clock::time_point deadline);
+
+	/// \brief Arms \p timer \p delay after the wheel's current time.
+	void schedule(Timer& timer, std::chrono::nanoseconds delay);
+
+	/// \brief Disarms \p timer; does nothing if it is not armed.
+	void cancel(Timer& timer) noexcept;
+
+	/// \brief Moves the wheel to \p now and calls `visitor(Timer&)` for
+	/// every timer that expired, in deadline order between ticks.
+	/// \returns the number of expired timers
+	template<typename TVisitor>
+	auto advance(Clock::time_point now, TVisitor&& visitor) -> std::size_t
+	{
+		IOCORE_ASSERT(!delivering);
+		collect_expired(to_tick_floor(now));
+
+		delivering = true;
+		std::size_t count = 0;
+		while (!expired.empty()) {
+			auto& timer = *static_cast<Timer*>(expired.next);
+			timer.unlink();
+			timer.wheel = nullptr;
+			--timer_count;
+			++count;
+			visitor(timer);
+		}
+		delivering = false;
+		return count;
+	}
+
+	/// \brief As above, calling each expired timer's own callback.
+	auto advance(Clock::time_point now) -> std::size_t;
+
+	/// \brief A lower bound for the next deadline (exact when it is
+	/// less than 256 ticks away), or nothing when no timer is armed.
+	[[nodiscard]] auto nextDeadline() const -> std::optional<Clock::time_point>;
+
+	[[nodiscard]] auto size() const noexcept -> std::size_t
+	{
+		return timer_count;
+	}
+
+	[[nodiscard]] auto now() const noexcept -> Clock::time_point
+	{
+		return to_time(current_tick);
+	}
+
+	/// \brief Drives the wheel from \p reactor's loop using one timerfd,
+	/// kept armed for nextDeadline(). Must be called on the loop thread,
+	/// as must schedule() and cancel() afterwards.
+	void attach(Reactor& reactor);
+	void detach() noexcept;
+
+    private:
+	static constexpr std::uint8_t kOverflowLevel = kLevels;
+	static constexpr std::uint8_t kExpiredLevel = kLevels + 1;
+	static constexpr std::uint64_t kNoTick = ~std::uint64_t{ 0 };
+
+	using Bitmap = std::array<std::uint64_t, kSlots / 64>;
+
+	[[nodiscard]] auto to_tick_floor(Clock::time_point time) const
+	    -> std::uint64_t;
+	[[nodiscard]] auto to_tick_ceil(Clock::time_point time) const
+	    -> std::uint64_t;
+	[[nodiscard]] auto to_time(std::uint64_t tick) const noexcept
+	    -> Clock::time_point;
+
+	void insert(Timer& timer);
+	void cascade(unsigned level, unsigned slot);
+	void collect_expired(std::uint64_t target);
+	[[nodiscard]] auto next_event_tick() const noexcept -> std::uint64_t;
+	void rearm_reactor_timer();
+
+	Clock::time_point origin;
+	std::chrono::nanoseconds resolution;
+	std::uint64_t current_tick = 0;
+	std::size_t timer_count = 0;
+	bool delivering = false;
+
+	std::array<std::array<timer_detail::ListHook, kSlots>, kLevels> wheels;
+	std::array<Bitmap, kLevels> occupied{};
+	timer_detail::ListHook overflow;
+	timer_detail::ListHook expired;
+
+	Reactor* reactor = nullptr;
+	Reactor::SourceId reactor_timer = 0;
+	std::uint64_t armed_tick = kNoTick;
+};
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
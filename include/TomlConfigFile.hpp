@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include <memory>
+
 #include "FileResource.hpp"
 #include "TomlTable.hpp"
 
@@ -22,7 +24,15 @@ class TomlConfigFile : public FileResource {
 	);
 	~TomlConfigFile() override;
 
+	/// \brief Loads the file into getTomlTable(). Parsed files are shared
+	/// through ParsedConfigCache::global(), so an unchanged file is only
+	/// copied, not re-read. An empty file leaves the table as it was.
 	auto read() -> IOCore::TomlTable&;
+
+	/// \brief The file's parsed contents, straight from the cache and
+	/// without copying; getTomlTable() is left untouched.
+	auto readShared() const -> std::shared_ptr<const IOCore::TomlTable>;
+
 	void write();
 
 	template<typename T>
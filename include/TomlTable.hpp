@@ -93,7 +93,8 @@ inline auto operator>>(const std::istream& input_stream, TomlTable& table)
 {
 	std::stringstream buffer;
 	buffer << input_stream.rdbuf();
-	table = toml::parse(buffer.str());
+	// view() parses the buffer in place instead of copying it out first
+	table = toml::parse(buffer.view());
 	return input_stream;
 } // @}
 } // @}
@@ -0,0 +1,128 @@
+/* WatchedTomlConfigFile.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ConfigSubscriptions.hpp"
+#include "FileResource.hpp"
+#include "FileWatcher.hpp"
+#include "Reactor.hpp"
+#include "TomlTable.hpp"
+#include "sys/epoch.hpp"
+
+namespace IOCore {
+
+/// \brief A TOML config file that can be re-read while other threads use it.
+///
+/// Every parse produces a new immutable TomlTable, published by swapping an
+/// atomic pointer (see RcuPointer); tables are freed once no reader can see
+/// them. Readers call snapshot() and hold the result briefly:
+///
+/// \code
+/// auto config = watched.snapshot();
+/// auto port = (*config)["server"]["port"].value_or(8080);
+/// \endcode
+///
+/// watch() re-reads the file whenever it changes on disk. A file that fails
+/// to parse leaves the previous snapshot in place. Each reload is diffed
+/// against the previous table, and only subscribers whose keys changed are
+/// called (see ConfigSubscriptions).
+class WatchedTomlConfigFile : public FileResource {
+    public:
+	using Snapshot = RcuPointer<TomlTable>::ReadGuard;
+
+	/// \brief Parses \p file_path once (a missing or empty file gives an
+	/// empty table).
+	/// \throws IOCore::Exception if the file cannot be parsed
+	WatchedTomlConfigFile(
+	    const std::filesystem::path& file_path,
+	    CreateDirs mode = CreateDirs::Disable
+	);
+	~WatchedTomlConfigFile() override;
+
+	/// \brief Pins the current table; lock-free and contention-free.
+	[[nodiscard]] auto snapshot() const -> Snapshot
+	{
+		return this->current.read();
+	}
+
+	/// \brief Calls \p callback with the new table after any reload that
+	/// changes \p path (a dotted key path such as "server.port") or
+	/// anything beneath it.
+	auto subscribe(std::string_view path, ConfigSubscriptions::Callback callback)
+	    -> ConfigSubscriptions::SubscriptionId
+	{
+		return this->subscriptions.subscribe(path, std::move(callback));
+	}
+	void unsubscribe(ConfigSubscriptions::SubscriptionId id)
+	{
+		this->subscriptions.unsubscribe(id);
+	}
+
+	/// \brief Parses the file and publishes the result.
+	/// \throws IOCore::Exception if it cannot be parsed; the current
+	/// snapshot is kept
+	void reload();
+
+	/// \brief Reloads from \p reactor's loop whenever the file is written
+	/// or replaced. Must be called on the loop thread.
+	///
+	/// A file that fails to parse is counted in failedReloads(); an
+	/// exception from on_reloaded() or a subscriber propagates out of
+	/// the reactor's run instead.
+	void watch(Reactor& reactor);
+	void unwatch() noexcept { this->watcher.reset(); }
+
+	/// \brief Incremented by every successful reload (starting at 1).
+	[[nodiscard]] auto generation() const noexcept -> std::uint64_t
+	{
+		return this->published.load(std::memory_order_acquire);
+	}
+
+	/// \brief Reloads triggered by watch() that failed to parse.
+	[[nodiscard]] auto failedReloads() const noexcept -> std::uint64_t
+	{
+		return this->failures.load(std::memory_order_relaxed);
+	}
+
+    protected:
+	/// \brief Called after each successful reload with the new table and
+	/// the paths that changed (see diff_toml()), on the thread that
+	/// reloaded. Reloads are serialized, so calls arrive in generation
+	/// order.
+	virtual void on_reloaded(
+	    const TomlTable& table, const std::vector<std::string>& changed_paths
+	);
+
+    private:
+	[[nodiscard]] auto parse() const -> std::unique_ptr<const TomlTable>;
+	// Publishes \p table and runs the callbacks; needs reload_mutex
+	void publish_locked(std::unique_ptr<const TomlTable> table);
+
+	std::mutex reload_mutex;
+	RcuPointer<TomlTable> current;
+	std::atomic<std::uint64_t> published{ 1 };
+	std::atomic<std::uint64_t> failures{ 0 };
+	std::unique_ptr<FileWatcher> watcher;
+	ConfigSubscriptions subscriptions;
+};
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
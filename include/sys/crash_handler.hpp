@@ -0,0 +1,40 @@
+/* crash_handler.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+namespace IOCore {
+
+/// \brief Installs SIGSEGV, SIGBUS, SIGILL, SIGABRT and SIGFPE handlers that
+/// write a crash report to \p output_fd, then re-raise the signal.
+///
+/// The handler only uses async-signal-safe calls and never allocates. The
+/// report holds the signal, faulting address, thread id, the interrupted
+/// instruction as frame 0 followed by raw return addresses, and (on Linux)
+/// the process memory map, so that the `iocore-symbolize` tool can turn it
+/// into a readable trace later.
+///
+/// Also gives the calling thread an alternate signal stack, so stack
+/// overflows can be reported; other threads should call
+/// prepare_crash_handler_thread().
+///
+/// \throws IOCore::Exception if the handlers cannot be installed
+void install_crash_handler(int output_fd = 2);
+
+/// \brief Restores the signal handlers replaced by install_crash_handler()
+void uninstall_crash_handler();
+
+/// \brief Gives the calling thread its own preallocated alternate signal
+/// stack and warms up the stack walker for it.
+void prepare_crash_handler_thread();
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8  noexpandtab ft=cpp.doxygen :
@@ -8,10 +8,65 @@
  */
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <string>
 
 namespace IOCore {
 
+constexpr std::size_t kMaxStackFrames = 128;
+
+/// \brief The raw return addresses of a call stack.
+///
+/// Capturing these is cheap; turning them into text is not. Keep one of these
+/// around and call symbolize_stacktrace() only when the text is needed.
+struct StackFrames {
+	std::array<void*, kMaxStackFrames> addresses{};
+	unsigned short count = 0;
+
+	[[nodiscard]] auto begin() const noexcept { return addresses.begin(); }
+	[[nodiscard]] auto end() const noexcept
+	{
+		return addresses.begin() + count;
+	}
+	[[nodiscard]] auto empty() const noexcept -> bool { return count == 0; }
+};
+
+auto capture_stackframes(unsigned short framesToRemove = 1) noexcept
+    -> StackFrames;
+
+/// \brief Captures return addresses by following the saved frame-pointer
+/// chain instead of unwinding with DWARF CFI.
+///
+/// This costs a few loads per frame, but is only complete when every frame
+/// on the stack was compiled with `-fno-omit-frame-pointer`. The walk stops
+/// at \p maxDepth, at a null frame, or at the first frame pointer that is
+/// misaligned, not moving towards the stack base, or outside the current
+/// thread's stack. It does not allocate once the thread's stack bounds are
+/// known (the first call on each thread looks them up).
+///
+/// \returns the number of addresses written to \p buffer
+auto walk_frame_pointers(
+    void** buffer, std::size_t maxDepth, unsigned short framesToRemove = 0
+) noexcept -> std::size_t;
+
+/// \brief Walks the frame-pointer chain starting at \p framePointer, e.g.
+/// the one saved in a signal handler's ucontext.
+///
+/// Async-signal-safe: it only checks the thread's stack bounds if an
+/// earlier walk_frame_pointers() call on this thread already looked them up.
+auto walk_frame_pointers_from(
+    const void* framePointer, void** buffer, std::size_t maxDepth
+) noexcept -> std::size_t;
+
+/// \brief StackFrames-returning wrapper around walk_frame_pointers().
+///
+/// capture_stackframes() uses this automatically when the library was
+/// configured with USE_FRAME_POINTER_UNWINDER (HAVE_FRAME_POINTERS).
+auto capture_stackframes_fp(unsigned short framesToRemove = 1) noexcept
+    -> StackFrames;
+auto symbolize_stacktrace(const StackFrames& frames) -> std::string;
+
 auto generate_stacktrace(unsigned short framesToRemove = 1) -> std::string;
 
 void print_cmdline(int argc, const char* argv[]);
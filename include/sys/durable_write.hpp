@@ -0,0 +1,74 @@
+/* durable_write.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+namespace IOCore {
+
+/// \brief How write_file_atomically() makes a rename durable.
+enum class SyncMode {
+	/// Every write fsyncs its directory itself
+	PerWrite,
+	/// Concurrent writes into one directory share a directory fsync:
+	/// writes that finish their rename while one is running are all
+	/// covered by the next, so N writers cost about two fsyncs, not N
+	GroupCommit
+};
+
+/// \brief Replaces \p path with \p contents so that, after a crash, it
+/// holds either the old or the new contents, never a mix.
+///
+/// The data goes to a temporary file beside \p path, which is
+/// fdatasync()ed and renamed over it before the directory is fsynced, so
+/// the call returns only once the new contents are on stable storage. An
+/// existing file keeps its permission bits; a symlink keeps pointing at
+/// the (replaced) file it names.
+///
+/// \throws IOCore::Exception naming the failed step; \p path is then
+/// untouched, unless only the directory fsync failed
+void write_file_atomically(
+    const std::filesystem::path& path,
+    std::string_view contents,
+    SyncMode mode = SyncMode::PerWrite
+);
+
+/// \brief fsyncs \p directory, making renames into it durable.
+/// \throws IOCore::Exception if the directory cannot be opened or synced
+void sync_directory(
+    const std::filesystem::path& directory, SyncMode mode = SyncMode::PerWrite
+);
+
+struct DirectorySyncStats {
+	std::uint64_t requests = 0; ///< sync_directory() calls
+	std::uint64_t syncs = 0;    ///< fsync()s those calls issued
+};
+
+/// \brief Process-wide counters, to see how well group commit batches.
+auto directory_sync_stats() noexcept -> DirectorySyncStats;
+
+namespace durable_write_detail {
+enum class SyncEvent {
+	Joined,  ///< a group-commit writer joined a batch, under its lock
+	Syncing, ///< a directory fsync is about to start
+};
+using SyncHook = void (*)(SyncEvent event);
+
+/// \brief Installs \p hook, called at each SyncEvent; nullptr removes it.
+/// Lets tests hold a sync open while writers gather; not for production.
+void set_sync_hook(SyncHook hook) noexcept;
+} // namespace durable_write_detail
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
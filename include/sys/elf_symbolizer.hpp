@@ -0,0 +1,89 @@
+/* elf_symbolizer.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace IOCore {
+
+struct SymbolInfo {
+	std::string function;       ///< demangled, empty if unknown
+	std::string file;           ///< empty if there is no line table
+	unsigned line = 0;
+	std::string module;         ///< path of the ELF object
+	std::uintptr_t offset = 0;  ///< byte offset into \ref function
+};
+
+/// \brief In-process ELF symbol table and DWARF line table reader.
+///
+/// Each ELF object is mapped and indexed on first use, then every lookup is
+/// a binary search over sorted address tables. No helper processes are
+/// spawned, which makes this usable on hot exception paths.
+class ElfSymbolizer {
+    public:
+	/// \brief Symbolizer for the objects loaded in this process
+	static auto global() -> ElfSymbolizer&;
+
+	ElfSymbolizer();
+	~ElfSymbolizer();
+
+	ElfSymbolizer(const ElfSymbolizer&) = delete;
+	auto operator=(const ElfSymbolizer&) -> ElfSymbolizer& = delete;
+
+	/// \brief Resolves an address in this process' address space
+	/// \returns std::nullopt if no loaded object contains \p address
+	auto resolve(const void* address) -> std::optional<SymbolInfo>;
+
+	/// \brief Resolves a link-time (file) address in an ELF file on disk
+	auto resolveInFile(
+	    const std::filesystem::path& elf_file, std::uintptr_t file_address
+	) -> std::optional<SymbolInfo>;
+
+	/// \brief Resolves a byte offset into an ELF file on disk, such as
+	/// the ones derived from a process memory map
+	auto resolveFileOffset(
+	    const std::filesystem::path& elf_file, std::uint64_t file_offset
+	) -> std::optional<SymbolInfo>;
+
+	/// \brief Drops every loaded module and indexed image, so the next
+	/// lookup starts cold.
+	/// \warning Not safe while other threads are resolving; meant for
+	/// tests and benchmarks.
+	void clear();
+
+	class ElfImage;
+
+    private:
+	struct LoadedModule {
+		std::string path;
+		std::uintptr_t bias = 0;
+		std::vector<std::pair<std::uintptr_t, std::uintptr_t>> ranges;
+	};
+
+	auto find_module(std::uintptr_t address) -> const LoadedModule*;
+	auto image_for(const std::string& path) -> ElfImage*;
+	void enumerate_modules();
+
+	std::mutex mutex;
+	std::vector<LoadedModule> modules;
+	std::vector<std::pair<std::string, std::unique_ptr<ElfImage>>> images;
+};
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8  noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,150 @@
+/* epoch.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace IOCore {
+
+/// \brief Marks the calling thread as reading epoch-protected data.
+///
+/// Process-wide epoch-based reclamation: while any guard entered before a
+/// retirement is alive, data retired at that point is not freed. Entering
+/// is a store and a fence on a cache line owned by the calling thread, so
+/// readers never contend with each other or with writers. Guards nest and
+/// must be destroyed on the thread that created them.
+///
+/// \throws IOCore::Exception if more than kMaxEpochThreads threads hold
+/// guards at once
+class EpochGuard {
+    public:
+	EpochGuard();
+	~EpochGuard();
+
+	EpochGuard(const EpochGuard&) = delete;
+	auto operator=(const EpochGuard&) -> EpochGuard& = delete;
+};
+
+constexpr std::size_t kMaxEpochThreads = 256;
+
+/// \brief Starts a new epoch, to be called after unpublishing data.
+/// \returns the retirement epoch to pass to epoch_reached()
+auto epoch_advance() noexcept -> std::uint64_t;
+
+/// \brief True once no guard entered at or before \p retired is alive, so
+/// data retired then can be freed.
+auto epoch_reached(std::uint64_t retired) noexcept -> bool;
+
+/// \brief Blocks until epoch_reached(\p retired).
+void epoch_synchronize(std::uint64_t retired) noexcept;
+
+/// \brief A pointer to an immutable \p T, replaced wholesale by writers.
+///
+/// read() pins the current value with an EpochGuard; it takes no lock and
+/// touches no shared reference count. publish() swaps in a new value and
+/// frees old ones once every reader that could see them has finished.
+/// Keep read guards short: an old value lives as long as its last reader.
+template<typename T>
+class RcuPointer {
+    public:
+	class ReadGuard {
+	    public:
+		ReadGuard(const ReadGuard&) = delete;
+		auto operator=(const ReadGuard&) -> ReadGuard& = delete;
+
+		[[nodiscard]] auto get() const noexcept -> const T*
+		{
+			return value;
+		}
+		auto operator->() const noexcept -> const T* { return value; }
+		auto operator*() const noexcept -> const T& { return *value; }
+
+	    private:
+		friend class RcuPointer;
+		explicit ReadGuard(const std::atomic<const T*>& current)
+		    : value(current.load(std::memory_order_acquire))
+		{
+		}
+
+		// Declared first, so the epoch is entered before the load
+		EpochGuard guard;
+		const T* value;
+	};
+
+	explicit RcuPointer(std::unique_ptr<const T> initial)
+	    : current(initial.release())
+	{
+	}
+
+	~RcuPointer()
+	{
+		auto retired = epoch_advance();
+		epoch_synchronize(retired);
+		delete current.load(std::memory_order_relaxed);
+		for (auto& entry : retired_values) {
+			delete entry.second;
+		}
+	}
+
+	RcuPointer(const RcuPointer&) = delete;
+	auto operator=(const RcuPointer&) -> RcuPointer& = delete;
+
+	[[nodiscard]] auto read() const -> ReadGuard
+	{
+		return ReadGuard(current);
+	}
+
+	/// \brief Makes \p next the value seen by new readers. Writers are
+	/// serialized; readers are never blocked.
+	void publish(std::unique_ptr<const T> next)
+	{
+		std::lock_guard lock(writer_mutex);
+		const T* previous =
+		    current.exchange(next.release(), std::memory_order_acq_rel);
+		retired_values.emplace_back(epoch_advance(), previous);
+		collect_locked();
+	}
+
+	/// \brief Frees retired values no reader can still see.
+	/// \returns how many are still waiting for readers
+	auto collect() -> std::size_t
+	{
+		std::lock_guard lock(writer_mutex);
+		collect_locked();
+		return retired_values.size();
+	}
+
+    private:
+	void collect_locked()
+	{
+		std::erase_if(retired_values, [](const auto& entry) {
+			if (!epoch_reached(entry.first)) {
+				return false;
+			}
+			delete entry.second;
+			return true;
+		});
+	}
+
+	std::atomic<const T*> current;
+	std::mutex writer_mutex;
+	std::vector<std::pair<std::uint64_t, const T*>> retired_values;
+};
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
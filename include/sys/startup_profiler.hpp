@@ -0,0 +1,71 @@
+/* startup_profiler.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace IOCore {
+
+/// Environment variable naming the file the startup trace is written to;
+/// setting it also turns profiling on
+constexpr auto kStartupTraceVariable = "IOCORE_STARTUP_TRACE";
+
+/// \brief Times one named phase of process startup.
+///
+/// While profiling is off (the default unless IOCORE_STARTUP_TRACE is set)
+/// constructing a phase costs one relaxed atomic load. Phases may nest and
+/// may run on any thread; \p name must outlive the program (a literal).
+class StartupPhase {
+    public:
+	explicit StartupPhase(std::string_view name, std::string_view detail = {});
+	~StartupPhase();
+
+	StartupPhase(const StartupPhase&) = delete;
+	auto operator=(const StartupPhase&) -> StartupPhase& = delete;
+
+    private:
+	std::string_view name;
+	std::string detail;
+	std::chrono::steady_clock::time_point start;
+	bool recording = false;
+};
+
+/// \brief True when phases are being recorded.
+auto startup_profiling_enabled() noexcept -> bool;
+
+/// \brief Starts or stops recording phases, whatever the environment says.
+void enable_startup_profiling(bool enabled = true) noexcept;
+
+/// \brief The recorded phases as Chrome trace-event JSON, loadable in
+/// chrome://tracing or Perfetto. Timestamps are microseconds since the
+/// profiler was initialized, during static initialization.
+auto startup_trace_json() -> std::string;
+
+/// \brief Writes startup_trace_json() to \p path.
+/// \throws IOCore::Exception if the file cannot be written
+void write_startup_trace(const std::filesystem::path& path);
+
+/// \brief Writes the trace to the file named by IOCORE_STARTUP_TRACE, if
+/// set; only the first call writes, then turns profiling off and drops
+/// the recorded phases. Application calls this when run() starts its
+/// loop, and again on destruction for applications that never call the
+/// base run().
+void flush_startup_trace();
+
+/// \brief Forgets every recorded phase.
+void clear_startup_trace();
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,78 @@
+/* symbol_cache.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace IOCore {
+
+struct SymbolCacheStats {
+	std::uint64_t hits = 0;
+	std::uint64_t misses = 0;
+	std::uint64_t entries = 0;
+	std::uint64_t rejected = 0; ///< inserts dropped because the table is full
+};
+
+/// \brief Fixed-size, process-wide map of return address -> formatted frame.
+///
+/// Lookups are lock-free and never allocate. Inserts claim a slot with a
+/// single CAS; once claimed, a slot is never reused, so the text pointer a
+/// reader gets back stays valid for the life of the process.
+class SymbolCache {
+    public:
+	static constexpr std::size_t kCapacity = 4096;
+	static constexpr std::size_t kMaxProbes = 16;
+
+	static auto global() noexcept -> SymbolCache&;
+
+	SymbolCache() = default;
+	~SymbolCache();
+
+	SymbolCache(const SymbolCache&) = delete;
+	auto operator=(const SymbolCache&) -> SymbolCache& = delete;
+
+	/// \returns the cached text for \p address, or nullptr on a miss.
+	auto lookup(const void* address) noexcept -> const char*;
+
+	/// \brief Publishes \p text for \p address.
+	/// \returns the stored copy, or nullptr if the table had no room.
+	auto insert(const void* address, std::string_view text) -> const char*;
+
+	[[nodiscard]] auto getStats() const noexcept -> SymbolCacheStats;
+
+	/// \brief Drops every entry and resets the counters.
+	/// \warning Not safe while other threads are using the cache; meant
+	/// for tests and cold-cache benchmarks.
+	void clear() noexcept;
+
+    private:
+	struct Slot {
+		std::atomic<const void*> address{ nullptr };
+		std::atomic<const char*> text{ nullptr };
+	};
+
+	static auto slot_index(const void* address) noexcept -> std::size_t;
+
+	std::array<Slot, kCapacity> slots;
+
+	alignas(64) std::atomic<std::uint64_t> hits{ 0 };
+	alignas(64) std::atomic<std::uint64_t> misses{ 0 };
+	std::atomic<std::uint64_t> entries{ 0 };
+	std::atomic<std::uint64_t> rejected{ 0 };
+};
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8  noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,99 @@
+/* throw_sites.hpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "sys/debuginfo.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace IOCore {
+
+struct ThrowSiteStats {
+	std::uint64_t hash = 0;
+	std::uint64_t count = 0;
+	std::chrono::system_clock::time_point first_seen;
+	std::chrono::system_clock::time_point last_seen;
+	std::string stack_trace; ///< empty until one throw was symbolized
+};
+
+/// \brief Process-wide table of distinct throw sites, keyed by a hash of the
+/// captured stack frames.
+///
+/// Recording a throw is lock-free: one CAS to claim a slot the first time a
+/// site is seen, then relaxed atomic updates. The first symbolized trace for
+/// a site is kept and reused by later exceptions thrown from the same stack.
+class ThrowSiteRegistry {
+    public:
+	static constexpr std::size_t kCapacity = 1024;
+	static constexpr std::size_t kMaxProbes = 16;
+
+	class Site {
+	    public:
+		/// \returns the canonical trace, or nullptr if none yet
+		[[nodiscard]] auto stackTrace() const noexcept
+		    -> const std::string*
+		{
+			return trace.load(std::memory_order_acquire);
+		}
+
+		/// \brief Offers \p text as the canonical trace.
+		/// \returns the trace that won, which may be another
+		/// thread's
+		auto publishStackTrace(std::string text) -> const std::string*;
+
+	    private:
+		friend class ThrowSiteRegistry;
+
+		std::atomic<std::uint64_t> hash{ 0 };
+		std::atomic<std::uint64_t> count{ 0 };
+		std::atomic<std::int64_t> first_seen_ns{ 0 };
+		std::atomic<std::int64_t> last_seen_ns{ 0 };
+		std::atomic<const std::string*> trace{ nullptr };
+	};
+
+	static auto global() noexcept -> ThrowSiteRegistry&;
+
+	ThrowSiteRegistry() = default;
+	~ThrowSiteRegistry();
+
+	ThrowSiteRegistry(const ThrowSiteRegistry&) = delete;
+	auto operator=(const ThrowSiteRegistry&) -> ThrowSiteRegistry& = delete;
+
+	static auto hashFrames(const StackFrames& frames) noexcept
+	    -> std::uint64_t;
+
+	/// \brief Counts one throw from the stack in \p frames.
+	/// \returns the site, or nullptr if the table is full
+	auto record(const StackFrames& frames) noexcept -> Site*;
+
+	[[nodiscard]] auto snapshot() const -> std::vector<ThrowSiteStats>;
+
+	/// \brief Writes every site, most frequent first, as plain text
+	void dump(std::ostream& output) const;
+
+	/// \warning Not safe while exceptions recorded here are still alive
+	/// or other threads are throwing; meant for tests.
+	void clear() noexcept;
+
+    private:
+	std::array<Site, kCapacity> sites;
+};
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8  noexpandtab ft=cpp.doxygen :
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <algorithm>
+#include <source_location>
 
 #include <toml++/toml.hpp>
 
@@ -20,12 +21,19 @@ inline namespace TOML {
 
 struct TomlException : public IOCore::Exception {
 
-	TomlException()
-	    : IOCore::Exception("TOML Serialization/Deseralization Exception")
+	TomlException(std::source_location site = std::source_location::current())
+	    : IOCore::Exception(
+		  "TOML Serialization/Deseralization Exception",
+		  capturePolicy<TomlException>(),
+		  site
+	      )
 	{
 	}
-	explicit TomlException(const std::string& message)
-	    : IOCore::Exception(message)
+	explicit TomlException(
+	    const std::string& message,
+	    std::source_location site = std::source_location::current()
+	)
+	    : IOCore::Exception(message, capturePolicy<TomlException>(), site)
 	{
 	}
 	~TomlException() override = default;
@@ -9,19 +9,72 @@
 
 #include "Application.hpp"
 #include "Exception.hpp"
+#include "sys/startup_profiler.hpp"
 #include "types.hpp"
 
+#include <algorithm>
 #include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <vector>
 
 using namespace IOCore;
 
+#if !defined(__linux__)
+namespace {
+// Without signalfd, signals are turned into state-word updates by a handler
+std::atomic<Application*> signal_target{ nullptr };
+
+extern "C" void on_lifecycle_signal(int signal_number)
+{
+	auto* application = signal_target.load(std::memory_order_acquire);
+	if (application == nullptr) {
+		return;
+	}
+	if (signal_number == SIGHUP) {
+		application->requestReload();
+	} else {
+		application->requestShutdown();
+	}
+}
+} // namespace
+#endif
+
 std::atomic_bool Application::is_initialized = false;
 
 Application::~Application()
 {
+	if ((this->lifecycleState() & Draining) == 0) {
+		try {
+			this->shutdown();
+		} catch (...) { // NOLINT(bugprone-empty-catch)
+			// Task errors nobody waited for are dropped here
+		}
+	}
+	try {
+		flush_startup_trace();
+	} catch (...) { // NOLINT(bugprone-empty-catch)
+		// Profiling output is best-effort
+	}
+
+	// The thread-pool I/O engine waits for its work on the executor
+	this->io_engine.reset();
+
+	// Join the workers while the rest of the object (including the
+	// reactor their tasks may use) is intact
+	this->executor.reset();
+	this->scheduler.reset();
+	this->active_reactor.store(nullptr, std::memory_order_release);
+	this->reactor.reset();
+#if !defined(__linux__)
+	signal_target.store(nullptr, std::memory_order_release);
+#endif
 	Application::is_initialized = false;
 }
 
@@ -32,9 +85,14 @@ inline auto thread_safe_check(std::atomic_bool& flag) -> bool
 }
 
 Application::Application(
-    int argc, c::const_string argv[], c::const_string envp[]
+    int argc,
+    c::const_string argv[],
+    c::const_string envp[],
+    ArgumentStorage storage
 )
 {
+	StartupPhase phase("Application::Application");
+
 	if (thread_safe_check(is_initialized)) {
 		throw DoubleConstructionException("Application");
 	}
@@ -49,12 +107,281 @@ Application::Application(
 		throw IOCore::Exception(fatal_exception);
 	}
 
-	this->read_arguments(argc, argv);
-	this->create_env_dictionary(envp);
+	c::count_t arg_count = (argc > 0) ? static_cast<c::count_t>(argc) : 0;
+
+	if (storage == ArgumentStorage::InPlace) {
+		c::count_t env_count = 0;
+		while (envp[env_count] != nullptr) {
+			++env_count;
+		}
+		this->argument_list = { argv, arg_count };
+		this->environment_list = { envp, env_count };
+	} else {
+		this->pack_into_arena(arg_count, argv, envp);
+	}
+}
+
+// Lays out both pointer arrays (each null-terminated) followed by the
+// characters of every string, all in a single allocation.
+void Application::pack_into_arena(
+    c::count_t argc, c::const_string argv[], c::const_string envp[]
+)
+{
+	StartupPhase phase("Application::pack_into_arena");
+
+	c::count_t env_count = 0;
+	c::count_t text_size = 0;
+
+	for (c::count_t index = 0; index < argc; ++index) {
+		text_size += std::strlen(argv[index]) + 1;
+	}
+	for (; envp[env_count] != nullptr; ++env_count) {
+		text_size += std::strlen(envp[env_count]) + 1;
+	}
+
+	auto pointer_count = argc + 1 + env_count + 1;
+	auto pointer_bytes = pointer_count * sizeof(c::const_string);
+	this->argument_arena =
+	    std::make_unique_for_overwrite<char[]>(pointer_bytes + text_size);
+
+	auto* pointers =
+	    reinterpret_cast<c::const_string*>(this->argument_arena.get());
+	char* text = this->argument_arena.get() + pointer_bytes;
+
+	auto copy_strings = [&pointers, &text](
+				c::const_string source[], c::count_t count
+			    ) {
+		auto* first = pointers;
+		for (c::count_t index = 0; index < count; ++index) {
+			auto length = std::strlen(source[index]) + 1;
+			std::memcpy(text, source[index], length);
+			*pointers++ = text;
+			text += length;
+		}
+		*pointers++ = nullptr;
+		return first;
+	};
+
+	this->argument_list = { copy_strings(argv, argc), argc };
+	this->environment_list = { copy_strings(envp, env_count), env_count };
+}
+
+auto Application::getArguments() const -> const std::vector<std::string>&
+{
+	std::call_once(this->arguments_copied, [this]() {
+		const_cast<Application*>(this)->read_arguments(
+		    static_cast<int>(this->argument_list.size()),
+		    this->argument_list.data()
+		);
+	});
+	return this->arguments;
+}
+
+auto Application::getEnvironment() const
+    -> const Dictionary<const std::string>&
+{
+	std::call_once(this->environment_copied, [this]() {
+		// environment_list is always followed by its null terminator
+		const_cast<Application*>(this)->create_env_dictionary(
+		    this->environment_list.data()
+		);
+	});
+	return this->environment_variables;
+}
+
+auto Application::getExecutor() -> Executor&
+{
+	std::call_once(this->executor_started, [this]() {
+		this->executor = std::make_unique<Executor>();
+	});
+	return *this->executor;
+}
+
+auto Application::getReactor() -> Reactor&
+{
+	std::call_once(this->reactor_created, [this]() {
+		this->reactor = std::make_unique<Reactor>();
+		this->active_reactor.store(
+		    this->reactor.get(), std::memory_order_release
+		);
+	});
+	return *this->reactor;
+}
+
+auto Application::getScheduler() -> Scheduler&
+{
+	std::call_once(this->scheduler_created, [this]() {
+#if defined(__linux__)
+		this->scheduler = std::make_unique<Scheduler>(
+		    this->getExecutor(), &this->getReactor()
+		);
+#else
+		// No reactor elsewhere; only the executor side is usable
+		this->scheduler = std::make_unique<Scheduler>(
+		    this->getExecutor()
+		);
+#endif
+	});
+	return *this->scheduler;
+}
+
+auto Application::getIoEngine() -> IoEngine&
+{
+	std::call_once(this->io_engine_created, [this]() {
+		this->io_engine = IoEngine::create(this->getExecutor());
+#if defined(__linux__)
+		this->io_engine->attach(this->getReactor());
+#endif
+	});
+	return *this->io_engine;
+}
+
+void Application::initializeSubsystems()
+{
+	StartupPhase phase("Application::initializeSubsystems");
+	this->subsystems.initialize(this->getExecutor());
+}
+
+void Application::handleSignals()
+{
+#if defined(__linux__)
+	if (this->executor) {
+		throw IOCore::Exception(
+		    "handleSignals() must be called before the executor starts"
+		);
+	}
+	auto& loop = this->getReactor();
+	for (int signal_number : { SIGTERM, SIGINT }) {
+		loop.addSignal(signal_number, [this](std::uint64_t) {
+			this->requestShutdown();
+		});
+	}
+	loop.addSignal(SIGHUP, [this](std::uint64_t) {
+		this->requestReload();
+		this->onReload();
+	});
+#else
+	signal_target.store(this, std::memory_order_release);
+
+	struct sigaction action {};
+	action.sa_handler = on_lifecycle_signal;
+	sigemptyset(&action.sa_mask);
+	for (int signal_number : { SIGTERM, SIGINT, SIGHUP }) {
+		if (::sigaction(signal_number, &action, nullptr) != 0) {
+			throw IOCore::Exception(
+			    std::string("sigaction() failed: ") +
+			    std::strerror(errno)
+			);
+		}
+	}
+#endif
+}
+
+void Application::requestShutdown(int exit_code) noexcept
+{
+	auto previous = this->lifecycle_state.fetch_or(
+	    ShutdownRequested, std::memory_order_acq_rel
+	);
+	if ((previous & ShutdownRequested) != 0) {
+		return;
+	}
+	if (auto* loop = this->active_reactor.load(std::memory_order_acquire)) {
+		loop->stop(exit_code);
+	}
+}
+
+auto Application::drain() -> bool
+{
+	this->lifecycle_state.fetch_or(Draining, std::memory_order_acq_rel);
+	if (!this->executor) {
+		return true;
+	}
+	if (this->executor->waitIdleFor(this->drain_timeout)) {
+		return true;
+	}
+	this->executor->discardQueued();
+	return false;
+}
+
+void Application::shutdown()
+{
+	try {
+		flush_startup_trace();
+	} catch (...) { // NOLINT(bugprone-empty-catch)
+		// Profiling output is best-effort
+	}
+	this->drain();
+}
+
+auto Application::run() -> int
+{
+	// Startup ends where the main loop begins
+	flush_startup_trace();
+	auto exit_code = this->getReactor().run();
+	this->shutdown();
+	return exit_code;
+}
+
+auto Application::getArgument(std::size_t index) const noexcept
+    -> std::string_view
+{
+	if (index >= this->argument_list.size()) {
+		return {};
+	}
+	return this->argument_list[index];
+}
+
+auto Application::getEnv(std::string_view name) const
+    -> std::optional<std::string_view>
+{
+	std::call_once(this->env_index_built, [this]() {
+		this->build_env_index();
+	});
+
+	auto found = std::lower_bound(
+	    this->env_index.begin(),
+	    this->env_index.end(),
+	    name,
+	    [](const EnvEntry& entry, std::string_view key) {
+		    return entry.name < key;
+	    }
+	);
+	if (found == this->env_index.end() || found->name != name) {
+		return std::nullopt;
+	}
+	return found->value;
+}
+
+void Application::build_env_index() const
+{
+	StartupPhase phase("Application::build_env_index");
+
+	this->env_index.reserve(this->environment_list.size());
+
+	for (std::string_view encoded_pair : this->environment_list) {
+		auto equal_character_pos = encoded_pair.find('=');
+		if (equal_character_pos != encoded_pair.npos) {
+			this->env_index.push_back(
+			    { encoded_pair.substr(0, equal_character_pos),
+			      encoded_pair.substr(equal_character_pos + 1) }
+			);
+		}
+	}
+
+	// Stable, so the first of several duplicate names is found first
+	std::stable_sort(
+	    this->env_index.begin(),
+	    this->env_index.end(),
+	    [](const EnvEntry& left, const EnvEntry& right) {
+		    return left.name < right.name;
+	    }
+	);
 }
 
 void Application::read_arguments(int argc, c::const_string argv[])
 {
+	StartupPhase phase("Application::read_arguments");
+
 	for (c::count_t index = 0; index < argc; ++index) {
 		this->arguments.emplace_back(argv[index]);
 	}
@@ -62,6 +389,8 @@ void Application::read_arguments(int argc, c::const_string argv[])
 
 void Application::create_env_dictionary(c::const_string envp[])
 {
+	StartupPhase phase("Application::create_env_dictionary");
+
 	for (c::count_t num = 0; envp[num] != nullptr; ++num) {
 		auto encoded_pair = std::string_view(envp[num]);
 
@@ -0,0 +1,47 @@
+/* Assert.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "Assert.hpp"
+
+#include "Exception.hpp"
+
+#include <string>
+
+#include <fmt/core.h>
+
+namespace IOCore {
+
+void assertion_failed(
+    std::string_view failed_condition,
+    std::string_view message,
+    const std::source_location& location
+)
+{
+	std::string error = fmt::format("{} is false!", failed_condition);
+
+	if (!message.empty()) {
+		error += fmt::format("\n\tassert_reason: {}", message);
+	}
+
+	throw AssertionException(
+	    error,
+	    fmt::format(
+		"{}:{} in {}",
+		location.file_name(),
+		location.line(),
+		location.function_name()
+	    ),
+	    location
+	);
+}
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
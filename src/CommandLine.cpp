@@ -0,0 +1,26 @@
+/* CommandLine.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "CommandLine.hpp"
+
+#include <fmt/core.h>
+
+namespace IOCore::CommandLine {
+
+void throw_command_line_error(
+    std::string_view problem, std::string_view argument
+)
+{
+	throw CommandLineException(fmt::format("{}: '{}'", problem, argument));
+}
+
+} // namespace IOCore::CommandLine
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,256 @@
+/* ConfigSubscriptions.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "ConfigSubscriptions.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using IOCore::ConfigSubscriptions;
+
+namespace {
+auto same_value(const toml::node& before, const toml::node& after) -> bool
+{
+	if (before.type() != after.type()) {
+		return false;
+	}
+	return before.visit([&after](const auto& lhs) {
+		using TNode = std::remove_cvref_t<decltype(lhs)>;
+		return lhs == static_cast<const TNode&>(after);
+	});
+}
+
+auto join_path(const std::string& prefix, std::string_view key) -> std::string
+{
+	if (prefix.empty()) {
+		return std::string(key);
+	}
+	std::string path;
+	path.reserve(prefix.size() + 1 + key.size());
+	path.append(prefix).append(1, '.').append(key);
+	return path;
+}
+
+void diff_tables(
+    const toml::table& before,
+    const toml::table& after,
+    const std::string& prefix,
+    std::vector<std::string>& changed
+)
+{
+	// Both tables iterate in key order, so walk them together like a merge
+	auto left = before.begin();
+	auto right = after.begin();
+	while (left != before.end() || right != after.end()) {
+		if (right == after.end() ||
+		    (left != before.end() && left->first < right->first)) {
+			changed.push_back(join_path(prefix, left->first.str()));
+			++left;
+			continue;
+		}
+		if (left == before.end() || right->first < left->first) {
+			changed.push_back(join_path(prefix, right->first.str()));
+			++right;
+			continue;
+		}
+
+		const auto& old_node = left->second;
+		const auto& new_node = right->second;
+		if (old_node.is_table() && new_node.is_table()) {
+			diff_tables(
+			    *old_node.as_table(),
+			    *new_node.as_table(),
+			    join_path(prefix, left->first.str()),
+			    changed
+			);
+		} else if (!same_value(old_node, new_node)) {
+			changed.push_back(join_path(prefix, left->first.str()));
+		}
+		++left;
+		++right;
+	}
+}
+
+// Calls \p visit for each '.'-separated segment; "" has none
+template<typename TVisitor>
+void for_each_segment(std::string_view path, TVisitor&& visit)
+{
+	while (!path.empty()) {
+		auto dot = path.find('.');
+		visit(path.substr(0, dot));
+		if (dot == std::string_view::npos) {
+			break;
+		}
+		path.remove_prefix(dot + 1);
+	}
+}
+} // namespace
+
+auto IOCore::diff_toml(const toml::table& before, const toml::table& after)
+    -> std::vector<std::string>
+{
+	std::vector<std::string> changed;
+	diff_tables(before, after, std::string{}, changed);
+	return changed;
+}
+
+ConfigSubscriptions::ConfigSubscriptions() = default;
+ConfigSubscriptions::~ConfigSubscriptions() = default;
+
+auto ConfigSubscriptions::subscribe(std::string_view path, Callback callback)
+    -> SubscriptionId
+{
+	std::lock_guard lock(mutex);
+
+	auto* node = &root;
+	for_each_segment(path, [&node](std::string_view segment) {
+		auto found = node->children.find(segment);
+		if (found == node->children.end()) {
+			found = node->children
+			            .emplace(
+				        std::string(segment),
+				        std::make_unique<PathNode>()
+			            )
+			            .first;
+		}
+		node = found->second.get();
+	});
+
+	auto id = next_id++;
+	node->subscribers.push_back(Subscriber{
+	    id, std::make_shared<const Callback>(std::move(callback)) });
+	path_by_id.emplace(id, std::string(path));
+	return id;
+}
+
+void ConfigSubscriptions::unsubscribe(SubscriptionId id)
+{
+	std::lock_guard lock(mutex);
+
+	auto entry = path_by_id.find(id);
+	if (entry == path_by_id.end()) {
+		return;
+	}
+
+	std::vector<std::pair<PathNode*, std::string_view>> trail;
+	auto* node = &root;
+	for_each_segment(entry->second, [&](std::string_view segment) {
+		trail.emplace_back(node, segment);
+		node = node->children.find(segment)->second.get();
+	});
+
+	std::erase_if(node->subscribers, [id](const Subscriber& subscriber) {
+		return subscriber.id == id;
+	});
+
+	// Prune nodes left with neither subscribers nor children
+	while (!trail.empty() && node->subscribers.empty() &&
+	       node->children.empty()) {
+		auto [parent, segment] = trail.back();
+		trail.pop_back();
+		parent->children.erase(parent->children.find(segment));
+		node = parent;
+	}
+	path_by_id.erase(entry);
+}
+
+void ConfigSubscriptions::collect_subtree(
+    const PathNode& node, std::vector<const Subscriber*>& found
+)
+{
+	for (const auto& subscriber : node.subscribers) {
+		found.push_back(&subscriber);
+	}
+	for (const auto& child : node.children) {
+		collect_subtree(*child.second, found);
+	}
+}
+
+auto ConfigSubscriptions::notify(
+    const std::vector<std::string>& changed_paths, const TomlTable& config
+) -> std::size_t
+{
+	std::vector<Subscriber> to_call;
+	{
+		std::lock_guard lock(mutex);
+		if (path_by_id.empty()) {
+			return 0;
+		}
+
+		std::vector<const Subscriber*> found;
+		for (const auto& path : changed_paths) {
+			// Subscribers on the path's ancestors see the change...
+			const auto* node = &root;
+			for_each_segment(path, [&](std::string_view segment) {
+				if (node == nullptr) {
+					return;
+				}
+				for (const auto& subscriber : node->subscribers) {
+					found.push_back(&subscriber);
+				}
+				auto child = node->children.find(segment);
+				node = (child == node->children.end())
+				           ? nullptr
+				           : child->second.get();
+			});
+			// ...and so do those on it or anywhere beneath it
+			if (node != nullptr) {
+				collect_subtree(*node, found);
+			}
+		}
+
+		std::sort(found.begin(), found.end(), [](auto* lhs, auto* rhs) {
+			return lhs->id < rhs->id;
+		});
+		found.erase(
+		    std::unique(
+			found.begin(),
+			found.end(),
+			[](auto* lhs, auto* rhs) { return lhs->id == rhs->id; }
+		    ),
+		    found.end()
+		);
+
+		to_call.reserve(found.size());
+		for (const auto* subscriber : found) {
+			to_call.push_back(*subscriber);
+		}
+	}
+
+	// One throwing subscriber must not hide the change from the rest
+	std::exception_ptr error;
+	for (const auto& subscriber : to_call) {
+		try {
+			(*subscriber.callback)(config);
+		} catch (...) {
+			if (!error) {
+				error = std::current_exception();
+			}
+		}
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	return to_call.size();
+}
+
+auto ConfigSubscriptions::size() const -> std::size_t
+{
+	std::lock_guard lock(mutex);
+	return path_by_id.size();
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -13,56 +13,234 @@
 #include "types.hpp"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <exception>
+#include <mutex>
+#include <new>
 #include <optional>
+#include <source_location>
+#include <sstream>
 #include <string>
+#include <string_view>
 
 #include <fmt/core.h>
+#include <fmt/format.h>
 
 using IOCore::Exception;
+using IOCore::StackCapture;
+using IOCore::StackCapturePolicy;
+using IOCore::StackFrames;
+using IOCore::ThrowSiteRegistry;
 
-constexpr unsigned kDEFAULT_STACKFRAMES_TO_STRIP = 3;
+#ifndef IOCORE_STACK_CAPTURE_MAX
+#define IOCORE_STACK_CAPTURE_MAX 2
+#endif
+
+// One extra frame for capture_stack() itself
+constexpr unsigned kDEFAULT_STACKFRAMES_TO_STRIP = 4;
+
+constexpr auto kMaxStackCapture =
+    static_cast<StackCapture>(IOCORE_STACK_CAPTURE_MAX);
 
 // Helper classes and functions. #region
+namespace {
+constexpr std::size_t kSampledSites = 1024;
 
-Exception::Exception(c::const_string error_message)
-    : std::exception()
-    , error_message(error_message)
-    , what_message()
-    , stack_trace(IOCore::generate_stacktrace(kDEFAULT_STACKFRAMES_TO_STRIP))
-    , inner_exception_ptr()
+// Throw counts for StackCapture::Sampled. Unrelated sites may share a
+// counter; that only skews which throw gets sampled, not the rate.
+std::array<std::atomic<std::uint32_t>, kSampledSites> sampled_site_counters;
+
+auto sample_throw_site(const std::source_location& site, unsigned rate) noexcept
+    -> bool
+{
+	// file_name() is a string literal, so its address names the file
+	auto key = reinterpret_cast<std::uintptr_t>(site.file_name());
+	key = (key ^ site.line()) * 0x9E3779B97F4A7C15ULL;
+	key ^= site.column();
+	auto& counter = sampled_site_counters[(key >> 32) % kSampledSites];
+
+	return counter.fetch_add(1, std::memory_order_relaxed) % rate == 0;
+}
+
+auto effective_capture_mode(
+    StackCapturePolicy& policy, const std::source_location& throw_site
+) noexcept -> StackCapture
+{
+	auto mode = policy.mode.load(std::memory_order_relaxed);
+
+	if (mode == StackCapture::Sampled) {
+		auto rate = policy.sample_rate.load(std::memory_order_relaxed);
+		mode = sample_throw_site(throw_site, rate)
+		           ? StackCapture::Symbolized
+		           : StackCapture::None;
+	}
+	return std::min(mode, kMaxStackCapture);
+}
+} // namespace
+
+struct Exception::Payload {
+	std::atomic<unsigned> references{ 1 };
+
+	std::string_view error_message;
+	std::string_view class_name;
+	std::string_view optional_data;
+
+	StackCapture capture_mode = StackCapture::None;
+	StackFrames stack_frames;
+	ThrowSiteRegistry::Site* throw_site = nullptr;
+	std::exception_ptr inner_exception_ptr;
+
+	// Built on the first what() or stacktrace(), shared by all copies
+	std::once_flag messages_built;
+	std::string what_message;
+	std::string stack_trace;
+
+	/// Allocates the payload and the text of its three strings as one
+	/// block; the string_views point just past the header and are each
+	/// followed by a '\0'.
+	static auto create(
+	    std::string_view error_message,
+	    std::string_view class_name = {},
+	    std::string_view optional_data = {}
+	) -> Payload*
+	{
+		auto text_size = error_message.size() + class_name.size() +
+		                 optional_data.size() + 3;
+		void* block = ::operator new(sizeof(Payload) + text_size);
+		auto* payload = new (block) Payload();
+		auto* text = reinterpret_cast<char*>(payload + 1);
+
+		auto append = [&text](std::string_view source) {
+			if (!source.empty()) {
+				std::memcpy(text, source.data(), source.size());
+			}
+			std::string_view copy(text, source.size());
+			text += source.size();
+			*text++ = '\0';
+			return copy;
+		};
+		payload->error_message = append(error_message);
+		payload->class_name = append(class_name);
+		payload->optional_data = append(optional_data);
+		return payload;
+	}
+
+	void acquire() noexcept
+	{
+		references.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void release() noexcept
+	{
+		if (references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			this->~Payload();
+			::operator delete(this);
+		}
+	}
+
+	void build_messages();
+};
+
+Exception::Exception(c::const_string error_message, std::source_location site)
+    : std::exception(), payload(Payload::create(error_message))
+{
+	capture_stack(capturePolicy(), site);
+}
+
+Exception::Exception(
+    const std::string& error_message, std::source_location site
+)
+    : std::exception(), payload(Payload::create(error_message))
 {
-	generate_final_what_message();
+	capture_stack(capturePolicy(), site);
 }
 
-Exception::Exception(const std::string& error_message)
+Exception::Exception(
+    const std::string& error_message,
+    StackCapturePolicy& policy,
+    std::source_location site
+)
+    : std::exception(), payload(Payload::create(error_message))
+{
+	capture_stack(policy, site);
+}
+
+Exception::Exception(
+    const std::string& error_message,
+    StackCapturePolicy& policy,
+    c::const_string class_name,
+    c::const_string optional_data,
+    std::source_location site
+)
     : std::exception()
-    , error_message(std::move(error_message))
-    , what_message()
-    , stack_trace(IOCore::generate_stacktrace(kDEFAULT_STACKFRAMES_TO_STRIP))
-    , inner_exception_ptr()
+    , payload(Payload::create(error_message, class_name, optional_data))
+{
+	capture_stack(policy, site);
+}
+
+Exception::Exception(const std::exception& inner, std::source_location site)
+    : std::exception(inner), payload(Payload::create(inner.what()))
+{
+	payload->inner_exception_ptr = std::make_exception_ptr(&inner);
+	capture_stack(capturePolicy(), site);
+}
+
+Exception::Exception(const Exception& other) noexcept
+    : std::exception(other), payload(other.payload)
+{
+	payload->acquire();
+}
+
+Exception::~Exception()
 {
-	generate_final_what_message();
+	payload->release();
 }
 
-Exception::Exception(const std::exception& inner)
-    : std::exception(inner)
-    , error_message(inner.what())
-    , what_message()
-    , inner_exception_ptr(std::make_exception_ptr(&inner))
-    , stack_trace(IOCore::generate_stacktrace(kDEFAULT_STACKFRAMES_TO_STRIP))
+[[gnu::noinline]] void Exception::capture_stack(
+    StackCapturePolicy& policy, const std::source_location& site
+)
 {
-	generate_final_what_message();
+	if constexpr (kMaxStackCapture == StackCapture::None) {
+		return;
+	} else {
+		payload->capture_mode = effective_capture_mode(policy, site);
+
+		if (payload->capture_mode != StackCapture::None) {
+			payload->stack_frames = IOCore::capture_stackframes(
+			    kDEFAULT_STACKFRAMES_TO_STRIP
+			);
+			payload->throw_site =
+			    IOCore::ThrowSiteRegistry::global().record(
+				payload->stack_frames
+			    );
+		}
+	}
 }
 
 auto Exception::what() const noexcept -> const char*
 {
-	return this->what_message.c_str();
+	try {
+		std::call_once(payload->messages_built, [this]() {
+			payload->build_messages();
+		});
+	} catch (...) {
+		return payload->error_message.data();
+	}
+	return payload->what_message.c_str();
 }
 
 auto Exception::stacktrace() const noexcept -> const std::string&
 {
-	return this->stack_trace;
+	try {
+		std::call_once(payload->messages_built, [this]() {
+			payload->build_messages();
+		});
+	} catch (...) {
+	}
+	return payload->stack_trace;
 }
 
 auto prepend_tabs_to_lines(const std::string& input) -> std::string
@@ -86,15 +264,52 @@ auto prepend_tabs_to_lines(const std::string& input) -> std::string
 void Exception::generate_final_what_message(
     c::const_string class_name, c::const_string optional_data
 )
+{
+	// Only called from constructors, before the payload can be shared,
+	// so replacing it is safe
+	auto* replacement = Payload::create(
+	    payload->error_message, class_name, optional_data
+	);
+	replacement->capture_mode = payload->capture_mode;
+	replacement->stack_frames = payload->stack_frames;
+	replacement->throw_site = payload->throw_site;
+	replacement->inner_exception_ptr = payload->inner_exception_ptr;
+
+	payload->release();
+	payload = replacement;
+}
+
+void Exception::Payload::build_messages()
 {
 	std::string my_name(class_name);
+	std::string data(optional_data);
 
 	if (my_name.empty()) {
 		my_name = "IOCore::Exception";
 	}
 
-	if (std::strlen(optional_data) <= 0) {
-		optional_data = "(null)";
+	if (data.empty()) {
+		data = "(null)";
+	}
+
+	if (this->capture_mode == StackCapture::Symbolized) {
+		// Identical stacks share one formatted trace per process
+		const std::string* canonical =
+		    (throw_site != nullptr) ? throw_site->stackTrace() : nullptr;
+
+		if (canonical != nullptr) {
+			this->stack_trace = *canonical;
+		} else {
+			this->stack_trace =
+			    IOCore::symbolize_stacktrace(this->stack_frames);
+			if (throw_site != nullptr) {
+				throw_site->publishStackTrace(this->stack_trace);
+			}
+		}
+	} else if (this->capture_mode == StackCapture::RawAddresses) {
+		for (void* address : this->stack_frames) {
+			this->stack_trace += fmt::format("{}\n", address);
+		}
 	}
 
 	std::string indented_stacktrace =
@@ -106,9 +321,9 @@ void Exception::generate_final_what_message(
 	    "\tdata: {}\n"
 	    "\tstack_trace:{}\n"
 	    "}};",
-	    my_name.c_str(),
-	    error_message.c_str(),
-	    optional_data,
+	    my_name,
+	    error_message,
+	    data,
 	    indented_stacktrace
 	);
 }
@@ -0,0 +1,534 @@
+/* Executor.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "Executor.hpp"
+
+#include "Exception.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+using IOCore::Executor;
+using IOCore::executor_detail::Task;
+
+namespace {
+/// \brief Chase-Lev work-stealing deque of task pointers.
+///
+/// Follows "Correct and Efficient Work-Stealing for Weak Memory Models"
+/// (Lê et al., 2013). Only the owning worker calls push() and pop(); any
+/// thread may steal(). Rings that are outgrown are kept until the deque is
+/// destroyed, since a thief may still be reading them.
+class WorkStealingDeque {
+    public:
+	static constexpr std::int64_t kInitialCapacity = 256;
+
+	WorkStealingDeque()
+	{
+		rings.push_back(std::make_unique<Ring>(kInitialCapacity));
+		ring.store(rings.back().get(), std::memory_order_relaxed);
+	}
+
+	void push(Task* task)
+	{
+		auto back = bottom.load(std::memory_order_relaxed);
+		auto front = top.load(std::memory_order_acquire);
+		auto* current = ring.load(std::memory_order_relaxed);
+
+		if (back - front > current->capacity - 1) {
+			current = grow(current, front, back);
+		}
+		current->put(back, task);
+		// A release store rather than the paper's release fence; same
+		// cost, and visible to ThreadSanitizer
+		bottom.store(back + 1, std::memory_order_release);
+	}
+
+	auto pop() -> Task*
+	{
+		auto back = bottom.load(std::memory_order_relaxed) - 1;
+		auto* current = ring.load(std::memory_order_relaxed);
+		bottom.store(back, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		auto front = top.load(std::memory_order_relaxed);
+
+		if (front > back) {
+			bottom.store(back + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Task* task = current->get(back);
+		if (front == back) {
+			// Last element: race any thief for it
+			if (!top.compare_exchange_strong(
+				front,
+				front + 1,
+				std::memory_order_seq_cst,
+				std::memory_order_relaxed
+			    )) {
+				task = nullptr;
+			}
+			bottom.store(back + 1, std::memory_order_relaxed);
+		}
+		return task;
+	}
+
+	auto steal() -> Task*
+	{
+		auto front = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		auto back = bottom.load(std::memory_order_acquire);
+
+		if (front >= back) {
+			return nullptr;
+		}
+
+		Task* task = ring.load(std::memory_order_acquire)->get(front);
+		if (!top.compare_exchange_strong(
+			front,
+			front + 1,
+			std::memory_order_seq_cst,
+			std::memory_order_relaxed
+		    )) {
+			return nullptr; // lost the race to another thread
+		}
+		return task;
+	}
+
+	[[nodiscard]] auto maybeEmpty() const noexcept -> bool
+	{
+		return bottom.load(std::memory_order_relaxed) <=
+		       top.load(std::memory_order_relaxed);
+	}
+
+    private:
+	struct Ring {
+		explicit Ring(std::int64_t size)
+		    : capacity(size)
+		    , slots(std::make_unique<std::atomic<Task*>[]>(size))
+		{
+		}
+
+		void put(std::int64_t index, Task* task) noexcept
+		{
+			slots[index & (capacity - 1)].store(
+			    task, std::memory_order_relaxed
+			);
+		}
+		auto get(std::int64_t index) const noexcept -> Task*
+		{
+			return slots[index & (capacity - 1)].load(
+			    std::memory_order_relaxed
+			);
+		}
+
+		std::int64_t capacity;
+		std::unique_ptr<std::atomic<Task*>[]> slots;
+	};
+
+	auto grow(Ring* current, std::int64_t front, std::int64_t back) -> Ring*
+	{
+		rings.push_back(std::make_unique<Ring>(current->capacity * 2));
+		auto* bigger = rings.back().get();
+
+		for (auto index = front; index < back; ++index) {
+			bigger->put(index, current->get(index));
+		}
+		ring.store(bigger, std::memory_order_release);
+		return bigger;
+	}
+
+	alignas(64) std::atomic<std::int64_t> top{ 0 };
+	alignas(64) std::atomic<std::int64_t> bottom{ 0 };
+	std::atomic<Ring*> ring{ nullptr };
+	std::vector<std::unique_ptr<Ring>> rings; // owner only
+};
+
+// Per-thread recycling of task objects, so submission does not allocate
+// once a thread has warmed up
+constexpr std::size_t kMaxFreeTasks = 1024;
+
+struct TaskFreeList {
+	Task* head = nullptr;
+	std::size_t size = 0;
+
+	~TaskFreeList()
+	{
+		while (head != nullptr) {
+			delete std::exchange(head, head->next_free);
+		}
+	}
+};
+thread_local TaskFreeList free_tasks;
+
+// The pool and worker the calling thread belongs to, if any. The worker is
+// untyped because Executor::Worker is private.
+thread_local Executor* current_executor = nullptr;
+thread_local void* current_worker = nullptr;
+} // namespace
+
+struct Executor::Worker {
+	WorkStealingDeque deque;
+	std::thread thread;
+	std::uint64_t steal_seed = 0;
+};
+
+auto Executor::defaultThreadCount() noexcept -> unsigned
+{
+#if defined(__linux__)
+	// Honours taskset/cpuset limits, unlike hardware_concurrency()
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0) {
+		auto count = CPU_COUNT(&cpus);
+		if (count > 0) {
+			return static_cast<unsigned>(count);
+		}
+	}
+#endif
+	return std::max(1U, std::thread::hardware_concurrency());
+}
+
+Executor::Executor(unsigned thread_count)
+{
+	thread_count = std::max(1U, thread_count);
+	workers.reserve(thread_count);
+
+	for (unsigned index = 0; index < thread_count; ++index) {
+		auto worker = std::make_unique<Worker>();
+		worker->steal_seed = index + 1;
+		workers.push_back(std::move(worker));
+	}
+	// Start only once every deque exists, since workers steal from all
+	for (auto& worker : workers) {
+		worker->thread = std::thread([this, &worker = *worker]() {
+			worker_loop(worker);
+		});
+	}
+}
+
+Executor::~Executor()
+{
+	try {
+		waitIdle();
+	} catch (...) { // NOLINT(bugprone-empty-catch)
+		// Errors nobody waited for are dropped at shutdown
+	}
+
+	{
+		std::lock_guard lock(sleep_mutex);
+		stopping.store(true, std::memory_order_seq_cst);
+	}
+	wake.notify_all();
+
+	for (auto& worker : workers) {
+		worker->thread.join();
+	}
+
+	auto* returned = returned_tasks.exchange(nullptr);
+	while (returned != nullptr) {
+		delete std::exchange(returned, returned->next_free);
+	}
+}
+
+auto Executor::acquire_task() -> Task*
+{
+	if (free_tasks.head == nullptr) {
+		// Adopt whatever the workers have handed back
+		auto* returned =
+		    returned_tasks.exchange(nullptr, std::memory_order_acquire);
+		while (returned != nullptr) {
+			auto* next = returned->next_free;
+			returned->next_free = free_tasks.head;
+			free_tasks.head = returned;
+			++free_tasks.size;
+			returned = next;
+		}
+	}
+
+	Task* task = nullptr;
+	if (free_tasks.head == nullptr) {
+		task = new Task();
+	} else {
+		--free_tasks.size;
+		task = std::exchange(free_tasks.head, free_tasks.head->next_free);
+	}
+	task->external = (current_executor != this);
+	return task;
+}
+
+void Executor::release_task(Task* task) noexcept
+{
+	if (task->external && current_executor == this) {
+		// Kept by the worker, it would never reach the submitter's
+		// free list again
+		auto* head = returned_tasks.load(std::memory_order_relaxed);
+		do {
+			task->next_free = head;
+		} while (!returned_tasks.compare_exchange_weak(
+		    head, task, std::memory_order_release, std::memory_order_relaxed
+		));
+		return;
+	}
+	if (free_tasks.size >= kMaxFreeTasks) {
+		delete task;
+		return;
+	}
+	task->next_free = free_tasks.head;
+	free_tasks.head = task;
+	++free_tasks.size;
+}
+
+void Executor::enqueue(Task* const tasks[], std::size_t count)
+{
+	if (stopping.load(std::memory_order_relaxed)) {
+		for (std::size_t index = 0; index < count; ++index) {
+			tasks[index]->reset();
+			release_task(tasks[index]);
+		}
+		throw IOCore::Exception("Executor is shutting down");
+	}
+	pending.fetch_add(count, std::memory_order_relaxed);
+
+	if (current_executor == this) {
+		auto* worker = static_cast<Worker*>(current_worker);
+		for (std::size_t index = 0; index < count; ++index) {
+			worker->deque.push(tasks[index]);
+		}
+	} else {
+		std::lock_guard lock(injection_mutex);
+		injection_queue.insert(injection_queue.end(), tasks, tasks + count);
+		injection_size.store(
+		    injection_queue.size() - injection_head,
+		    std::memory_order_release
+		);
+	}
+
+	// A sleeper either sees the new epoch before waiting, or is already
+	// counted in `sleeping` and gets notified
+	work_epoch.fetch_add(1, std::memory_order_seq_cst);
+	if (sleeping.load(std::memory_order_seq_cst) > 0) {
+		std::lock_guard lock(sleep_mutex);
+		if (count > 1) {
+			wake.notify_all();
+		} else {
+			wake.notify_one();
+		}
+	}
+}
+
+auto Executor::find_task(Worker* worker) -> Task*
+{
+	if (worker != nullptr) {
+		if (auto* task = worker->deque.pop()) {
+			return task;
+		}
+	}
+
+	if (injection_size.load(std::memory_order_acquire) > 0) {
+		std::lock_guard lock(injection_mutex);
+		if (injection_head < injection_queue.size()) {
+			// FIFO for fairness between external submitters
+			auto* task = injection_queue[injection_head++];
+			auto size = injection_queue.size();
+
+			// Drop the taken prefix once it is half the queue, so
+			// each task is moved O(1) times on average
+			if (injection_head == size) {
+				injection_queue.clear();
+				injection_head = 0;
+			} else if (injection_head >= size / 2) {
+				injection_queue.erase(
+				    injection_queue.begin(),
+				    injection_queue.begin() +
+					static_cast<std::ptrdiff_t>(
+					    injection_head
+					)
+				);
+				injection_head = 0;
+			}
+			injection_size.store(
+			    injection_queue.size() - injection_head,
+			    std::memory_order_release
+			);
+			return task;
+		}
+	}
+
+	// Steal from the other workers, starting at a pseudo-random victim
+	auto count = workers.size();
+	std::uint64_t seed = (worker != nullptr)
+	                         ? (worker->steal_seed =
+	                                worker->steal_seed * 6364136223846793005ULL +
+	                                1442695040888963407ULL)
+	                         : reinterpret_cast<std::uintptr_t>(&seed);
+	auto start = static_cast<std::size_t>(seed >> 33) % count;
+
+	for (std::size_t offset = 0; offset < count; ++offset) {
+		auto& victim = *workers[(start + offset) % count];
+		if (&victim == worker || victim.deque.maybeEmpty()) {
+			continue;
+		}
+		if (auto* task = victim.deque.steal()) {
+			return task;
+		}
+	}
+	return nullptr;
+}
+
+void Executor::execute(Task* task) noexcept
+{
+	try {
+		task->run();
+	} catch (...) {
+		std::lock_guard lock(error_mutex);
+		if (!first_error) {
+			first_error = std::current_exception();
+		}
+	}
+	task->reset();
+	release_task(task);
+	pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+auto Executor::run_one() -> bool
+{
+	auto* worker = (current_executor == this)
+	                   ? static_cast<Worker*>(current_worker)
+	                   : nullptr;
+	auto* task = find_task(worker);
+
+	if (task == nullptr) {
+		return false;
+	}
+	execute(task);
+	return true;
+}
+
+void Executor::worker_loop(Worker& worker)
+{
+	current_executor = this;
+	current_worker = &worker;
+
+	while (true) {
+		if (auto* task = find_task(&worker)) {
+			execute(task);
+			continue;
+		}
+
+		auto epoch = work_epoch.load(std::memory_order_seq_cst);
+		if (auto* task = find_task(&worker)) {
+			execute(task);
+			continue;
+		}
+
+		std::unique_lock lock(sleep_mutex);
+		if (stopping.load(std::memory_order_seq_cst)) {
+			break;
+		}
+		sleeping.fetch_add(1, std::memory_order_seq_cst);
+		wake.wait(lock, [this, epoch]() {
+			return stopping.load(std::memory_order_seq_cst) ||
+			       work_epoch.load(std::memory_order_seq_cst) !=
+				   epoch;
+		});
+		sleeping.fetch_sub(1, std::memory_order_seq_cst);
+	}
+
+	current_executor = nullptr;
+	current_worker = nullptr;
+}
+
+void Executor::waitIdle()
+{
+	help_until([this]() {
+		return pending.load(std::memory_order_acquire) == 0;
+	});
+
+	std::exception_ptr error;
+	{
+		std::lock_guard lock(error_mutex);
+		error = std::exchange(first_error, nullptr);
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+auto Executor::waitIdleFor(std::chrono::nanoseconds timeout) -> bool
+{
+	// Only the workers run tasks here: a task picked up by the caller
+	// could overrun the deadline by any amount. Shutdown paths use this,
+	// so coarse polling is good enough.
+	constexpr auto kPollInterval = std::chrono::milliseconds{ 1 };
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+
+	while (pending.load(std::memory_order_acquire) != 0) {
+		auto now = std::chrono::steady_clock::now();
+		if (now >= deadline) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(
+		    kPollInterval, deadline - now
+		));
+	}
+
+	std::exception_ptr error;
+	{
+		std::lock_guard lock(error_mutex);
+		error = std::exchange(first_error, nullptr);
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	return true;
+}
+
+auto Executor::discardQueued() -> std::size_t
+{
+	std::vector<Task*> dropped;
+	{
+		std::lock_guard lock(injection_mutex);
+		dropped.assign(
+		    injection_queue.begin() +
+			static_cast<std::ptrdiff_t>(injection_head),
+		    injection_queue.end()
+		);
+		injection_queue.clear();
+		injection_head = 0;
+		injection_size.store(0, std::memory_order_release);
+	}
+	// Stealing is safe from any thread, unlike pop()
+	for (auto& worker : workers) {
+		while (!worker->deque.maybeEmpty()) {
+			if (auto* task = worker->deque.steal()) {
+				dropped.push_back(task);
+			}
+		}
+	}
+
+	for (auto* task : dropped) {
+		task->reset();
+		release_task(task);
+	}
+	pending.fetch_sub(dropped.size(), std::memory_order_acq_rel);
+	return dropped.size();
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
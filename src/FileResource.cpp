@@ -10,6 +10,7 @@
 #include "FileResource.hpp"
 #include "Exception.hpp"
 
+#include "sys/startup_profiler.hpp"
 #include "types.hpp"
 #include "util/debug_print.hpp"
 
@@ -24,6 +25,8 @@ namespace fs = std::filesystem;
 FileResource::FileResource(const fs::path& file_path, CreateDirs mode)
     : file_path(file_path)
 {
+	StartupPhase phase("FileResource::FileResource", file_path.native());
+
 	ASSERT(file_path.empty() == false);
 	try {
 		auto directory_path = file_path.parent_path();
@@ -33,6 +36,10 @@ FileResource::FileResource(const fs::path& file_path, CreateDirs mode)
 				throw UnreachablePathException(directory_path);
 			} else {
 				DEBUG_PRINT("creating config dir");
+				StartupPhase create_phase(
+				    "FileResource create_directories",
+				    directory_path.native()
+				);
 				fs::create_directories(directory_path);
 			}
 		}
@@ -50,5 +57,10 @@ FileResource::FileResource(const fs::path& file_path, CreateDirs mode)
 		throw IOCore::Exception(exception);
 	}
 };
+
+void FileResource::replace_contents(std::string_view contents) const
+{
+	write_file_atomically(file_path, contents, sync_mode);
+}
 // clang-format off
 // vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8  noexpandtab ft=cpp.doxygen :
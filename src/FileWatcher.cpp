@@ -0,0 +1,150 @@
+/* FileWatcher.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "FileWatcher.hpp"
+
+#include "Exception.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using IOCore::FileWatcher;
+
+#if defined(__linux__)
+namespace {
+// Room for a burst of events with file names up to NAME_MAX
+constexpr std::size_t kEventBufferSize = 16 * (sizeof(inotify_event) + 256);
+} // namespace
+
+FileWatcher::FileWatcher(
+    Reactor& reactor, const std::filesystem::path& file, Callback on_change
+)
+    : reactor(reactor)
+    , directory(file.parent_path())
+    , file_name(file.filename().string())
+    , on_change(std::move(on_change))
+    , event_buffer(kEventBufferSize)
+{
+	if (directory.empty()) {
+		directory = ".";
+	}
+
+	inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd < 0) {
+		throw IOCore::Exception(
+		    std::string("inotify_init1() failed: ") + std::strerror(errno)
+		);
+	}
+
+	try {
+		add_watch();
+		source = reactor.watchFd(
+		    inotify_fd, Reactor::Readable, [this](std::uint64_t) {
+			    drain_events();
+		    }
+		);
+	} catch (...) {
+		::close(inotify_fd);
+		throw;
+	}
+}
+
+FileWatcher::~FileWatcher()
+{
+	reactor.remove(source);
+	::close(inotify_fd);
+}
+
+void FileWatcher::add_watch()
+{
+	// Writes in place (and new files) end with IN_CLOSE_WRITE, atomic
+	// replacement with IN_MOVED_TO; IN_MODIFY would fire mid-write
+	if (::inotify_add_watch(
+		inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO
+	    ) < 0) {
+		throw IOCore::Exception(
+		    "inotify_add_watch() failed for " + directory.string() +
+		    ": " + std::strerror(errno)
+		);
+	}
+}
+
+void FileWatcher::drain_events()
+{
+	bool changed = false;
+	bool watch_lost = false;
+	while (true) {
+		auto count = ::read(
+		    inotify_fd, event_buffer.data(), event_buffer.size()
+		);
+		if (count <= 0) {
+			break; // EAGAIN: drained, as edge triggering requires
+		}
+
+		std::size_t offset = 0;
+		while (offset < static_cast<std::size_t>(count)) {
+			inotify_event event{};
+			std::memcpy(
+			    &event, event_buffer.data() + offset, sizeof(event)
+			);
+			if ((event.mask & IN_Q_OVERFLOW) != 0) {
+				// Events were dropped; one of them may have been ours
+				changed = true;
+			} else if ((event.mask & IN_IGNORED) != 0) {
+				// The directory was deleted or unmounted
+				watch_lost = true;
+			} else if (event.len > 0) {
+				std::string_view name(
+				    event_buffer.data() + offset + sizeof(event)
+				);
+				changed = changed || name == file_name;
+			}
+			offset += sizeof(event) + event.len;
+		}
+	}
+
+	if (watch_lost) {
+		// A directory recreated under the same path holds a new file
+		// (if any); one that is gone for good can no longer be watched
+		add_watch();
+		changed = true;
+	}
+
+	if (changed) {
+		on_change();
+	}
+}
+
+#else // !defined(__linux__)
+
+FileWatcher::FileWatcher(
+    Reactor& reactor, const std::filesystem::path&, Callback
+)
+    : reactor(reactor)
+{
+	throw NotImplementedException();
+}
+
+FileWatcher::~FileWatcher() = default;
+
+void FileWatcher::add_watch() {}
+
+void FileWatcher::drain_events() {}
+
+#endif
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,548 @@
+/* IoEngine.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IoEngine.hpp"
+
+#include "Assert.hpp"
+#include "Exception.hpp"
+#include "Executor.hpp"
+#include "Reactor.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+using IOCore::IoEngine;
+using IOCore::IoResult;
+using IOCore::Task;
+
+namespace {
+auto errno_result() noexcept -> IoResult
+{
+	return IoResult{ -static_cast<std::int64_t>(errno) };
+}
+
+auto io_error(const char* call, const fs::path& path, IoResult result)
+    -> IOCore::Exception
+{
+	return IOCore::Exception(
+	    std::string(call) + " failed for " + path.string() + ": " +
+	    std::strerror(result.error())
+	);
+}
+
+// Runs each operation as a blocking call on an Executor worker, then hands
+// the result back to the thread that polls
+class ThreadPoolEngine final : public IoEngine {
+    public:
+	explicit ThreadPoolEngine(IOCore::Executor& pool) : executor(pool) {}
+
+	~ThreadPoolEngine() override
+	{
+		detach();
+		// Workers still touch the engine until they have queued their
+		// completion; completions nobody polled for are dropped
+		std::unique_lock lock(done_mutex);
+		done_signal.wait(lock, [this]() { return running == 0; });
+
+		for (auto* pending : queued) {
+			delete pending;
+		}
+	}
+
+	[[nodiscard]] auto backend() const noexcept -> Backend override
+	{
+		return Backend::ThreadPool;
+	}
+
+	void read(
+	    int fd,
+	    std::span<std::byte> buffer,
+	    std::uint64_t offset,
+	    Completion on_complete
+	) override
+	{
+		enqueue(
+		    [fd, buffer, offset]() {
+			    ssize_t count = 0;
+			    do {
+				    count = ::pread(
+					fd,
+					buffer.data(),
+					buffer.size(),
+					static_cast<off_t>(offset)
+				    );
+			    } while (count < 0 && errno == EINTR);
+			    return count < 0 ? errno_result() : IoResult{ count };
+		    },
+		    std::move(on_complete)
+		);
+	}
+
+	void write(
+	    int fd,
+	    std::span<const std::byte> data,
+	    std::uint64_t offset,
+	    Completion on_complete
+	) override
+	{
+		enqueue(
+		    [fd, data, offset]() {
+			    ssize_t count = 0;
+			    do {
+				    count = ::pwrite(
+					fd,
+					data.data(),
+					data.size(),
+					static_cast<off_t>(offset)
+				    );
+			    } while (count < 0 && errno == EINTR);
+			    return count < 0 ? errno_result() : IoResult{ count };
+		    },
+		    std::move(on_complete)
+		);
+	}
+
+	void fsync(int fd, Sync sync, Completion on_complete) override
+	{
+		enqueue(
+		    [fd, sync]() {
+#if defined(__linux__)
+			    int status = (sync == Sync::DataOnly)
+			                     ? ::fdatasync(fd)
+			                     : ::fsync(fd);
+#else
+			    (void) sync;
+			    int status = ::fsync(fd);
+#endif
+			    return status < 0 ? errno_result() : IoResult{ 0 };
+		    },
+		    std::move(on_complete)
+		);
+	}
+
+	void open(
+	    fs::path path, int flags, unsigned mode, Completion on_complete
+	) override
+	{
+		enqueue(
+		    [path = std::move(path), flags, mode]() {
+			    int fd = ::open(
+				path.c_str(), flags, static_cast<mode_t>(mode)
+			    );
+			    return fd < 0 ? errno_result() : IoResult{ fd };
+		    },
+		    std::move(on_complete)
+		);
+	}
+
+	void close(int fd, Completion on_complete) override
+	{
+		enqueue(
+		    [fd]() {
+			    return ::close(fd) < 0 ? errno_result()
+			                           : IoResult{ 0 };
+		    },
+		    std::move(on_complete)
+		);
+	}
+
+	void stat(
+	    fs::path path, IOCore::FileStatus& status, Completion on_complete
+	) override
+	{
+		enqueue(
+		    [path = std::move(path), &status]() {
+			    struct stat info {};
+			    if (::stat(path.c_str(), &info) != 0) {
+				    return errno_result();
+			    }
+#if defined(__APPLE__)
+			    const auto& mtime = info.st_mtimespec;
+#else
+			    const auto& mtime = info.st_mtim;
+#endif
+			    status.size = static_cast<std::uint64_t>(info.st_size);
+			    status.device = static_cast<std::uint64_t>(info.st_dev);
+			    status.inode = static_cast<std::uint64_t>(info.st_ino);
+			    status.mtime_ns =
+				static_cast<std::int64_t>(mtime.tv_sec) *
+				    1'000'000'000 +
+				mtime.tv_nsec;
+			    status.mode = static_cast<std::uint32_t>(info.st_mode);
+			    return IoResult{ 0 };
+		    },
+		    std::move(on_complete)
+		);
+	}
+
+	auto registerBuffers(std::span<const std::span<std::byte>> /*buffers*/)
+	    -> bool override
+	{
+		return true;
+	}
+
+	auto registerFiles(std::span<const int> /*fds*/) -> bool override
+	{
+		return true;
+	}
+
+	auto submit() -> std::size_t override
+	{
+		std::vector<Pending*> batch;
+		{
+			std::lock_guard lock(queue_mutex);
+			batch.swap(queued);
+		}
+		if (batch.empty()) {
+			return 0;
+		}
+
+		{
+			std::lock_guard lock(done_mutex);
+			running += batch.size();
+		}
+		in_flight.fetch_add(batch.size(), std::memory_order_relaxed);
+		for (auto* pending : batch) {
+			Job job(*this, pending);
+			try {
+				executor.submit(std::move(job));
+			} catch (...) { // NOLINT(bugprone-empty-catch)
+				// A stopping executor refuses the job; whichever of
+				// job or its task copy still owns it cancels it
+			}
+		}
+		return batch.size();
+	}
+
+	auto poll() -> std::size_t override
+	{
+		// Local, since a completion may itself poll
+		std::vector<Done> ready;
+		{
+			std::lock_guard lock(done_mutex);
+			ready.swap(done);
+		}
+		in_flight.fetch_sub(ready.size(), std::memory_order_relaxed);
+		for (auto& completed : ready) {
+			completed.on_complete(completed.result);
+		}
+		return ready.size();
+	}
+
+	auto wait(std::chrono::milliseconds timeout) -> std::size_t override
+	{
+		submit();
+		if (inFlight() == 0) {
+			return 0;
+		}
+		{
+			std::unique_lock lock(done_mutex);
+			done_signal.wait_for(lock, timeout, [this]() {
+				return !done.empty();
+			});
+		}
+		return poll();
+	}
+
+	[[nodiscard]] auto inFlight() const noexcept -> std::size_t override
+	{
+		return in_flight.load(std::memory_order_relaxed);
+	}
+
+	void attach(IOCore::Reactor& loop) override
+	{
+		IOCORE_ASSERT(reactor == nullptr);
+		reactor = &loop;
+		IOCore::Reactor::Notifier handle;
+		source = loop.addNotifier(
+		    [this](std::uint64_t) { poll(); }, &handle
+		);
+
+		std::lock_guard lock(done_mutex);
+		notifier = handle;
+		attached = true;
+		if (!done.empty()) {
+			notifier.notify();
+		}
+	}
+
+	void detach() noexcept override
+	{
+		if (reactor == nullptr) {
+			return;
+		}
+		{
+			std::lock_guard lock(done_mutex);
+			attached = false;
+		}
+		reactor->remove(source);
+		reactor = nullptr;
+	}
+
+    private:
+	struct Pending {
+		std::function<IoResult()> work;
+		Completion on_complete;
+	};
+	struct Done {
+		Completion on_complete;
+		IoResult result;
+	};
+
+	void enqueue(std::function<IoResult()> work, Completion on_complete)
+	{
+		auto* pending =
+		    new Pending{ std::move(work), std::move(on_complete) };
+		std::lock_guard lock(queue_mutex);
+		queued.push_back(pending);
+	}
+
+	// Owns a Pending until it has run. One destroyed unrun, because the
+	// executor refused or discarded it, completes with ECANCELED, so
+	// `running` still drops to zero and the destructor does not hang.
+	// Two pointers keep it inside the executor's inline task storage.
+	class Job {
+	    public:
+		Job(ThreadPoolEngine& owner, Pending* work)
+		    : engine(&owner), pending(work)
+		{
+		}
+		Job(Job&& other) noexcept
+		    : engine(other.engine)
+		    , pending(std::exchange(other.pending, nullptr))
+		{
+		}
+		~Job()
+		{
+			if (pending != nullptr) {
+				engine->finish(
+				    std::unique_ptr<Pending>(pending),
+				    IoResult{ -ECANCELED }
+				);
+			}
+		}
+
+		Job(const Job&) = delete;
+		auto operator=(const Job&) -> Job& = delete;
+		auto operator=(Job&&) -> Job& = delete;
+
+		void operator()()
+		{
+			std::unique_ptr<Pending> owned(
+			    std::exchange(pending, nullptr)
+			);
+			auto result = owned->work();
+			engine->finish(std::move(owned), result);
+		}
+
+	    private:
+		ThreadPoolEngine* engine;
+		Pending* pending;
+	};
+
+	void finish(std::unique_ptr<Pending> pending, IoResult result)
+	{
+		std::lock_guard lock(done_mutex);
+		done.push_back(Done{ std::move(pending->on_complete), result });
+		--running;
+		done_signal.notify_all();
+		if (attached) {
+			notifier.notify();
+		}
+	}
+
+	IOCore::Executor& executor;
+
+	std::mutex queue_mutex;
+	std::vector<Pending*> queued;
+
+	std::mutex done_mutex;
+	std::condition_variable done_signal;
+	std::vector<Done> done;
+	std::size_t running = 0; ///< submitted work not yet in done
+	bool attached = false;
+	IOCore::Reactor::Notifier notifier;
+
+	std::atomic<std::size_t> in_flight{ 0 };
+
+	IOCore::Reactor* reactor = nullptr;
+	IOCore::Reactor::SourceId source = 0;
+};
+} // namespace
+
+auto IOCore::io_detail::create_thread_pool_engine(Executor& executor)
+    -> std::unique_ptr<IoEngine>
+{
+	return std::make_unique<ThreadPoolEngine>(executor);
+}
+
+auto IoEngine::create(Executor& executor, Backend backend, unsigned queue_depth)
+    -> std::unique_ptr<IoEngine>
+{
+	if (backend != Backend::ThreadPool) {
+		if (auto engine = io_detail::create_io_uring_engine(queue_depth)) {
+			return engine;
+		}
+		if (backend == Backend::IoUring) {
+			throw IOCore::Exception("io_uring is not available");
+		}
+	}
+	return io_detail::create_thread_pool_engine(executor);
+}
+
+void IoEngine::Operation::await_suspend(std::coroutine_handle<> handle)
+{
+	auto& owner = *engine;
+	start(owner, [this, handle](IoResult outcome) {
+		result = outcome;
+		handle.resume();
+	});
+	// Nothing may touch *this past here: once queued, the completion can
+	// run (and destroy this awaiter) on another thread
+	owner.submit();
+}
+
+auto IoEngine::asyncRead(
+    int fd, std::span<std::byte> buffer, std::uint64_t offset
+) -> Operation
+{
+	return Operation(*this, [=](IoEngine& engine, Completion done) {
+		engine.read(fd, buffer, offset, std::move(done));
+	});
+}
+
+auto IoEngine::asyncWrite(
+    int fd, std::span<const std::byte> data, std::uint64_t offset
+) -> Operation
+{
+	return Operation(*this, [=](IoEngine& engine, Completion done) {
+		engine.write(fd, data, offset, std::move(done));
+	});
+}
+
+auto IoEngine::asyncFsync(int fd, Sync sync) -> Operation
+{
+	return Operation(*this, [=](IoEngine& engine, Completion done) {
+		engine.fsync(fd, sync, std::move(done));
+	});
+}
+
+auto IoEngine::asyncOpen(fs::path path, int flags, unsigned mode) -> Operation
+{
+	return Operation(
+	    *this,
+	    [path = std::move(path), flags, mode](
+		IoEngine& engine, Completion done
+	    ) { engine.open(path, flags, mode, std::move(done)); }
+	);
+}
+
+auto IoEngine::asyncClose(int fd) -> Operation
+{
+	return Operation(*this, [=](IoEngine& engine, Completion done) {
+		engine.close(fd, std::move(done));
+	});
+}
+
+auto IoEngine::asyncStat(fs::path path, FileStatus& status) -> Operation
+{
+	return Operation(
+	    *this,
+	    [path = std::move(path), &status](
+		IoEngine& engine, Completion done
+	    ) { engine.stat(path, status, std::move(done)); }
+	);
+}
+
+auto IoEngine::readFile(fs::path path) -> Task<std::string>
+{
+	FileStatus status;
+	auto stat_result = co_await asyncStat(path, status);
+	if (!stat_result.ok()) {
+		throw io_error("stat()", path, stat_result);
+	}
+
+	auto opened = co_await asyncOpen(path, O_RDONLY | O_CLOEXEC);
+	if (!opened.ok()) {
+		throw io_error("open()", path, opened);
+	}
+	auto fd = static_cast<int>(opened.value);
+
+	std::string contents(status.size, '\0');
+	std::size_t filled = 0;
+	IoResult failure;
+	while (filled < contents.size()) {
+		auto chunk = std::as_writable_bytes(
+		    std::span(contents).subspan(filled)
+		);
+		auto count = co_await asyncRead(fd, chunk, filled);
+		if (!count.ok()) {
+			failure = count;
+			break;
+		}
+		if (count.value == 0) {
+			// Shrank since stat()
+			contents.resize(filled);
+			break;
+		}
+		filled += static_cast<std::size_t>(count.value);
+	}
+
+	co_await asyncClose(fd);
+	if (!failure.ok()) {
+		throw io_error("read()", path, failure);
+	}
+	co_return contents;
+}
+
+auto IoEngine::writeFile(fs::path path, std::string contents) -> Task<void>
+{
+	auto opened = co_await asyncOpen(
+	    path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644
+	);
+	if (!opened.ok()) {
+		throw io_error("open()", path, opened);
+	}
+	auto fd = static_cast<int>(opened.value);
+
+	std::size_t written = 0;
+	IoResult failure;
+	while (written < contents.size()) {
+		auto chunk = std::as_bytes(std::span(contents).subspan(written));
+		auto count = co_await asyncWrite(fd, chunk, written);
+		if (!count.ok()) {
+			failure = count;
+			break;
+		}
+		written += static_cast<std::size_t>(count.value);
+	}
+
+	auto closed = co_await asyncClose(fd);
+	if (!failure.ok()) {
+		throw io_error("write()", path, failure);
+	}
+	if (!closed.ok()) {
+		throw io_error("close()", path, closed);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
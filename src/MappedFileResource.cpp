@@ -0,0 +1,158 @@
+/* MappedFileResource.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "MappedFileResource.hpp"
+
+#include "Exception.hpp"
+#include "sys/startup_profiler.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+using IOCore::MappedFileResource;
+
+namespace {
+auto file_size(int descriptor, const fs::path& path) -> std::size_t
+{
+	struct stat file_info {};
+	if (::fstat(descriptor, &file_info) != 0) {
+		throw IOCore::Exception(
+		    "fstat() failed for " + path.string() + ": " +
+		    std::strerror(errno)
+		);
+	}
+	return static_cast<std::size_t>(file_info.st_size);
+}
+} // namespace
+
+MappedFileResource::MappedFileResource(
+    const fs::path& file_path, CreateDirs mode
+)
+    : FileResource(file_path, mode)
+{
+	StartupPhase phase("MappedFileResource::map", file_path.native());
+
+	descriptor = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (descriptor < 0) {
+		throw IOCore::Exception(
+		    "open() failed for " + file_path.string() + ": " +
+		    std::strerror(errno)
+		);
+	}
+
+	try {
+		map(file_size(descriptor, file_path));
+	} catch (...) {
+		::close(descriptor);
+		throw;
+	}
+}
+
+MappedFileResource::~MappedFileResource()
+{
+	unmap();
+	::close(descriptor);
+}
+
+void MappedFileResource::map(std::size_t size)
+{
+	// mmap() rejects empty lengths; an empty file is an empty view
+	if (size == 0) {
+		return;
+	}
+
+	auto* address =
+	    ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	if (address == MAP_FAILED) {
+		throw IOCore::Exception(
+		    "mmap() failed for " + file_path.string() + ": " +
+		    std::strerror(errno)
+		);
+	}
+	mapping = address;
+	mapped_size = size;
+}
+
+void MappedFileResource::unmap() noexcept
+{
+	if (mapping != nullptr) {
+		::munmap(mapping, mapped_size);
+		mapping = nullptr;
+		mapped_size = 0;
+	}
+}
+
+auto MappedFileResource::remap() -> bool
+{
+	auto size = file_size(descriptor, file_path);
+	if (size == mapped_size) {
+		return false;
+	}
+
+#if defined(__linux__)
+	if (mapping != nullptr && size != 0) {
+		// Lets the kernel grow the mapping in place when it can
+		auto* address = ::mremap(mapping, mapped_size, size, MREMAP_MAYMOVE);
+		if (address == MAP_FAILED) {
+			throw IOCore::Exception(
+			    "mremap() failed for " + file_path.string() + ": " +
+			    std::strerror(errno)
+			);
+		}
+		mapping = address;
+		mapped_size = size;
+		return true;
+	}
+#endif
+	unmap();
+	map(size);
+	return true;
+}
+
+auto MappedFileResource::advise(Advice advice) const noexcept -> bool
+{
+	if (mapping == nullptr) {
+		return true;
+	}
+
+	int flag = MADV_NORMAL;
+	switch (advice) {
+	case Advice::Normal:
+		flag = MADV_NORMAL;
+		break;
+	case Advice::Sequential:
+		flag = MADV_SEQUENTIAL;
+		break;
+	case Advice::Random:
+		flag = MADV_RANDOM;
+		break;
+	case Advice::WillNeed:
+		flag = MADV_WILLNEED;
+		break;
+	case Advice::HugePage:
+#if defined(MADV_HUGEPAGE)
+		flag = MADV_HUGEPAGE;
+		break;
+#else
+		return false;
+#endif
+	}
+	return ::madvise(mapping, mapped_size, flag) == 0;
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
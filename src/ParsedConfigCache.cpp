@@ -0,0 +1,303 @@
+/* ParsedConfigCache.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "ParsedConfigCache.hpp"
+
+#include "Exception.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+using IOCore::ParsedConfigCache;
+using IOCore::ParsedConfigCacheStats;
+using IOCore::TomlTable;
+
+namespace {
+// Coarse filesystem timestamps (FAT's are 2s) can hide a rewrite that
+// lands within the same tick as the one that was cached
+constexpr std::int64_t kRacyWindowNs = 2'000'000'000;
+
+struct FileContents {
+	std::string bytes;
+	struct stat info {};
+};
+
+auto mtime_ns(const struct stat& info) noexcept -> std::int64_t
+{
+#if defined(__APPLE__)
+	const auto& mtime = info.st_mtimespec;
+#else
+	const auto& mtime = info.st_mtim;
+#endif
+	return static_cast<std::int64_t>(mtime.tv_sec) * 1'000'000'000 +
+	       static_cast<std::int64_t>(mtime.tv_nsec);
+}
+
+auto now_ns() noexcept -> std::int64_t
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		   std::chrono::system_clock::now().time_since_epoch()
+	)
+	    .count();
+}
+
+auto read_file(const fs::path& path) -> FileContents
+{
+	FileContents contents;
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		throw IOCore::Exception(
+		    "open() failed for " + path.string() + ": " +
+		    std::strerror(errno)
+		);
+	}
+	if (::fstat(fd, &contents.info) != 0) {
+		auto error = errno;
+		::close(fd);
+		throw IOCore::Exception(
+		    "fstat() failed for " + path.string() + ": " +
+		    std::strerror(error)
+		);
+	}
+
+	contents.bytes.resize(static_cast<std::size_t>(contents.info.st_size));
+	std::size_t filled = 0;
+	while (true) {
+		if (filled == contents.bytes.size()) {
+			// The file may have grown since fstat()
+			contents.bytes.resize(filled + 4096);
+		}
+		auto count = ::read(
+		    fd, contents.bytes.data() + filled, contents.bytes.size() - filled
+		);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count < 0) {
+			auto error = errno;
+			::close(fd);
+			throw IOCore::Exception(
+			    "read() failed for " + path.string() + ": " +
+			    std::strerror(error)
+			);
+		}
+		if (count == 0) {
+			break;
+		}
+		filled += static_cast<std::size_t>(count);
+	}
+	::close(fd);
+	contents.bytes.resize(filled);
+	return contents;
+}
+
+// Word-at-a-time multiplicative hash; only used to detect edits, so it
+// needs to be fast rather than collision-resistant against an adversary
+auto hash_contents(std::string_view bytes) noexcept -> std::uint64_t
+{
+	constexpr std::uint64_t kMultiplier = 0x9E3779B97F4A7C15ULL;
+	std::uint64_t hash = bytes.size() * kMultiplier;
+
+	std::size_t offset = 0;
+	for (; offset + 8 <= bytes.size(); offset += 8) {
+		std::uint64_t word = 0;
+		std::memcpy(&word, bytes.data() + offset, 8);
+		hash = (hash ^ word) * kMultiplier;
+		hash ^= hash >> 29;
+	}
+	if (offset < bytes.size()) {
+		std::uint64_t tail = 0;
+		std::memcpy(&tail, bytes.data() + offset, bytes.size() - offset);
+		hash = (hash ^ tail) * kMultiplier;
+	}
+	return hash ^ (hash >> 32);
+}
+
+auto parse_contents(const std::string& bytes, const fs::path& path)
+    -> std::shared_ptr<const TomlTable>
+{
+	auto table = std::make_shared<TomlTable>();
+	if (!bytes.empty()) {
+		*table = toml::parse(std::string_view(bytes), path.native());
+	}
+	return table;
+}
+} // namespace
+
+auto ParsedConfigCache::FileKeyHash::operator()(const FileKey& key
+) const noexcept -> std::size_t
+{
+	return std::hash<std::uint64_t>{}(key.inode * 31 + key.device);
+}
+
+ParsedConfigCache::ParsedConfigCache(std::size_t capacity)
+    : max_entries(capacity)
+{
+}
+
+ParsedConfigCache::~ParsedConfigCache() = default;
+
+auto ParsedConfigCache::global() -> ParsedConfigCache&
+{
+	static ParsedConfigCache cache;
+	return cache;
+}
+
+auto ParsedConfigCache::load(const fs::path& path)
+    -> std::shared_ptr<const TomlTable>
+{
+	struct stat info {};
+	if (::stat(path.c_str(), &info) != 0) {
+		throw IOCore::Exception(
+		    "stat() failed for " + path.string() + ": " +
+		    std::strerror(errno)
+		);
+	}
+
+	std::shared_ptr<const TomlTable> candidate;
+	std::uint64_t expected_hash = 0;
+	{
+		std::lock_guard lock(mutex);
+		auto found = index.find(FileKey{ info.st_dev, info.st_ino });
+		if (found != index.end()) {
+			auto& entry = *found->second;
+			if (entry.mtime_ns == mtime_ns(info) &&
+			    entry.size == static_cast<std::uint64_t>(info.st_size)) {
+				if (!entry.racy && !verify_content) {
+					entries.splice(
+					    entries.begin(), entries, found->second
+					);
+					++counters.hits;
+					return entry.table;
+				}
+				candidate = entry.table;
+				expected_hash = entry.content_hash;
+			}
+		}
+	}
+
+	// Read outside the lock; the stamp comes from the open file, so a
+	// rename() racing with us is caught on the next lookup
+	auto contents = read_file(path);
+	Entry entry{
+		FileKey{ contents.info.st_dev, contents.info.st_ino },
+		mtime_ns(contents.info),
+		contents.bytes.size(),
+		hash_contents(contents.bytes),
+		false,
+		nullptr,
+	};
+	entry.racy = entry.mtime_ns + kRacyWindowNs > now_ns();
+
+	bool unchanged = candidate && entry.content_hash == expected_hash;
+	entry.table = unchanged ? std::move(candidate)
+	                        : parse_contents(contents.bytes, path);
+	auto table = entry.table;
+
+	std::lock_guard lock(mutex);
+	++(unchanged ? counters.hits : counters.misses);
+	insert_locked(std::move(entry));
+	return table;
+}
+
+void ParsedConfigCache::insert_locked(Entry entry)
+{
+	if (max_entries == 0) {
+		return;
+	}
+
+	auto found = index.find(entry.key);
+	if (found != index.end()) {
+		entries.erase(found->second);
+		index.erase(found);
+	}
+	entries.push_front(std::move(entry));
+	index.emplace(entries.front().key, entries.begin());
+	evict_locked();
+}
+
+void ParsedConfigCache::evict_locked()
+{
+	while (entries.size() > max_entries) {
+		index.erase(entries.back().key);
+		entries.pop_back();
+		++counters.evictions;
+	}
+}
+
+void ParsedConfigCache::invalidate(const fs::path& path)
+{
+	struct stat info {};
+	if (::stat(path.c_str(), &info) != 0) {
+		return;
+	}
+
+	std::lock_guard lock(mutex);
+	auto found = index.find(FileKey{ info.st_dev, info.st_ino });
+	if (found != index.end()) {
+		entries.erase(found->second);
+		index.erase(found);
+	}
+}
+
+void ParsedConfigCache::clear()
+{
+	std::lock_guard lock(mutex);
+	entries.clear();
+	index.clear();
+}
+
+void ParsedConfigCache::setCapacity(std::size_t capacity)
+{
+	std::lock_guard lock(mutex);
+	max_entries = capacity;
+	evict_locked();
+}
+
+auto ParsedConfigCache::capacity() const -> std::size_t
+{
+	std::lock_guard lock(mutex);
+	return max_entries;
+}
+
+void ParsedConfigCache::setVerifyContent(bool enabled)
+{
+	std::lock_guard lock(mutex);
+	verify_content = enabled;
+}
+
+auto ParsedConfigCache::stats() const -> ParsedConfigCacheStats
+{
+	std::lock_guard lock(mutex);
+	auto result = counters;
+	result.entries = entries.size();
+	return result;
+}
+
+void ParsedConfigCache::resetStats()
+{
+	std::lock_guard lock(mutex);
+	counters = ParsedConfigCacheStats{};
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,522 @@
+/* Reactor.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "Reactor.hpp"
+
+#include "Exception.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <utility>
+
+#if defined(__linux__)
+#include <csignal>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+using IOCore::Reactor;
+
+#if defined(__linux__)
+namespace {
+[[noreturn]] void throw_system_error(const char* call)
+{
+	throw IOCore::Exception(
+	    std::string(call) + "() failed: " + std::strerror(errno)
+	);
+}
+
+// Source ids carry the slot's generation, so a stale id (or an event
+// collected before its source was removed) never reaches a reused slot
+constexpr auto make_id(std::uint32_t slot, std::uint32_t generation) noexcept
+    -> std::uint64_t
+{
+	return (std::uint64_t{ generation } << 32) | slot;
+}
+
+// The epoll_event payload for the reactor's own wake-up eventfd
+constexpr std::uint64_t kWakeEvent = ~std::uint64_t{ 0 };
+
+auto to_epoll_events(std::uint32_t events) noexcept -> std::uint32_t
+{
+	std::uint32_t result = EPOLLET;
+	if ((events & Reactor::Readable) != 0) {
+		result |= EPOLLIN | EPOLLRDHUP;
+	}
+	if ((events & Reactor::Writable) != 0) {
+		result |= EPOLLOUT;
+	}
+	return result;
+}
+
+auto from_epoll_events(std::uint32_t events) noexcept -> std::uint64_t
+{
+	std::uint64_t result = 0;
+	if ((events & EPOLLIN) != 0) {
+		result |= Reactor::Readable;
+	}
+	if ((events & EPOLLOUT) != 0) {
+		result |= Reactor::Writable;
+	}
+	if ((events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR)) != 0) {
+		result |= Reactor::Hangup;
+	}
+	return result;
+}
+
+auto to_timespec(std::chrono::nanoseconds duration) noexcept -> timespec
+{
+	timespec result{};
+	result.tv_sec = static_cast<time_t>(duration.count() / 1000000000);
+	result.tv_nsec = static_cast<long>(duration.count() % 1000000000);
+	return result;
+}
+
+auto set_timer(
+    int fd, std::chrono::nanoseconds initial, std::chrono::nanoseconds interval
+) noexcept -> bool
+{
+	itimerspec schedule{};
+	// A zero it_value would disarm the timer; fire as soon as possible
+	schedule.it_value = to_timespec(
+	    std::max(initial, std::chrono::nanoseconds{ 1 })
+	);
+	schedule.it_interval = to_timespec(interval);
+	return ::timerfd_settime(fd, 0, &schedule, nullptr) == 0;
+}
+
+// timerfd, eventfd and signalfd are drained completely, as required with
+// edge-triggered notification
+auto drain_counter(int fd) noexcept -> std::uint64_t
+{
+	std::uint64_t total = 0;
+	std::uint64_t value = 0;
+	while (::read(fd, &value, sizeof(value)) == sizeof(value)) {
+		total += value;
+	}
+	return total;
+}
+
+auto drain_signals(int fd) noexcept -> std::uint64_t
+{
+	signalfd_siginfo info{};
+	std::uint64_t count = 0;
+	while (::read(fd, &info, sizeof(info)) == sizeof(info)) {
+		++count;
+	}
+	return count;
+}
+} // namespace
+
+void Reactor::Notifier::notify() const noexcept
+{
+	std::uint64_t one = 1;
+	[[maybe_unused]] auto written = ::write(fd, &one, sizeof(one));
+}
+
+Reactor::Reactor()
+    : epoll_fd(::epoll_create1(EPOLL_CLOEXEC))
+    , ready_events(kMaxEventsPerWait)
+{
+	if (epoll_fd < 0) {
+		throw_system_error("epoll_create1");
+	}
+
+	wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wake_fd < 0) {
+		::close(epoll_fd);
+		throw_system_error("eventfd");
+	}
+
+	epoll_event event{};
+	event.events = EPOLLIN | EPOLLET;
+	event.data.u64 = kWakeEvent;
+	if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event) != 0) {
+		::close(wake_fd);
+		::close(epoll_fd);
+		throw_system_error("epoll_ctl");
+	}
+}
+
+Reactor::~Reactor()
+{
+	for (std::uint32_t slot = 0; slot < sources.size(); ++slot) {
+		if (sources[slot].active) {
+			remove(make_id(slot, sources[slot].generation));
+		}
+	}
+	::close(wake_fd);
+	::close(epoll_fd);
+}
+
+auto Reactor::add_source(
+    int fd,
+    SourceKind kind,
+    std::uint32_t epoll_events,
+    Callback&& callback,
+    int signal_number
+) -> SourceId
+{
+	std::uint32_t slot = 0;
+	if (free_slots.empty()) {
+		slot = static_cast<std::uint32_t>(sources.size());
+		sources.emplace_back();
+	} else {
+		slot = free_slots.back();
+		free_slots.pop_back();
+	}
+
+	auto& source = sources[slot];
+	auto id = make_id(slot, source.generation);
+
+	epoll_event event{};
+	event.events = epoll_events;
+	event.data.u64 = id;
+	if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+		free_slots.push_back(slot);
+		if (kind != SourceKind::Fd) {
+			::close(fd);
+		}
+		throw_system_error("epoll_ctl");
+	}
+
+	source.fd = fd;
+	source.kind = kind;
+	source.active = true;
+	source.signal_number = signal_number;
+	source.callback = std::move(callback);
+	return id;
+}
+
+auto Reactor::watchFd(int fd, std::uint32_t events, Callback callback)
+    -> SourceId
+{
+	return add_source(
+	    fd, SourceKind::Fd, to_epoll_events(events), std::move(callback)
+	);
+}
+
+auto Reactor::addTimer(
+    std::chrono::nanoseconds initial,
+    std::chrono::nanoseconds interval,
+    Callback callback
+) -> SourceId
+{
+	int fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0) {
+		throw_system_error("timerfd_create");
+	}
+
+	if (!set_timer(fd, initial, interval)) {
+		::close(fd);
+		throw_system_error("timerfd_settime");
+	}
+
+	return add_source(
+	    fd, SourceKind::Timer, EPOLLIN | EPOLLET, std::move(callback)
+	);
+}
+
+auto Reactor::find_timer(SourceId source_id) -> Source&
+{
+	auto slot = static_cast<std::uint32_t>(source_id);
+	auto generation = static_cast<std::uint32_t>(source_id >> 32);
+
+	if (slot >= sources.size() || !sources[slot].active ||
+	    sources[slot].generation != generation ||
+	    sources[slot].kind != SourceKind::Timer) {
+		throw IOCore::Exception("Reactor source is not an active timer");
+	}
+	return sources[slot];
+}
+
+void Reactor::rearmTimer(
+    SourceId timer,
+    std::chrono::nanoseconds initial,
+    std::chrono::nanoseconds interval
+)
+{
+	if (!set_timer(find_timer(timer).fd, initial, interval)) {
+		throw_system_error("timerfd_settime");
+	}
+}
+
+void Reactor::disarmTimer(SourceId timer)
+{
+	itimerspec disarmed{};
+	if (::timerfd_settime(find_timer(timer).fd, 0, &disarmed, nullptr) !=
+	    0) {
+		throw_system_error("timerfd_settime");
+	}
+}
+
+auto Reactor::addNotifier(Callback callback, Notifier* notifier) -> SourceId
+{
+	int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (fd < 0) {
+		throw_system_error("eventfd");
+	}
+
+	auto id = add_source(
+	    fd, SourceKind::Notifier, EPOLLIN | EPOLLET, std::move(callback)
+	);
+	*notifier = Notifier(fd);
+	return id;
+}
+
+auto Reactor::addSignal(int signal_number, Callback callback) -> SourceId
+{
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, signal_number);
+
+	sigset_t previous;
+	if (::pthread_sigmask(SIG_BLOCK, &signals, &previous) != 0) {
+		throw_system_error("pthread_sigmask");
+	}
+	bool was_blocked = sigismember(&previous, signal_number) == 1;
+
+	SourceId id = 0;
+	try {
+		int fd = ::signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+		if (fd < 0) {
+			throw_system_error("signalfd");
+		}
+		id = add_source(
+		    fd,
+		    SourceKind::Signal,
+		    EPOLLIN | EPOLLET,
+		    std::move(callback),
+		    signal_number
+		);
+	} catch (...) {
+		if (!was_blocked) {
+			::pthread_sigmask(SIG_UNBLOCK, &signals, nullptr);
+		}
+		throw;
+	}
+
+	sources[static_cast<std::uint32_t>(id)].unblock_on_remove =
+	    !was_blocked;
+	return id;
+}
+
+void Reactor::remove(SourceId source_id)
+{
+	auto slot = static_cast<std::uint32_t>(source_id);
+	auto generation = static_cast<std::uint32_t>(source_id >> 32);
+
+	if (slot >= sources.size()) {
+		return;
+	}
+	auto& source = sources[slot];
+	if (!source.active || source.generation != generation) {
+		return;
+	}
+
+	::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, source.fd, nullptr);
+	if (source.kind == SourceKind::Signal) {
+		// Consume what is pending, or unblocking would hand it to the
+		// default action (for SIGTERM: mid-teardown termination)
+		drain_signals(source.fd);
+
+		auto still_watched = std::any_of(
+		    sources.begin(), sources.end(), [&source](const Source& other) {
+			    return &other != &source && other.active &&
+			           other.kind == SourceKind::Signal &&
+			           other.signal_number == source.signal_number;
+		    }
+		);
+		if (source.unblock_on_remove && !still_watched) {
+			sigset_t signals;
+			sigemptyset(&signals);
+			sigaddset(&signals, source.signal_number);
+			::pthread_sigmask(SIG_UNBLOCK, &signals, nullptr);
+		}
+	}
+	if (source.kind != SourceKind::Fd) {
+		::close(source.fd);
+	}
+
+	// The callback may be the one running right now; it is released once
+	// the current batch has been dispatched
+	source.active = false;
+	source.fd = -1;
+	++source.generation;
+	retired_slots.push_back(slot);
+}
+
+void Reactor::dispatch(const epoll_event& event)
+{
+	auto slot = static_cast<std::uint32_t>(event.data.u64);
+	auto generation = static_cast<std::uint32_t>(event.data.u64 >> 32);
+	auto& source = sources[slot];
+
+	if (!source.active || source.generation != generation) {
+		return; // removed earlier in this batch
+	}
+
+	std::uint64_t argument = 0;
+	switch (source.kind) {
+	case SourceKind::Fd:
+		argument = from_epoll_events(event.events);
+		break;
+	case SourceKind::Timer:
+	case SourceKind::Notifier:
+		argument = drain_counter(source.fd);
+		if (argument == 0) {
+			return;
+		}
+		break;
+	case SourceKind::Signal:
+		if (drain_signals(source.fd) == 0) {
+			return;
+		}
+		argument = static_cast<std::uint64_t>(source.signal_number);
+		break;
+	}
+	source.callback(argument);
+}
+
+auto Reactor::runOnce(std::chrono::milliseconds timeout) -> std::size_t
+{
+	int ready = ::epoll_wait(
+	    epoll_fd,
+	    ready_events.data(),
+	    static_cast<int>(ready_events.size()),
+	    (timeout.count() < 0) ? -1 : static_cast<int>(timeout.count())
+	);
+	if (ready < 0) {
+		if (errno == EINTR) {
+			return 0;
+		}
+		throw_system_error("epoll_wait");
+	}
+
+	std::size_t dispatched = 0;
+	std::exception_ptr error;
+	for (int index = 0; index < ready; ++index) {
+		const auto& event = ready_events[static_cast<std::size_t>(index)];
+		if (event.data.u64 == kWakeEvent) {
+			drain_counter(wake_fd);
+			continue;
+		}
+		try {
+			dispatch(event);
+		} catch (...) {
+			if (!error) {
+				error = std::current_exception();
+			}
+		}
+		++dispatched;
+	}
+
+	for (auto slot : retired_slots) {
+		sources[slot].callback = nullptr;
+		free_slots.push_back(slot);
+	}
+	retired_slots.clear();
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	return dispatched;
+}
+
+auto Reactor::run() -> int
+{
+	while (!stopped.load(std::memory_order_acquire)) {
+		runOnce(std::chrono::milliseconds{ -1 });
+	}
+	// Leave the reactor ready for another run()
+	stopped.store(false, std::memory_order_relaxed);
+	return exit_code.load(std::memory_order_relaxed);
+}
+
+void Reactor::stop(int code) noexcept
+{
+	exit_code.store(code, std::memory_order_relaxed);
+	stopped.store(true, std::memory_order_release);
+	Notifier(wake_fd).notify();
+}
+
+#else // !defined(__linux__)
+
+// epoll, timerfd, eventfd and signalfd are Linux-only; a Reactor cannot be
+// constructed elsewhere, so the remaining members are never reached.
+
+void Reactor::Notifier::notify() const noexcept {}
+
+Reactor::Reactor()
+{
+	throw NotImplementedException();
+}
+
+Reactor::~Reactor() = default;
+
+auto Reactor::watchFd(int, std::uint32_t, Callback) -> SourceId
+{
+	throw NotImplementedException();
+}
+
+auto Reactor::addTimer(
+    std::chrono::nanoseconds, std::chrono::nanoseconds, Callback
+) -> SourceId
+{
+	throw NotImplementedException();
+}
+
+void Reactor::rearmTimer(
+    SourceId, std::chrono::nanoseconds, std::chrono::nanoseconds
+)
+{
+	throw NotImplementedException();
+}
+
+void Reactor::disarmTimer(SourceId)
+{
+	throw NotImplementedException();
+}
+
+auto Reactor::addNotifier(Callback, Notifier*) -> SourceId
+{
+	throw NotImplementedException();
+}
+
+auto Reactor::addSignal(int, Callback) -> SourceId
+{
+	throw NotImplementedException();
+}
+
+void Reactor::remove(SourceId) {}
+
+auto Reactor::run() -> int
+{
+	throw NotImplementedException();
+}
+
+auto Reactor::runOnce(std::chrono::milliseconds) -> std::size_t
+{
+	throw NotImplementedException();
+}
+
+void Reactor::stop(int) noexcept {}
+
+#endif
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
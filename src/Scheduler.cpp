@@ -0,0 +1,164 @@
+/* Scheduler.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "Scheduler.hpp"
+
+#include "Exception.hpp"
+#include "FileResource.hpp"
+#include "TomlConfigFile.hpp"
+#include "sys/durable_write.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <utility>
+
+using IOCore::Scheduler;
+using IOCore::Task;
+
+void Scheduler::ExecutorAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+	executor->submit([handle]() { handle.resume(); });
+}
+
+void Scheduler::LoopAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+	scheduler->post_to_loop(LoopRequest{ handle, delay });
+}
+
+Scheduler::Scheduler(Executor& executor, Reactor* reactor)
+    : executor(executor), reactor(reactor)
+{
+	if (reactor != nullptr) {
+		loop_source = reactor->addNotifier(
+		    [this](std::uint64_t) { run_loop_requests(); },
+		    &loop_notifier
+		);
+		sleep_wheel.attach(*reactor);
+	}
+}
+
+Scheduler::~Scheduler()
+{
+	if (reactor != nullptr) {
+		sleep_wheel.detach();
+		reactor->remove(loop_source);
+	}
+}
+
+auto Scheduler::resumeOnLoop() -> LoopAwaiter
+{
+	return sleepFor(std::chrono::nanoseconds{ -1 });
+}
+
+auto Scheduler::sleepFor(std::chrono::nanoseconds duration) -> LoopAwaiter
+{
+	if (reactor == nullptr) {
+		throw IOCore::Exception("Scheduler has no reactor to resume on");
+	}
+	return LoopAwaiter(*this, duration);
+}
+
+void Scheduler::report_error(std::exception_ptr error) noexcept
+{
+	try {
+		executor.submit([error]() { std::rethrow_exception(error); });
+	} catch (...) { // NOLINT(bugprone-empty-catch)
+		// A stopping executor has no waitIdle() left to rethrow from
+	}
+}
+
+void Scheduler::post_to_loop(const LoopRequest& request)
+{
+	{
+		std::lock_guard lock(loop_mutex);
+		loop_requests.push_back(request);
+	}
+	loop_notifier.notify();
+}
+
+void Scheduler::run_loop_requests()
+{
+	{
+		std::lock_guard lock(loop_mutex);
+		loop_batch.swap(loop_requests);
+	}
+
+	for (const auto& request : loop_batch) {
+		if (request.delay.count() < 0) {
+			request.handle.resume();
+			continue;
+		}
+
+		std::size_t index = 0;
+		if (free_sleepers.empty()) {
+			index = sleepers.size();
+			sleepers.emplace_back(*this, index);
+		} else {
+			index = free_sleepers.back();
+			free_sleepers.pop_back();
+		}
+		auto& sleeper = sleepers[index];
+		sleeper.handle = request.handle;
+		// From now rather than the wheel's time, which only moves
+		// when a timer fires
+		sleep_wheel.schedule(
+		    sleeper,
+		    TimerWheel::Clock::now() +
+			std::chrono::duration_cast<TimerWheel::Clock::duration>(
+			    request.delay
+			)
+		);
+	}
+	loop_batch.clear();
+}
+
+void Scheduler::wake_sleeper(Timer& timer)
+{
+	auto& sleeper = static_cast<Sleeper&>(timer);
+	auto handle = std::exchange(sleeper.handle, nullptr);
+	sleeper.scheduler->free_sleepers.push_back(sleeper.index);
+	handle.resume();
+}
+
+auto Scheduler::readFile(const FileResource& file) -> Task<std::string>
+{
+	co_await schedule();
+
+	std::ifstream stream(file.getFilePath(), std::ios::binary);
+	if (!stream.is_open()) {
+		throw IOCore::Exception(
+		    "Error opening " + file.getFilePath().string() +
+		    " for reading"
+		);
+	}
+	co_return std::string(
+	    std::istreambuf_iterator<char>(stream),
+	    std::istreambuf_iterator<char>()
+	);
+}
+
+auto Scheduler::writeFile(const FileResource& file, std::string contents)
+    -> Task<void>
+{
+	co_await schedule();
+
+	// Readers see the old or the new contents, never a torn write
+	write_file_atomically(file.getFilePath(), contents, file.getSyncMode());
+}
+
+auto Scheduler::reloadConfig(TomlConfigFile& config) -> Task<void>
+{
+	co_await schedule();
+	config.read();
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
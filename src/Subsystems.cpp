@@ -0,0 +1,277 @@
+/* Subsystems.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "Subsystems.hpp"
+
+#include "Executor.hpp"
+#include "sys/startup_profiler.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using IOCore::SubsystemException;
+using IOCore::SubsystemGraph;
+using IOCore::SubsystemTiming;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+auto describe(const std::exception_ptr& error) -> std::string
+{
+	try {
+		std::rethrow_exception(error);
+	} catch (const std::exception& exception) {
+		return exception.what();
+	} catch (...) {
+		return "unknown exception";
+	}
+}
+} // namespace
+
+struct SubsystemGraph::Run {
+	explicit Run(Executor& executor) : executor(executor) {}
+
+	Executor& executor;
+	Clock::time_point began = Clock::now();
+
+	std::mutex mutex;
+	std::condition_variable done;
+	std::size_t remaining = 0;
+	std::exception_ptr first_error;
+	std::string failed_subsystem;
+
+	/// Keeps the exception being handled if it is the first failure
+	void recordFailure(const std::string& subsystem)
+	{
+		std::lock_guard lock(mutex);
+		if (!first_error) {
+			first_error = std::current_exception();
+			failed_subsystem = subsystem;
+		}
+	}
+};
+
+void SubsystemGraph::add(
+    std::string name,
+    std::vector<std::string> dependencies,
+    Initializer initializer
+)
+{
+	if (index_by_name.contains(name)) {
+		throw SubsystemException("Subsystem registered twice", name);
+	}
+	index_by_name.emplace(name, nodes.size());
+
+	auto& node = nodes.emplace_back();
+	node.name = std::move(name);
+	node.dependency_names = std::move(dependencies);
+	node.initializer = std::move(initializer);
+}
+
+void SubsystemGraph::resolve()
+{
+	for (auto& node : nodes) {
+		node.dependents.clear();
+	}
+	for (std::size_t index = 0; index < nodes.size(); ++index) {
+		auto& node = nodes[index];
+		node.dependency_count = node.dependency_names.size();
+
+		for (const auto& dependency : node.dependency_names) {
+			auto found = index_by_name.find(dependency);
+			if (found == index_by_name.end()) {
+				throw SubsystemException(
+				    "Unknown dependency '" + dependency + "'",
+				    node.name
+				);
+			}
+			nodes[found->second].dependents.push_back(index);
+		}
+	}
+
+	// Kahn's algorithm on a scratch copy of the counters; anything left
+	// over sits on a cycle or behind one
+	std::vector<std::size_t> waiting(nodes.size());
+	std::vector<std::size_t> ready;
+	for (std::size_t index = 0; index < nodes.size(); ++index) {
+		waiting[index] = nodes[index].dependency_count;
+		if (waiting[index] == 0) {
+			ready.push_back(index);
+		}
+	}
+	std::size_t visited = 0;
+	while (!ready.empty()) {
+		auto index = ready.back();
+		ready.pop_back();
+		++visited;
+		for (auto dependent : nodes[index].dependents) {
+			if (--waiting[dependent] == 0) {
+				ready.push_back(dependent);
+			}
+		}
+	}
+	if (visited != nodes.size()) {
+		auto cycle = find_cycle();
+		throw SubsystemException(
+		    "Dependency cycle: " + cycle,
+		    cycle.substr(0, cycle.find(' '))
+		);
+	}
+}
+
+auto SubsystemGraph::find_cycle() const -> std::string
+{
+	enum class Mark : std::uint8_t { Unvisited, OnPath, Done };
+	std::vector<Mark> marks(nodes.size(), Mark::Unvisited);
+	std::vector<std::size_t> path;
+	std::string cycle;
+
+	// Depth-first along dependency edges until a node on the current
+	// path is reached again
+	std::function<bool(std::size_t)> visit = [&](std::size_t index) {
+		marks[index] = Mark::OnPath;
+		path.push_back(index);
+		for (const auto& name : nodes[index].dependency_names) {
+			auto next = index_by_name.at(name);
+			if (marks[next] == Mark::OnPath) {
+				auto first = std::find(path.begin(), path.end(), next);
+				for (auto it = first; it != path.end(); ++it) {
+					cycle += nodes[*it].name + " -> ";
+				}
+				cycle += nodes[next].name;
+				return true;
+			}
+			if (marks[next] == Mark::Unvisited && visit(next)) {
+				return true;
+			}
+		}
+		path.pop_back();
+		marks[index] = Mark::Done;
+		return false;
+	};
+
+	for (std::size_t index = 0; index < nodes.size(); ++index) {
+		if (marks[index] == Mark::Unvisited && visit(index)) {
+			break;
+		}
+	}
+	return cycle;
+}
+
+void SubsystemGraph::initialize(Executor& executor)
+{
+	resolve();
+	if (nodes.empty()) {
+		return;
+	}
+
+	Run run(executor);
+	run.remaining = nodes.size();
+
+	std::vector<std::size_t> roots;
+	for (std::size_t index = 0; index < nodes.size(); ++index) {
+		auto& node = nodes[index];
+		node.waiting_on.store(
+		    node.dependency_count, std::memory_order_relaxed
+		);
+		node.blocked.store(false, std::memory_order_relaxed);
+		node.timing = SubsystemTiming{ node.name };
+		if (node.dependency_count == 0) {
+			roots.push_back(index);
+		}
+	}
+	// Roots are collected first, since they may finish and release other
+	// nodes while later roots are still being started
+	for (auto index : roots) {
+		start(run, index);
+	}
+
+	std::unique_lock lock(run.mutex);
+	run.done.wait(lock, [&run]() { return run.remaining == 0; });
+
+	if (run.first_error) {
+		throw SubsystemException(
+		    "Subsystem initialization failed: " +
+			describe(run.first_error),
+		    run.failed_subsystem,
+		    run.first_error
+		);
+	}
+}
+
+void SubsystemGraph::start(Run& run, std::size_t index)
+{
+	if (nodes[index].blocked.load(std::memory_order_acquire)) {
+		finish(run, index, false);
+		return;
+	}
+
+	try {
+		run.executor.submit([this, &run, index]() {
+			auto& node = nodes[index];
+			auto started = Clock::now();
+			bool succeeded = true;
+			try {
+				StartupPhase phase("subsystem", node.name);
+				node.initializer();
+			} catch (...) {
+				succeeded = false;
+				run.recordFailure(node.name);
+			}
+			node.timing.start = started - run.began;
+			node.timing.duration = Clock::now() - started;
+			node.timing.ran = true;
+			finish(run, index, succeeded);
+		});
+	} catch (...) {
+		// Refused, e.g. by a stopping executor; the node still has to
+		// finish, or initialize() would wait for it forever
+		run.recordFailure(nodes[index].name);
+		finish(run, index, false);
+	}
+}
+
+void SubsystemGraph::finish(Run& run, std::size_t index, bool succeeded)
+{
+	for (auto dependent : nodes[index].dependents) {
+		if (!succeeded) {
+			nodes[dependent].blocked.store(
+			    true, std::memory_order_release
+			);
+		}
+		if (nodes[dependent].waiting_on.fetch_sub(
+			1, std::memory_order_acq_rel
+		    ) == 1) {
+			start(run, dependent);
+		}
+	}
+
+	// The waiting thread may destroy `run` as soon as this unlocks
+	std::lock_guard lock(run.mutex);
+	if (--run.remaining == 0) {
+		run.done.notify_all();
+	}
+}
+
+auto SubsystemGraph::timings() const -> std::vector<SubsystemTiming>
+{
+	std::vector<SubsystemTiming> result;
+	result.reserve(nodes.size());
+	for (const auto& node : nodes) {
+		result.push_back(node.timing);
+	}
+	return result;
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
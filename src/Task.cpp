@@ -0,0 +1,99 @@
+/* Task.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "Task.hpp"
+
+#include <array>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace {
+// Frames are rounded up to a multiple of kGranularity; one free list per
+// size class up to kMaxPooledSize
+constexpr std::size_t kGranularity = 64;
+constexpr std::size_t kMaxPooledSize = 4096;
+constexpr std::size_t kClassCount = kMaxPooledSize / kGranularity;
+constexpr std::size_t kMaxFreePerClass = 256;
+
+struct FreeFrame {
+	FreeFrame* next;
+};
+
+struct FrameCache {
+	std::array<FreeFrame*, kClassCount> heads{};
+	std::array<std::size_t, kClassCount> sizes{};
+	IOCore::FrameAllocatorStats stats;
+
+	~FrameCache()
+	{
+		for (auto& head : heads) {
+			while (head != nullptr) {
+				::operator delete(std::exchange(head, head->next));
+			}
+		}
+	}
+};
+thread_local FrameCache frame_cache;
+
+constexpr auto size_class(std::size_t size) noexcept -> std::size_t
+{
+	return (size + kGranularity - 1) / kGranularity - 1;
+}
+} // namespace
+
+namespace IOCore {
+
+auto coroutine_detail::allocate_frame(std::size_t size) -> void*
+{
+	if (size > kMaxPooledSize) {
+		++frame_cache.stats.fresh;
+		return ::operator new(size);
+	}
+
+	auto index = size_class(size);
+	auto*& head = frame_cache.heads[index];
+	if (head == nullptr) {
+		++frame_cache.stats.fresh;
+		return ::operator new((index + 1) * kGranularity);
+	}
+
+	++frame_cache.stats.recycled;
+	--frame_cache.sizes[index];
+	return std::exchange(head, head->next);
+}
+
+void coroutine_detail::deallocate_frame(void* frame, std::size_t size) noexcept
+{
+	if (size > kMaxPooledSize) {
+		::operator delete(frame);
+		return;
+	}
+
+	// A frame may finish on another thread than the one that created it;
+	// it then joins that thread's cache
+	auto index = size_class(size);
+	if (frame_cache.sizes[index] >= kMaxFreePerClass) {
+		::operator delete(frame);
+		return;
+	}
+	frame_cache.heads[index] = ::new (frame)
+	    FreeFrame{ frame_cache.heads[index] };
+	++frame_cache.sizes[index];
+}
+
+auto frame_allocator_stats() noexcept -> FrameAllocatorStats
+{
+	return frame_cache.stats;
+}
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
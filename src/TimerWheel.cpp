@@ -0,0 +1,316 @@
+/* TimerWheel.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "TimerWheel.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+using IOCore::Timer;
+using IOCore::TimerWheel;
+
+namespace {
+// First set bit at or after \p from, or TimerWheel::kSlots
+template<typename TBitmap>
+auto find_next_slot(const TBitmap& bitmap, unsigned from) noexcept -> unsigned
+{
+	for (auto word = from / 64; word < bitmap.size(); ++word) {
+		auto bits = bitmap[word];
+		if (word == from / 64) {
+			bits &= ~std::uint64_t{ 0 } << (from % 64);
+		}
+		if (bits != 0) {
+			return word * 64 +
+			       static_cast<unsigned>(std::countr_zero(bits));
+		}
+	}
+	return TimerWheel::kSlots;
+}
+
+constexpr auto digit(std::uint64_t tick, unsigned level) noexcept -> unsigned
+{
+	return static_cast<unsigned>(
+	    (tick >> (level * TimerWheel::kSlotBits)) & (TimerWheel::kSlots - 1)
+	);
+}
+} // namespace
+
+Timer::~Timer()
+{
+	if (wheel != nullptr) {
+		wheel->cancel(*this);
+	}
+}
+
+TimerWheel::TimerWheel(
+    std::chrono::nanoseconds resolution, Clock::time_point start
+)
+    : origin(start), resolution(std::max(resolution, std::chrono::nanoseconds{ 1 }))
+{
+}
+
+TimerWheel::~TimerWheel()
+{
+	detach();
+
+	// Orphan whatever is still armed so the timers' destructors do not
+	// reach back into a dead wheel
+	auto orphan_all = [](timer_detail::ListHook& list) {
+		while (!list.empty()) {
+			auto& timer = *static_cast<Timer*>(list.next);
+			timer.unlink();
+			timer.wheel = nullptr;
+		}
+	};
+	for (auto& level : wheels) {
+		for (auto& slot : level) {
+			orphan_all(slot);
+		}
+	}
+	orphan_all(overflow);
+	orphan_all(expired);
+}
+
+auto TimerWheel::to_tick_floor(Clock::time_point time) const -> std::uint64_t
+{
+	if (time <= origin) {
+		return 0;
+	}
+	return static_cast<std::uint64_t>((time - origin) / resolution);
+}
+
+auto TimerWheel::to_tick_ceil(Clock::time_point time) const -> std::uint64_t
+{
+	if (time <= origin) {
+		return 0;
+	}
+	auto elapsed = static_cast<std::uint64_t>((time - origin).count());
+	auto step = static_cast<std::uint64_t>(resolution.count());
+	return (elapsed + step - 1) / step;
+}
+
+auto TimerWheel::to_time(std::uint64_t tick) const noexcept
+    -> Clock::time_point
+{
+	return origin + std::chrono::duration_cast<Clock::duration>(
+			    resolution * static_cast<std::int64_t>(tick)
+			);
+}
+
+void TimerWheel::schedule(Timer& timer, Clock::time_point deadline)
+{
+	if (timer.wheel != nullptr) {
+		timer.wheel->cancel(timer);
+	}
+
+	timer.deadline = std::max(to_tick_ceil(deadline), current_tick + 1);
+	timer.wheel = this;
+	++timer_count;
+	insert(timer);
+
+	if (reactor != nullptr && !delivering && timer.deadline < armed_tick) {
+		rearm_reactor_timer();
+	}
+}
+
+void TimerWheel::schedule(Timer& timer, std::chrono::nanoseconds delay)
+{
+	schedule(
+	    timer,
+	    now() + std::chrono::duration_cast<Clock::duration>(delay)
+	);
+}
+
+void TimerWheel::cancel(Timer& timer) noexcept
+{
+	if (timer.wheel != this) {
+		return;
+	}
+
+	timer.unlink();
+	if (timer.level < kLevels &&
+	    wheels[timer.level][timer.slot].empty()) {
+		occupied[timer.level][timer.slot / 64] &=
+		    ~(std::uint64_t{ 1 } << (timer.slot % 64));
+	}
+	timer.wheel = nullptr;
+	--timer_count;
+}
+
+void TimerWheel::insert(Timer& timer)
+{
+	// Timers go on the level of the most significant digit in which their
+	// deadline differs from the current tick, so a slot's timers all share
+	// the current tick's higher digits
+	auto difference = timer.deadline ^ current_tick;
+	auto level = (difference == 0)
+	                 ? 0U
+	                 : static_cast<unsigned>(std::bit_width(difference) - 1) /
+	                       kSlotBits;
+
+	if (level >= kLevels) {
+		timer.level = kOverflowLevel;
+		overflow.pushBack(timer);
+		return;
+	}
+
+	auto slot = digit(timer.deadline, level);
+	timer.level = static_cast<std::uint8_t>(level);
+	timer.slot = static_cast<std::uint8_t>(slot);
+	wheels[level][slot].pushBack(timer);
+	occupied[level][slot / 64] |= std::uint64_t{ 1 } << (slot % 64);
+}
+
+void TimerWheel::cascade(unsigned level, unsigned slot)
+{
+	auto& list = wheels[level][slot];
+	occupied[level][slot / 64] &= ~(std::uint64_t{ 1 } << (slot % 64));
+
+	while (!list.empty()) {
+		auto& timer = *static_cast<Timer*>(list.next);
+		timer.unlink();
+		insert(timer);
+	}
+}
+
+auto TimerWheel::next_event_tick() const noexcept -> std::uint64_t
+{
+	for (unsigned level = 0; level < kLevels; ++level) {
+		auto slot = find_next_slot(
+		    occupied[level], digit(current_tick, level) + 1
+		);
+		if (slot < kSlots) {
+			auto shift = (level + 1) * kSlotBits;
+			auto higher = (current_tick >> shift) << shift;
+			return higher |
+			       (std::uint64_t{ slot } << (level * kSlotBits));
+		}
+	}
+	if (!overflow.empty()) {
+		constexpr auto kShift = kLevels * kSlotBits;
+		return ((current_tick >> kShift) + 1) << kShift;
+	}
+	return kNoTick;
+}
+
+void TimerWheel::collect_expired(std::uint64_t target)
+{
+	while (current_tick < target) {
+		auto next = next_event_tick();
+		if (next == kNoTick || next > target) {
+			current_tick = target;
+			break;
+		}
+		current_tick = next;
+
+		// Cascade from the top, so timers can fall several levels
+		// within one tick
+		constexpr auto kWheelSpan = std::uint64_t{ 1 }
+		                            << (kLevels * kSlotBits);
+		if (current_tick % kWheelSpan == 0) {
+			timer_detail::ListHook pending;
+			while (!overflow.empty()) {
+				auto* hook = overflow.next;
+				hook->unlink();
+				pending.pushBack(*hook);
+			}
+			while (!pending.empty()) {
+				auto& timer = *static_cast<Timer*>(pending.next);
+				timer.unlink();
+				insert(timer);
+			}
+		}
+		for (auto level = kLevels - 1; level > 0; --level) {
+			auto span = std::uint64_t{ 1 } << (level * kSlotBits);
+			if (current_tick % span == 0) {
+				cascade(level, digit(current_tick, level));
+			}
+		}
+
+		auto slot = digit(current_tick, 0);
+		auto& list = wheels[0][slot];
+		occupied[0][slot / 64] &= ~(std::uint64_t{ 1 } << (slot % 64));
+		while (!list.empty()) {
+			auto& timer = *static_cast<Timer*>(list.next);
+			timer.unlink();
+			timer.level = kExpiredLevel;
+			expired.pushBack(timer);
+		}
+	}
+}
+
+auto TimerWheel::advance(Clock::time_point now) -> std::size_t
+{
+	return advance(now, [](Timer& timer) {
+		if (timer.callback != nullptr) {
+			timer.callback(timer);
+		}
+	});
+}
+
+auto TimerWheel::nextDeadline() const -> std::optional<Clock::time_point>
+{
+	auto tick = next_event_tick();
+	if (tick == kNoTick) {
+		return std::nullopt;
+	}
+	return to_time(tick);
+}
+
+void TimerWheel::attach(Reactor& loop)
+{
+	IOCORE_ASSERT(reactor == nullptr);
+	reactor = &loop;
+	reactor_timer = loop.addTimer(
+	    std::chrono::hours{ 1 },
+	    std::chrono::nanoseconds{ 0 },
+	    [this](std::uint64_t) {
+		    // The timerfd is one-shot; whatever was armed has fired
+		    armed_tick = kNoTick;
+		    advance(Clock::now());
+		    rearm_reactor_timer();
+	    }
+	);
+	armed_tick = kNoTick;
+	rearm_reactor_timer();
+}
+
+void TimerWheel::detach() noexcept
+{
+	if (reactor != nullptr) {
+		reactor->remove(reactor_timer);
+		reactor = nullptr;
+		armed_tick = kNoTick;
+	}
+}
+
+void TimerWheel::rearm_reactor_timer()
+{
+	auto next = next_event_tick();
+	if (next == armed_tick) {
+		return;
+	}
+	armed_tick = next;
+
+	if (next == kNoTick) {
+		reactor->disarmTimer(reactor_timer);
+		return;
+	}
+	auto delay = to_time(next) - Clock::now();
+	reactor->rearmTimer(
+	    reactor_timer,
+	    std::max<std::chrono::nanoseconds>(delay, std::chrono::nanoseconds{ 1 }),
+	    std::chrono::nanoseconds{ 0 }
+	);
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
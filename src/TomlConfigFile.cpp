@@ -11,7 +11,9 @@
 #include "util/toml.hpp"
 
 #include "Exception.hpp"
+#include "ParsedConfigCache.hpp"
 #include "sys/debuginfo.hpp"
+#include "sys/startup_profiler.hpp"
 
 #include <filesystem>
 #include <fstream>
@@ -25,8 +27,6 @@
 namespace fs = std::filesystem;
 
 namespace impl {
-static std::stringstream error_buffer;
-
 enum IndentMode : int {
 	Disabled = 0,
 	Enabled = 1,
@@ -51,31 +51,31 @@ TomlConfigFile::~TomlConfigFile() = default;
 
 auto TomlConfigFile::read() -> IOCore::TomlTable&
 {
+	auto table = readShared();
+
+	//// An empty file leaves whatever was set() in place
+	if (!table->empty()) {
+		config_toml = *table;
+	}
+	return this->config_toml;
+}
+
+auto TomlConfigFile::readShared() const
+    -> std::shared_ptr<const IOCore::TomlTable>
+{
+	StartupPhase phase("TomlConfigFile::read", file_path.native());
+
 	try {
-		std::ifstream file_stream(file_path);
-
-		if (!file_stream.is_open()) {
-			error_buffer.str("");
-			error_buffer
-			    << "Error opening TomlConfigFile for reading: "
-			    << file_path << std::endl;
-			throw IOCore::Exception(error_buffer.str());
-		}
-
-		//// If the file is empty, do not try to open it and parse TOML
-		if (file_stream.peek() != std::ifstream::traits_type::eof()) {
-			config_toml = toml::parse(file_stream);
-		}
+		return ParsedConfigCache::global().load(file_path);
 	} catch (IOCore::Exception& except) {
 		throw;
 	} catch (const std::exception& e) {
-		error_buffer.str("");
-		error_buffer << "TomlConfigFile::Read() error" << std::endl
-			     << e.what() << std::flush;
-		throw IOCore::Exception(error_buffer.str());
+		// Local, since readShared() may run on several threads at once
+		std::ostringstream message;
+		message << "TomlConfigFile::Read() error" << std::endl
+			<< e.what();
+		throw IOCore::Exception(message.str());
 	}
-
-	return this->config_toml;
 }
 
 void TomlConfigFile::write()
@@ -84,30 +84,26 @@ void TomlConfigFile::write()
 	using toml::toml_formatter;
 
 	try {
-		std::ofstream file_stream(file_path);
-		if (!file_stream.is_open()) {
-			error_buffer.str("");
-			error_buffer << "Error opening TomlConfigFile "
-					"for writing: "
-				     << file_path << std::endl;
-			throw IOCore::Exception(error_buffer.str());
-		}
-
 		auto formatter =
 		    toml_formatter{ config_toml,
 			            toml_formatter::default_flags &
 			                ~format_flags::indent_sub_tables };
-		file_stream << formatter << std::endl;
+		std::ostringstream contents;
+		contents << formatter << std::endl;
 
+		// The rename gives the file a new inode, so drop the old
+		// inode's entry while the path still leads to it
+		ParsedConfigCache::global().invalidate(file_path);
+		replace_contents(contents.view());
 		return;
 	} catch (IOCore::Exception& except) {
 		throw;
 	} catch (const std::exception& e) {
 
-		error_buffer.str("");
-		error_buffer << "TomlConfigFile::Save() error: " << std::endl
-			     << e.what() << std::flush;
-		throw IOCore::Exception(error_buffer.str());
+		std::ostringstream message;
+		message << "TomlConfigFile::Save() error: " << std::endl
+			<< e.what();
+		throw IOCore::Exception(message.str());
 	}
 }
 } // namespace elemental::configuration
@@ -0,0 +1,125 @@
+/* WatchedTomlConfigFile.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "WatchedTomlConfigFile.hpp"
+
+#include "Exception.hpp"
+#include "sys/startup_profiler.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using IOCore::TomlTable;
+using IOCore::WatchedTomlConfigFile;
+
+WatchedTomlConfigFile::WatchedTomlConfigFile(
+    const fs::path& file_path, CreateDirs mode
+)
+    : FileResource(file_path, mode), current(parse())
+{
+}
+
+WatchedTomlConfigFile::~WatchedTomlConfigFile()
+{
+	unwatch();
+}
+
+auto WatchedTomlConfigFile::parse() const -> std::unique_ptr<const TomlTable>
+{
+	StartupPhase phase("WatchedTomlConfigFile::parse", file_path.native());
+
+	auto table = std::make_unique<TomlTable>();
+	if (!fs::exists(file_path)) {
+		return table;
+	}
+
+	try {
+		std::ifstream file_stream(file_path);
+		if (!file_stream.is_open()) {
+			throw IOCore::Exception(
+			    "Error opening WatchedTomlConfigFile for reading: " +
+			    file_path.string()
+			);
+		}
+
+		// An empty file is an empty table, not a parse error
+		if (file_stream.peek() != std::ifstream::traits_type::eof()) {
+			*table = toml::parse(file_stream);
+		}
+	} catch (IOCore::Exception&) {
+		throw;
+	} catch (const std::exception& e) {
+		throw IOCore::Exception(
+		    "WatchedTomlConfigFile::reload() error in " +
+		    file_path.string() + "\n" + e.what()
+		);
+	}
+	return table;
+}
+
+void WatchedTomlConfigFile::reload()
+{
+	std::lock_guard lock(reload_mutex);
+	publish_locked(parse());
+}
+
+void WatchedTomlConfigFile::publish_locked(
+    std::unique_ptr<const TomlTable> table
+)
+{
+	std::vector<std::string> changed_paths;
+	{
+		auto previous = current.read();
+		changed_paths = diff_toml(*previous, *table);
+	}
+
+	const auto& published_table = *table;
+	current.publish(std::move(table));
+	published.fetch_add(1, std::memory_order_acq_rel);
+
+	// Safe without a read guard: only a later publish() can retire it,
+	// and that needs reload_mutex
+	on_reloaded(published_table, changed_paths);
+	if (!changed_paths.empty()) {
+		subscriptions.notify(changed_paths, published_table);
+	}
+}
+
+void WatchedTomlConfigFile::watch(Reactor& reactor)
+{
+	watcher = std::make_unique<FileWatcher>(reactor, file_path, [this]() {
+		std::lock_guard lock(reload_mutex);
+
+		std::unique_ptr<const TomlTable> table;
+		try {
+			table = parse();
+		} catch (const IOCore::Exception&) {
+			// Half-written or invalid files keep the last good table
+			failures.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		// Callback errors are not parse failures; let the loop see them
+		publish_locked(std::move(table));
+	});
+}
+
+void WatchedTomlConfigFile::on_reloaded(
+    const TomlTable& /*table*/, const std::vector<std::string>& /*changed_paths*/
+)
+{
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
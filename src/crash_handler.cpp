@@ -0,0 +1,338 @@
+/* crash_handler.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sys/crash_handler.hpp"
+
+#include "Exception.hpp"
+#include "sys/debuginfo.hpp"
+
+#if defined(BOOST_STACKTRACER)
+#include <boost/stacktrace/safe_dump_to.hpp>
+#elif defined(HAVE_EXECINFO_H)
+#include <execinfo.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+namespace IOCore {
+namespace {
+constexpr std::array kCrashSignals = { SIGSEGV, SIGBUS, SIGILL, SIGABRT, SIGFPE };
+constexpr std::size_t kAltStackSize = 64 * 1024;
+constexpr std::size_t kMaxCrashFrames = 128;
+
+int crash_fd = -1;
+std::array<struct sigaction, kCrashSignals.size()> previous_actions;
+bool installed = false;
+
+// Signal-safe output helpers. #region
+void write_all(const char* data, std::size_t size) noexcept
+{
+	while (size > 0) {
+		auto written = ::write(crash_fd, data, size);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			return;
+		}
+		data += written;
+		size -= static_cast<std::size_t>(written);
+	}
+}
+
+void write_text(const char* text) noexcept
+{
+	write_all(text, std::strlen(text));
+}
+
+void write_hex(std::uintptr_t value) noexcept
+{
+	char digits[2 + sizeof(value) * 2];
+	std::size_t pos = sizeof(digits);
+
+	do {
+		digits[--pos] = "0123456789abcdef"[value & 0xf];
+		value >>= 4;
+	} while (value != 0);
+	digits[--pos] = 'x';
+	digits[--pos] = '0';
+	write_all(digits + pos, sizeof(digits) - pos);
+}
+
+void write_decimal(std::uint64_t value) noexcept
+{
+	char digits[20];
+	std::size_t pos = sizeof(digits);
+
+	do {
+		digits[--pos] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+	write_all(digits + pos, sizeof(digits) - pos);
+}
+// #endregion
+
+auto signal_name(int signal_number) noexcept -> const char*
+{
+	switch (signal_number) {
+	case SIGSEGV:
+		return "SIGSEGV";
+	case SIGBUS:
+		return "SIGBUS";
+	case SIGILL:
+		return "SIGILL";
+	case SIGABRT:
+		return "SIGABRT";
+	case SIGFPE:
+		return "SIGFPE";
+	default:
+		return "unknown";
+	}
+}
+
+auto thread_id() noexcept -> std::uint64_t
+{
+#if defined(__linux__)
+	return static_cast<std::uint64_t>(::syscall(SYS_gettid));
+#elif defined(__APPLE__)
+	std::uint64_t tid = 0;
+	pthread_threadid_np(nullptr, &tid);
+	return tid;
+#else
+	return reinterpret_cast<std::uintptr_t>(pthread_self());
+#endif
+}
+
+// Reads the interrupted program counter and frame pointer
+void context_registers(
+    void* context, std::uintptr_t& program_counter, std::uintptr_t& frame
+) noexcept
+{
+	auto* ucontext = static_cast<ucontext_t*>(context);
+	program_counter = 0;
+	frame = 0;
+
+	if (ucontext == nullptr) {
+		return;
+	}
+#if defined(__linux__) && defined(__x86_64__)
+	program_counter = ucontext->uc_mcontext.gregs[REG_RIP];
+	frame = ucontext->uc_mcontext.gregs[REG_RBP];
+#elif defined(__linux__) && defined(__aarch64__)
+	program_counter = ucontext->uc_mcontext.pc;
+	frame = ucontext->uc_mcontext.regs[29];
+#elif defined(__FreeBSD__) && defined(__x86_64__)
+	program_counter = ucontext->uc_mcontext.mc_rip;
+	frame = ucontext->uc_mcontext.mc_rbp;
+#elif defined(__APPLE__) && defined(__x86_64__)
+	program_counter = ucontext->uc_mcontext->__ss.__rip;
+	frame = ucontext->uc_mcontext->__ss.__rbp;
+#elif defined(__APPLE__) && defined(__aarch64__)
+	program_counter = ucontext->uc_mcontext->__ss.__pc;
+	frame = ucontext->uc_mcontext->__ss.__fp;
+#endif
+}
+
+// An unwinder started inside the handler first reports the handler and
+// the kernel's signal trampoline; drops everything up to the interrupted
+// instruction, which collect_frames() records itself
+auto skip_handler_frames(
+    void** frames, std::size_t count, std::uintptr_t program_counter
+) noexcept -> std::size_t
+{
+	for (std::size_t i = 0; i < count; ++i) {
+		auto address = reinterpret_cast<std::uintptr_t>(frames[i]);
+		if (address == program_counter || address == program_counter + 1) {
+			std::copy(frames + i + 1, frames + count, frames);
+			return count - i - 1;
+		}
+	}
+	return count;
+}
+
+// Frame 0 is always the interrupted instruction (0 if unknown); the rest
+// are return addresses, which iocore-symbolize steps back into the call
+auto collect_frames(void* context, void** frames) noexcept -> std::size_t
+{
+	std::uintptr_t program_counter = 0;
+	std::uintptr_t frame = 0;
+	context_registers(context, program_counter, frame);
+
+	frames[0] = reinterpret_cast<void*>(program_counter);
+	auto** callers = frames + 1;
+	constexpr auto kMaxCallers = kMaxCrashFrames - 1;
+
+#if defined(HAVE_FRAME_POINTERS)
+	return 1 + walk_frame_pointers_from(
+		       reinterpret_cast<void*>(frame), callers, kMaxCallers
+		   );
+#elif defined(BOOST_STACKTRACER)
+	auto dumped = boost::stacktrace::safe_dump_to(
+	    callers, kMaxCallers * sizeof(void*)
+	);
+	auto count = (dumped > 0) ? dumped - 1 : 0;
+	return 1 + skip_handler_frames(callers, count, program_counter);
+#elif defined(HAVE_EXECINFO_H)
+	// Unwinds through the signal frame; warmed up at install time
+	auto count = static_cast<std::size_t>(
+	    ::backtrace(callers, static_cast<int>(kMaxCallers))
+	);
+	return 1 + skip_handler_frames(callers, count, program_counter);
+#else
+	return 1 + walk_frame_pointers_from(
+		       reinterpret_cast<void*>(frame), callers, kMaxCallers
+		   );
+#endif
+}
+
+void copy_memory_map() noexcept
+{
+#if defined(__linux__)
+	int maps = ::open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+	if (maps < 0) {
+		return;
+	}
+
+	char buffer[4096];
+	ssize_t count = 0;
+	while ((count = ::read(maps, buffer, sizeof(buffer))) > 0) {
+		write_all(buffer, static_cast<std::size_t>(count));
+	}
+	::close(maps);
+#endif
+}
+
+void crash_signal_handler(int signal_number, siginfo_t* info, void* context)
+{
+	// On the (alternate) stack, since several threads may crash at once
+	void* frames[kMaxCrashFrames];
+	auto saved_errno = errno;
+
+	write_text("*** IOCore crash report ***\nsignal ");
+	write_decimal(static_cast<std::uint64_t>(signal_number));
+	write_text(" ");
+	write_text(signal_name(signal_number));
+	write_text("\nfault_address ");
+	write_hex(reinterpret_cast<std::uintptr_t>(
+	    info != nullptr ? info->si_addr : nullptr
+	));
+	write_text("\nthread ");
+	write_decimal(thread_id());
+	write_text("\n");
+
+	auto count = collect_frames(context, frames);
+	for (std::size_t i = 0; i < count; ++i) {
+		write_text("frame ");
+		write_hex(reinterpret_cast<std::uintptr_t>(frames[i]));
+		write_text("\n");
+	}
+
+	write_text("maps\n");
+	copy_memory_map();
+	write_text("end\n");
+
+	errno = saved_errno;
+
+	// SA_RESETHAND restored the default action; let it kill the process
+	::raise(signal_number);
+}
+} // namespace
+
+void prepare_crash_handler_thread()
+{
+	thread_local std::unique_ptr<char[]> alternate_stack;
+
+	if (!alternate_stack) {
+		auto size = std::max<std::size_t>(kAltStackSize, SIGSTKSZ);
+		alternate_stack = std::make_unique<char[]>(size);
+
+		stack_t stack{};
+		stack.ss_sp = alternate_stack.get();
+		stack.ss_size = size;
+		if (::sigaltstack(&stack, nullptr) != 0) {
+			alternate_stack.reset();
+			throw IOCore::Exception(
+			    "sigaltstack() failed: " +
+			    std::string(std::strerror(errno))
+			);
+		}
+	}
+
+	// Looks up this thread's stack bounds and loads the unwinder now,
+	// since neither is safe to do inside the handler
+	void* warm_up[2];
+	walk_frame_pointers(warm_up, 2);
+#if defined(HAVE_EXECINFO_H) && !defined(BOOST_STACKTRACER)
+	::backtrace(warm_up, 2);
+#endif
+}
+
+void install_crash_handler(int output_fd)
+{
+	prepare_crash_handler_thread();
+	crash_fd = output_fd;
+
+	if (installed) {
+		return;
+	}
+
+	struct sigaction action {};
+	action.sa_sigaction = crash_signal_handler;
+	action.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+	sigemptyset(&action.sa_mask);
+
+	for (std::size_t i = 0; i < kCrashSignals.size(); ++i) {
+		if (::sigaction(kCrashSignals[i], &action, &previous_actions[i]) !=
+		    0) {
+			auto error = std::string(std::strerror(errno));
+			// Leave no signal half-hooked
+			while (i-- > 0) {
+				::sigaction(
+				    kCrashSignals[i], &previous_actions[i], nullptr
+				);
+			}
+			throw IOCore::Exception("sigaction() failed: " + error);
+		}
+	}
+	installed = true;
+}
+
+void uninstall_crash_handler()
+{
+	if (!installed) {
+		return;
+	}
+	for (std::size_t i = 0; i < kCrashSignals.size(); ++i) {
+		::sigaction(kCrashSignals[i], &previous_actions[i], nullptr);
+	}
+	installed = false;
+}
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=marker foldmarker=#region,#endregion textwidth=80 ts=8 sts=0 sw=8  noexpandtab ft=cpp.doxygen :
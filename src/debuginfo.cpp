@@ -9,6 +9,11 @@
 
 #include "sys/debuginfo.hpp"
 #include "sys/platform.hpp"
+#include "sys/symbol_cache.hpp"
+
+#if defined(ELF_STACKTRACER)
+#include "sys/elf_symbolizer.hpp"
+#endif
 
 #if !defined(BOOST_STACKTRACER)
 #if defined(HAVE_EXECINFO_H)
@@ -19,6 +24,13 @@
 #include <boost/stacktrace.hpp>
 #endif
 
+#include <pthread.h>
+#if defined(__FreeBSD__)
+#include <pthread_np.h>
+#endif
+
+#include <cstdint>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -28,7 +40,7 @@ namespace IOCore {
 namespace {
 
 // Extracts the mangled symbol from a string like <func_name+0x34>
-auto extract_mangled_symbol(const std::string& input) -> std::string
+[[maybe_unused]] auto extract_mangled_symbol(const std::string& input) -> std::string
 {
 	std::string result;
 	bool inside_angle_brackets = false;
@@ -55,17 +67,208 @@ auto extract_mangled_symbol(const std::string& input) -> std::string
 }
 } // namespace
 
+namespace {
+// Frames larger than this are treated as a corrupt chain
+constexpr std::uintptr_t kMaxFrameSize = 1 << 20;
+
+struct StackBounds {
+	std::uintptr_t low = 0;
+	std::uintptr_t high = 0;
+};
+
+auto lookup_stack_bounds() noexcept -> StackBounds
+{
+	StackBounds bounds;
+	void* stack_address = nullptr;
+	size_t stack_size = 0;
+
+#if defined(__linux__) || defined(__FreeBSD__)
+	pthread_attr_t attributes;
+#if defined(__linux__)
+	if (pthread_getattr_np(pthread_self(), &attributes) != 0) {
+		return bounds;
+	}
+#else
+	pthread_attr_init(&attributes);
+	if (pthread_attr_get_np(pthread_self(), &attributes) != 0) {
+		pthread_attr_destroy(&attributes);
+		return bounds;
+	}
+#endif
+	pthread_attr_getstack(&attributes, &stack_address, &stack_size);
+	pthread_attr_destroy(&attributes);
+
+	bounds.low = reinterpret_cast<std::uintptr_t>(stack_address);
+	bounds.high = bounds.low + stack_size;
+#elif defined(__APPLE__)
+	// macOS reports the top (highest address) of the stack
+	stack_address = pthread_get_stackaddr_np(pthread_self());
+	stack_size = pthread_get_stacksize_np(pthread_self());
+
+	bounds.high = reinterpret_cast<std::uintptr_t>(stack_address);
+	bounds.low = bounds.high - stack_size;
+#endif
+	return bounds;
+}
+
+thread_local bool stack_bounds_known = false;
+thread_local StackBounds stack_bounds;
+
+auto current_stack_bounds() noexcept -> const StackBounds&
+{
+	if (!stack_bounds_known) {
+		stack_bounds = lookup_stack_bounds();
+		stack_bounds_known = true;
+	}
+	return stack_bounds;
+}
+
+auto is_valid_frame(void** frame, const StackBounds& bounds) noexcept -> bool
+{
+	auto address = reinterpret_cast<std::uintptr_t>(frame);
+
+	if (address == 0 || (address % alignof(void*)) != 0) {
+		return false;
+	}
+	if (bounds.high != 0) {
+		return address >= bounds.low &&
+		       address + 2 * sizeof(void*) <= bounds.high;
+	}
+	return true;
+}
+
+auto walk_chain(
+    void** frame,
+    const StackBounds& bounds,
+    void** buffer,
+    std::size_t maxDepth,
+    unsigned short framesToRemove
+) noexcept -> std::size_t
+{
+	std::size_t depth = 0;
+
+	// Each frame record is { saved frame pointer, return address }
+	while (depth < maxDepth && is_valid_frame(frame, bounds)) {
+		void* return_address = frame[1];
+		if (return_address == nullptr) {
+			break;
+		}
+
+		if (framesToRemove > 0) {
+			--framesToRemove;
+		} else {
+			buffer[depth++] = return_address;
+		}
+
+		auto** next = static_cast<void**>(frame[0]);
+		auto step = reinterpret_cast<std::uintptr_t>(next) -
+		            reinterpret_cast<std::uintptr_t>(frame);
+
+		// The stack grows down, so callers always live above callees
+		if (next <= frame || step > kMaxFrameSize) {
+			break;
+		}
+		frame = next;
+	}
+	return depth;
+}
+} // namespace
+
+[[gnu::noinline]] auto walk_frame_pointers(
+    void** buffer, std::size_t maxDepth, unsigned short framesToRemove
+) noexcept -> std::size_t
+{
+	return walk_chain(
+	    static_cast<void**>(__builtin_frame_address(0)),
+	    current_stack_bounds(),
+	    buffer,
+	    maxDepth,
+	    framesToRemove
+	);
+}
+
+auto walk_frame_pointers_from(
+    const void* framePointer, void** buffer, std::size_t maxDepth
+) noexcept -> std::size_t
+{
+	// Never look the bounds up here; that is not async-signal-safe
+	StackBounds bounds = stack_bounds_known ? stack_bounds : StackBounds{};
+
+	return walk_chain(
+	    static_cast<void**>(const_cast<void*>(framePointer)),
+	    bounds,
+	    buffer,
+	    maxDepth,
+	    0
+	);
+}
+
+auto capture_stackframes_fp(unsigned short framesToRemove) noexcept
+    -> StackFrames
+{
+	StackFrames frames;
+	frames.count = static_cast<unsigned short>(walk_frame_pointers(
+	    frames.addresses.data(), kMaxStackFrames, framesToRemove
+	));
+	return frames;
+}
+
+auto capture_stackframes(unsigned short framesToRemove) noexcept
+    -> StackFrames
+{
+	StackFrames frames;
+
+#if defined(HAVE_FRAME_POINTERS)
+	frames.count = static_cast<unsigned short>(walk_frame_pointers(
+	    frames.addresses.data(), kMaxStackFrames, framesToRemove
+	));
+#elif !defined(BOOST_STACKTRACER)
+	void* callstack[kMaxStackFrames];
+	int captured = backtrace(callstack, kMaxStackFrames);
+
+	if (framesToRemove >= captured) {
+		framesToRemove = 0;
+	}
+
+	for (int i = framesToRemove; i < captured; ++i) {
+		frames.addresses[frames.count++] = callstack[i];
+	}
+#else
+	auto dumped = boost::stacktrace::safe_dump_to(
+	    framesToRemove, frames.addresses.data(), sizeof(frames.addresses)
+	);
+	// safe_dump_to() null-terminates the dump and counts the terminator
+	frames.count = (dumped > 0) ? dumped - 1 : 0;
+#endif
+	return frames;
+}
+
+namespace {
 // There are a lot of C and platform-specific hacks contained within
 // I am sorry. 🤡
-auto generate_stacktrace(unsigned short framesToRemove) -> std::string
+auto format_frame(void* address) -> std::string
 {
-
 	std::stringstream buffer;
 
-#ifndef BOOST_STACKTRACER
-	void* callstack[128];
-	int i, frames = backtrace(callstack, 128);
-	char** strs = backtrace_symbols(callstack, frames);
+#if defined(ELF_STACKTRACER)
+	// Return addresses point past the call; step back into it
+	auto* call_site = static_cast<char*>(address) - 1;
+	auto info = ElfSymbolizer::global().resolve(call_site);
+
+	if (!info) {
+		buffer << address;
+	} else if (info->function.empty() && info->file.empty()) {
+		buffer << address << " in " << info->module;
+	} else {
+		buffer << (info->function.empty() ? "??" : info->function);
+		if (!info->file.empty()) {
+			buffer << " at " << info->file << ':' << info->line;
+		} else {
+			buffer << " in " << info->module;
+		}
+	}
+#elif !defined(BOOST_STACKTRACER)
+	char** strs = backtrace_symbols(&address, 1);
 
 	size_t columns_to_print = 0;
 
@@ -76,57 +279,77 @@ auto generate_stacktrace(unsigned short framesToRemove) -> std::string
 		columns_to_print = 4;
 	}
 
-	if (framesToRemove == frames) {
-		framesToRemove = 0;
-	}
+	std::string word;
+	std::stringstream line_stream(strs[0]);
+	std::vector<std::string> wordlist;
 
-	for (i = framesToRemove; i < frames; ++i) {
-		std::string word;
-		std::stringstream line_stream(strs[i]);
-		std::vector<std::string> wordlist;
-
-		// Create a list of words for this stack trace line
-		while (line_stream >> word) {
-			if (columns_to_print != 0 &&
-			    (word.find('<') != word.npos &&
-			     word.find('>') != word.npos)) {
-				auto extracted_symbol =
-				    extract_mangled_symbol(word);
-				word = extracted_symbol;
-			}
-			wordlist.push_back(word);
+	// Create a list of words for this stack trace line
+	while (line_stream >> word) {
+		if (columns_to_print != 0 && (word.find('<') != word.npos &&
+		                              word.find('>') != word.npos)) {
+			auto extracted_symbol = extract_mangled_symbol(word);
+			word = extracted_symbol;
 		}
-		// if columns_to_print is still 0, assign it to the list length
-		// It is only pre-configured for certain platforms, see above
-		if (!columns_to_print) {
-			columns_to_print = wordlist.size();
-		}
-		// Process the extracted words one at a time and format the
-		// stack trace string
-		for (unsigned pos = 0; pos < columns_to_print; ++pos) {
-			auto word = wordlist[pos];
-			int status;
-
-			char* demangled_symbol = abi::__cxa_demangle(
-			    word.c_str(), nullptr, nullptr, &status
-			);
-
-			if (status == 0) {
-				buffer << demangled_symbol << '\t';
-				std::free(demangled_symbol);
-			} else {
-				buffer << word << '\t';
-			}
+		wordlist.push_back(word);
+	}
+	// if columns_to_print is still 0, assign it to the list length
+	// It is only pre-configured for certain platforms, see above
+	if (!columns_to_print || columns_to_print > wordlist.size()) {
+		columns_to_print = wordlist.size();
+	}
+	// Process the extracted words one at a time and format the
+	// stack trace string
+	for (unsigned pos = 0; pos < columns_to_print; ++pos) {
+		auto word = wordlist[pos];
+		int status;
+
+		char* demangled_symbol =
+		    abi::__cxa_demangle(word.c_str(), nullptr, nullptr, &status);
+
+		if (status == 0) {
+			buffer << demangled_symbol << '\t';
+			std::free(demangled_symbol);
+		} else {
+			buffer << word << '\t';
 		}
-		buffer << std::endl;
 	}
 	std::free(strs);
 #else
-	buffer << boost::stacktrace::stacktrace() << std::flush;
+	buffer << boost::stacktrace::frame(address);
+#endif
+	return buffer.str();
+}
+} // namespace
+
+auto symbolize_stacktrace(const StackFrames& frames) -> std::string
+{
+	std::stringstream buffer;
+	auto& cache = SymbolCache::global();
+	[[maybe_unused]] unsigned index = 0;
+
+	for (void* address : frames) {
+#if defined(BOOST_STACKTRACER) || defined(ELF_STACKTRACER)
+		buffer << std::setw(2) << index << "# ";
 #endif
+		if (const char* cached = cache.lookup(address)) {
+			buffer << cached;
+		} else {
+			auto text = format_frame(address);
+			cache.insert(address, text);
+			buffer << text;
+		}
+		buffer << '\n';
+		++index;
+	}
 	return buffer.str();
 }
 
+auto generate_stacktrace(unsigned short framesToRemove) -> std::string
+{
+	// +1 hides this function's own frame from the caller
+	return symbolize_stacktrace(capture_stackframes(framesToRemove + 1));
+}
+
 void print_cmdline(int argc, const char* argv[])
 {
 	int i;
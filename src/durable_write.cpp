@@ -0,0 +1,287 @@
+/* durable_write.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sys/durable_write.hpp"
+
+#include "Exception.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace IOCore {
+namespace {
+std::atomic<std::uint64_t> sync_requests{ 0 };
+std::atomic<std::uint64_t> syncs_issued{ 0 };
+std::atomic<std::uint64_t> temp_counter{ 0 };
+std::atomic<durable_write_detail::SyncHook> sync_hook{ nullptr };
+
+void notify_hook(durable_write_detail::SyncEvent event)
+{
+	if (auto* hook = sync_hook.load(std::memory_order_acquire)) {
+		hook(event);
+	}
+}
+
+auto failure(const char* call, const fs::path& path) -> IOCore::Exception
+{
+	return IOCore::Exception(
+	    std::string(call) + " failed for " + path.string() + ": " +
+	    std::strerror(errno)
+	);
+}
+
+void fsync_directory(const fs::path& directory)
+{
+	syncs_issued.fetch_add(1, std::memory_order_relaxed);
+	notify_hook(durable_write_detail::SyncEvent::Syncing);
+
+	int descriptor =
+	    ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (descriptor < 0) {
+		throw failure("open()", directory);
+	}
+	if (::fsync(descriptor) != 0) {
+		auto error = failure("fsync()", directory);
+		::close(descriptor);
+		throw error;
+	}
+	::close(descriptor);
+}
+
+// One round of directory fsync; every writer that joined it before it
+// started shares its outcome
+struct Batch {
+	bool done = false;
+	std::exception_ptr error;
+};
+
+struct DirectoryGroup {
+	std::mutex mutex;
+	std::condition_variable synced;
+	std::shared_ptr<Batch> pending; ///< collecting writers, not started
+	bool syncing = false;
+};
+
+// Groups live for the rest of the process; there is one per directory
+// that config files are written to, so the map stays small
+auto directory_group(const fs::path& directory) -> DirectoryGroup&
+{
+	static std::mutex groups_mutex;
+	static std::unordered_map<std::string, std::unique_ptr<DirectoryGroup>>
+	    groups;
+
+	auto key = fs::absolute(directory).lexically_normal().native();
+
+	std::lock_guard lock(groups_mutex);
+	auto& group = groups[key];
+	if (!group) {
+		group = std::make_unique<DirectoryGroup>();
+	}
+	return *group;
+}
+
+void group_commit(const fs::path& directory)
+{
+	auto& group = directory_group(directory);
+	std::unique_lock lock(group.mutex);
+
+	if (!group.pending) {
+		group.pending = std::make_shared<Batch>();
+	}
+	auto batch = group.pending;
+	notify_hook(durable_write_detail::SyncEvent::Joined);
+
+	while (!batch->done) {
+		if (group.syncing) {
+			group.synced.wait(lock);
+			continue;
+		}
+
+		// Nobody is syncing, so our batch is still the pending one;
+		// lead it, letting later writers gather into the next
+		group.syncing = true;
+		group.pending.reset();
+		lock.unlock();
+
+		std::exception_ptr error;
+		try {
+			fsync_directory(directory);
+		} catch (...) {
+			error = std::current_exception();
+		}
+
+		lock.lock();
+		batch->done = true;
+		batch->error = error;
+		group.syncing = false;
+		group.synced.notify_all();
+	}
+
+	if (batch->error) {
+		std::rethrow_exception(batch->error);
+	}
+}
+
+// An O_EXCL temporary beside its target, removed unless renamed over it
+class TempFile {
+    public:
+	explicit TempFile(const fs::path& target)
+	    : path(target.parent_path() /
+	           ("." + target.filename().string() + ".tmp." +
+	            std::to_string(::getpid()) + "." +
+	            std::to_string(temp_counter.fetch_add(1))))
+	{
+		// 0666 so the umask decides, as it did for std::ofstream
+		descriptor = ::open(
+		    path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666
+		);
+		if (descriptor < 0) {
+			throw failure("open()", path);
+		}
+	}
+
+	~TempFile()
+	{
+		if (descriptor >= 0) {
+			::close(descriptor);
+		}
+		if (!renamed) {
+			::unlink(path.c_str());
+		}
+	}
+
+	TempFile(const TempFile&) = delete;
+	auto operator=(const TempFile&) -> TempFile& = delete;
+
+	void write(std::string_view contents)
+	{
+		while (!contents.empty()) {
+			auto written =
+			    ::write(descriptor, contents.data(), contents.size());
+			if (written < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				throw failure("write()", path);
+			}
+			contents.remove_prefix(static_cast<std::size_t>(written));
+		}
+	}
+
+	void copyPermissions(const fs::path& target)
+	{
+		struct stat info {};
+		if (::stat(target.c_str(), &info) == 0 &&
+		    ::fchmod(descriptor, info.st_mode & 07777) != 0) {
+			throw failure("fchmod()", path);
+		}
+	}
+
+	// Only the data has to reach the disk before the rename; the
+	// rename itself is made durable by the directory fsync
+	void sync()
+	{
+#if defined(__APPLE__)
+		if (::fsync(descriptor) != 0) {
+			throw failure("fsync()", path);
+		}
+#else
+		if (::fdatasync(descriptor) != 0) {
+			throw failure("fdatasync()", path);
+		}
+#endif
+		// close() can report deferred write errors (e.g. on NFS)
+		int closing = descriptor;
+		descriptor = -1;
+		if (::close(closing) != 0) {
+			throw failure("close()", path);
+		}
+	}
+
+	void renameOver(const fs::path& target)
+	{
+		if (::rename(path.c_str(), target.c_str()) != 0) {
+			throw failure("rename()", target);
+		}
+		renamed = true;
+	}
+
+    private:
+	fs::path path;
+	int descriptor = -1;
+	bool renamed = false;
+};
+} // namespace
+
+void write_file_atomically(
+    const fs::path& path, std::string_view contents, SyncMode mode
+)
+{
+	// Replacing a symlink would turn it into a regular file; replace the
+	// file it points to instead
+	auto target = path;
+	std::error_code error;
+	if (fs::is_symlink(path, error)) {
+		auto resolved = fs::canonical(path, error);
+		if (!error) {
+			target = resolved;
+		}
+	}
+
+	TempFile temp(target);
+	temp.copyPermissions(target);
+	temp.write(contents);
+	temp.sync();
+	temp.renameOver(target);
+
+	auto directory = target.parent_path();
+	sync_directory(directory.empty() ? fs::path(".") : directory, mode);
+}
+
+void sync_directory(const fs::path& directory, SyncMode mode)
+{
+	sync_requests.fetch_add(1, std::memory_order_relaxed);
+
+	if (mode == SyncMode::GroupCommit) {
+		group_commit(directory);
+	} else {
+		fsync_directory(directory);
+	}
+}
+
+auto directory_sync_stats() noexcept -> DirectorySyncStats
+{
+	return DirectorySyncStats{
+		sync_requests.load(std::memory_order_relaxed),
+		syncs_issued.load(std::memory_order_relaxed),
+	};
+}
+
+void durable_write_detail::set_sync_hook(SyncHook hook) noexcept
+{
+	sync_hook.store(hook, std::memory_order_release);
+}
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,951 @@
+/* elf_symbolizer.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sys/elf_symbolizer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cxxabi.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace IOCore {
+namespace {
+
+// DWARF constants used by the line table reader. #region
+enum LineStandardOpcode : std::uint8_t {
+	DW_LNS_copy = 0x01,
+	DW_LNS_advance_pc = 0x02,
+	DW_LNS_advance_line = 0x03,
+	DW_LNS_set_file = 0x04,
+	DW_LNS_const_add_pc = 0x08,
+	DW_LNS_fixed_advance_pc = 0x09,
+};
+enum LineExtendedOpcode : std::uint8_t {
+	DW_LNE_end_sequence = 0x01,
+	DW_LNE_set_address = 0x02,
+	DW_LNE_define_file = 0x03,
+};
+enum LineContentType : std::uint64_t {
+	DW_LNCT_path = 0x1,
+	DW_LNCT_directory_index = 0x2,
+};
+enum Form : std::uint64_t {
+	DW_FORM_block = 0x09,
+	DW_FORM_data1 = 0x0b,
+	DW_FORM_data2 = 0x05,
+	DW_FORM_data4 = 0x06,
+	DW_FORM_data8 = 0x07,
+	DW_FORM_data16 = 0x1e,
+	DW_FORM_string = 0x08,
+	DW_FORM_strp = 0x0e,
+	DW_FORM_udata = 0x0f,
+	DW_FORM_line_strp = 0x1f,
+};
+// #endregion
+
+/// Bounds-checked little cursor over a byte range
+struct Reader {
+	const std::uint8_t* pos;
+	const std::uint8_t* end;
+	bool failed = false;
+
+	[[nodiscard]] auto remaining() const -> std::size_t
+	{
+		return static_cast<std::size_t>(end - pos);
+	}
+
+	template<typename TValue>
+	auto fixed() -> TValue
+	{
+		TValue value{};
+		if (remaining() < sizeof(TValue)) {
+			failed = true;
+			pos = end;
+			return value;
+		}
+		std::memcpy(&value, pos, sizeof(TValue));
+		pos += sizeof(TValue);
+		return value;
+	}
+
+	auto sized(std::size_t size) -> std::uint64_t
+	{
+		switch (size) {
+		case 1:
+			return fixed<std::uint8_t>();
+		case 2:
+			return fixed<std::uint16_t>();
+		case 4:
+			return fixed<std::uint32_t>();
+		case 8:
+			return fixed<std::uint64_t>();
+		default:
+			failed = true;
+			pos = end;
+			return 0;
+		}
+	}
+
+	auto uleb() -> std::uint64_t
+	{
+		std::uint64_t result = 0;
+		unsigned shift = 0;
+		while (pos < end) {
+			auto byte = *pos++;
+			if (shift < 64) {
+				result |= std::uint64_t(byte & 0x7f) << shift;
+			}
+			shift += 7;
+			if ((byte & 0x80) == 0) {
+				return result;
+			}
+		}
+		failed = true;
+		return result;
+	}
+
+	auto sleb() -> std::int64_t
+	{
+		std::int64_t result = 0;
+		unsigned shift = 0;
+		std::uint8_t byte = 0;
+		while (pos < end) {
+			byte = *pos++;
+			if (shift < 64) {
+				result |= std::int64_t(byte & 0x7f) << shift;
+			}
+			shift += 7;
+			if ((byte & 0x80) == 0) {
+				if (shift < 64 && (byte & 0x40) != 0) {
+					result |= -(std::int64_t(1) << shift);
+				}
+				return result;
+			}
+		}
+		failed = true;
+		return result;
+	}
+
+	auto cstring() -> std::string_view
+	{
+		auto* start = pos;
+		while (pos < end && *pos != 0) {
+			++pos;
+		}
+		if (pos == end) {
+			failed = true;
+			return {};
+		}
+		std::string_view result(
+		    reinterpret_cast<const char*>(start),
+		    static_cast<std::size_t>(pos - start)
+		);
+		++pos;
+		return result;
+	}
+
+	void skip(std::size_t count)
+	{
+		if (count > remaining()) {
+			failed = true;
+			pos = end;
+			return;
+		}
+		pos += count;
+	}
+};
+
+auto string_at(std::string_view table, std::uint64_t offset) -> std::string_view
+{
+	if (offset >= table.size()) {
+		return {};
+	}
+	auto tail = table.substr(offset);
+	return tail.substr(0, tail.find('\0'));
+}
+
+auto demangle(std::string_view symbol) -> std::string
+{
+	std::string name(symbol);
+	int status = 0;
+	char* demangled =
+	    abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+
+	if (status == 0 && demangled != nullptr) {
+		name = demangled;
+	}
+	std::free(demangled);
+	return name;
+}
+
+} // namespace
+
+/// A read-only mapping of one ELF file plus its sorted symbol and line
+/// indexes. Immutable once constructed.
+class ElfSymbolizer::ElfImage {
+    public:
+	explicit ElfImage(const std::string& path) : path(path)
+	{
+		if (map_file()) {
+			index_sections();
+		}
+	}
+
+	~ElfImage()
+	{
+		if (mapping != nullptr) {
+			::munmap(mapping, mapping_size);
+		}
+	}
+
+	ElfImage(const ElfImage&) = delete;
+	auto operator=(const ElfImage&) -> ElfImage& = delete;
+
+	/// Maps a file offset to its link-time address via the PT_LOAD
+	/// program headers
+	auto offsetToAddress(std::uint64_t offset) const
+	    -> std::optional<std::uintptr_t>
+	{
+		for (const auto& segment : segments) {
+			if (offset >= segment.offset &&
+			    offset < segment.offset + segment.size) {
+				return segment.address + (offset - segment.offset);
+			}
+		}
+		return std::nullopt;
+	}
+
+	auto lookup(std::uintptr_t address) const -> SymbolInfo
+	{
+		SymbolInfo info;
+		info.module = path;
+
+		auto symbol = std::upper_bound(
+		    symbols.begin(),
+		    symbols.end(),
+		    address,
+		    [](std::uintptr_t addr, const Symbol& sym) {
+			    return addr < sym.start;
+		    }
+		);
+		if (symbol != symbols.begin()) {
+			--symbol;
+			if (symbol->size == 0 ||
+			    address < symbol->start + symbol->size) {
+				info.function = demangle(symbol->name);
+				info.offset = address - symbol->start;
+			}
+		}
+
+		auto row = std::upper_bound(
+		    rows.begin(),
+		    rows.end(),
+		    address,
+		    [](std::uintptr_t addr, const LineRow& line_row) {
+			    return addr < line_row.address;
+		    }
+		);
+		if (row != rows.begin()) {
+			--row;
+			if (!row->end_sequence) {
+				info.file = files[row->file];
+				info.line = row->line;
+			}
+		}
+		return info;
+	}
+
+    private:
+	struct Symbol {
+		std::uintptr_t start;
+		std::uintptr_t size;
+		std::string_view name;
+	};
+	struct Segment {
+		std::uint64_t offset;
+		std::uint64_t size;
+		std::uintptr_t address;
+	};
+	struct LineRow {
+		std::uintptr_t address;
+		std::uint32_t file;
+		std::uint32_t line;
+		bool end_sequence;
+	};
+	struct LineHeader {
+		std::uint16_t version = 0;
+		std::uint8_t address_size = sizeof(void*);
+		std::uint8_t offset_size = 4;
+		std::uint8_t min_instruction_length = 1;
+		bool default_is_stmt = true;
+		std::int8_t line_base = 0;
+		std::uint8_t line_range = 1;
+		std::uint8_t opcode_base = 1;
+		const std::uint8_t* opcode_lengths = nullptr;
+		std::vector<std::string> directories;
+		std::vector<std::uint32_t> files; // indexes into this->files
+	};
+
+	auto map_file() -> bool
+	{
+		int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (descriptor < 0) {
+			return false;
+		}
+
+		struct stat file_info {};
+		if (::fstat(descriptor, &file_info) == 0 &&
+		    static_cast<std::size_t>(file_info.st_size) >=
+			sizeof(ElfW(Ehdr))) {
+			mapping_size = static_cast<std::size_t>(file_info.st_size);
+			mapping = ::mmap(
+			    nullptr,
+			    mapping_size,
+			    PROT_READ,
+			    MAP_PRIVATE,
+			    descriptor,
+			    0
+			);
+			if (mapping == MAP_FAILED) {
+				mapping = nullptr;
+			}
+		}
+		::close(descriptor);
+
+		if (mapping == nullptr) {
+			return false;
+		}
+
+		auto* header = static_cast<const ElfW(Ehdr)*>(mapping);
+		return std::memcmp(header->e_ident, ELFMAG, SELFMAG) == 0 &&
+		       header->e_ident[EI_CLASS] ==
+			   (sizeof(void*) == 8 ? ELFCLASS64 : ELFCLASS32);
+	}
+
+	auto section_data(const ElfW(Shdr) & section) const -> std::string_view
+	{
+		if (section.sh_type == SHT_NOBITS ||
+		    (section.sh_flags & SHF_COMPRESSED) != 0 ||
+		    section.sh_offset + section.sh_size > mapping_size) {
+			return {};
+		}
+		return { static_cast<const char*>(mapping) + section.sh_offset,
+			 section.sh_size };
+	}
+
+	void index_sections()
+	{
+		auto* base = static_cast<const std::uint8_t*>(mapping);
+		auto* header = reinterpret_cast<const ElfW(Ehdr)*>(base);
+
+		if (header->e_phoff != 0 &&
+		    header->e_phoff + header->e_phnum * sizeof(ElfW(Phdr)) <=
+			mapping_size) {
+			auto* program_headers = reinterpret_cast<const ElfW(Phdr)*>(
+			    base + header->e_phoff
+			);
+			for (unsigned i = 0; i < header->e_phnum; ++i) {
+				const auto& segment = program_headers[i];
+				if (segment.p_type == PT_LOAD) {
+					segments.push_back(
+					    { segment.p_offset,
+					      segment.p_filesz,
+					      segment.p_vaddr }
+					);
+				}
+			}
+		}
+
+		if (header->e_shoff == 0 ||
+		    header->e_shoff + header->e_shnum * sizeof(ElfW(Shdr)) >
+			mapping_size ||
+		    header->e_shstrndx >= header->e_shnum) {
+			return;
+		}
+
+		auto* sections =
+		    reinterpret_cast<const ElfW(Shdr)*>(base + header->e_shoff);
+		auto names = section_data(sections[header->e_shstrndx]);
+
+		const ElfW(Shdr)* symtab = nullptr;
+		const ElfW(Shdr)* dynsym = nullptr;
+		std::string_view debug_line;
+
+		for (unsigned i = 0; i < header->e_shnum; ++i) {
+			auto name = string_at(names, sections[i].sh_name);
+
+			if (sections[i].sh_type == SHT_SYMTAB) {
+				symtab = &sections[i];
+			} else if (sections[i].sh_type == SHT_DYNSYM) {
+				dynsym = &sections[i];
+			} else if (name == ".debug_line") {
+				debug_line = section_data(sections[i]);
+			} else if (name == ".debug_line_str") {
+				debug_line_str = section_data(sections[i]);
+			} else if (name == ".debug_str") {
+				debug_str = section_data(sections[i]);
+			}
+		}
+
+		auto* symbol_table = (symtab != nullptr) ? symtab : dynsym;
+		if (symbol_table != nullptr &&
+		    symbol_table->sh_link < header->e_shnum) {
+			read_symbols(
+			    *symbol_table, sections[symbol_table->sh_link]
+			);
+		}
+		if (!debug_line.empty()) {
+			read_line_tables(debug_line);
+		}
+	}
+
+	void read_symbols(const ElfW(Shdr) & table, const ElfW(Shdr) & strtab)
+	{
+		auto data = section_data(table);
+		auto strings = section_data(strtab);
+		auto count = data.size() / sizeof(ElfW(Sym));
+		auto* entries = reinterpret_cast<const ElfW(Sym)*>(data.data());
+
+		symbols.reserve(count);
+		for (std::size_t i = 0; i < count; ++i) {
+			const auto& entry = entries[i];
+			// ELF32_ST_TYPE and ELF64_ST_TYPE are the same mask
+			auto type = ELF64_ST_TYPE(entry.st_info);
+
+			if ((type == STT_FUNC || type == STT_GNU_IFUNC) &&
+			    entry.st_value != 0 && entry.st_shndx != SHN_UNDEF) {
+				symbols.push_back(
+				    { entry.st_value,
+				      entry.st_size,
+				      string_at(strings, entry.st_name) }
+				);
+			}
+		}
+		std::sort(
+		    symbols.begin(),
+		    symbols.end(),
+		    [](const Symbol& lhs, const Symbol& rhs) {
+			    return lhs.start < rhs.start;
+		    }
+		);
+	}
+
+	void read_line_tables(std::string_view section)
+	{
+		Reader unit_reader{
+			reinterpret_cast<const std::uint8_t*>(section.data()),
+			reinterpret_cast<const std::uint8_t*>(
+			    section.data() + section.size()
+			)
+		};
+
+		while (unit_reader.remaining() > 0 && !unit_reader.failed) {
+			std::uint8_t offset_size = 4;
+			std::uint64_t length = unit_reader.fixed<std::uint32_t>();
+			if (length == 0xffffffff) {
+				offset_size = 8;
+				length = unit_reader.fixed<std::uint64_t>();
+			}
+			if (unit_reader.failed || length > unit_reader.remaining()) {
+				break;
+			}
+
+			Reader unit{ unit_reader.pos, unit_reader.pos + length };
+			unit_reader.skip(length);
+			read_line_unit(unit, offset_size);
+		}
+
+		std::stable_sort(
+		    rows.begin(),
+		    rows.end(),
+		    [](const LineRow& lhs, const LineRow& rhs) {
+			    if (lhs.address != rhs.address) {
+				    return lhs.address < rhs.address;
+			    }
+			    // a sequence ending here must not hide the one
+			    // that starts at the same address
+			    return lhs.end_sequence && !rhs.end_sequence;
+		    }
+		);
+	}
+
+	auto read_form_string(
+	    Reader& reader, std::uint64_t form, std::uint8_t offset_size
+	) -> std::optional<std::string_view>
+	{
+		switch (form) {
+		case DW_FORM_string:
+			return reader.cstring();
+		case DW_FORM_line_strp:
+			return string_at(
+			    debug_line_str, reader.sized(offset_size)
+			);
+		case DW_FORM_strp:
+			return string_at(debug_str, reader.sized(offset_size));
+		default:
+			return std::nullopt;
+		}
+	}
+
+	auto skip_form(Reader& reader, std::uint64_t form, std::uint8_t offset_size)
+	    -> std::uint64_t
+	{
+		switch (form) {
+		case DW_FORM_data1:
+			return reader.fixed<std::uint8_t>();
+		case DW_FORM_data2:
+			return reader.fixed<std::uint16_t>();
+		case DW_FORM_data4:
+			return reader.fixed<std::uint32_t>();
+		case DW_FORM_data8:
+			return reader.fixed<std::uint64_t>();
+		case DW_FORM_udata:
+			return reader.uleb();
+		case DW_FORM_data16:
+			reader.skip(16);
+			return 0;
+		case DW_FORM_block:
+			reader.skip(reader.uleb());
+			return 0;
+		case DW_FORM_string:
+		case DW_FORM_line_strp:
+		case DW_FORM_strp:
+			read_form_string(reader, form, offset_size);
+			return 0;
+		default:
+			// Unsupported form; abandon this unit
+			reader.failed = true;
+			reader.pos = reader.end;
+			return 0;
+		}
+	}
+
+	auto join_path(std::string_view directory, std::string_view name)
+	    -> std::string
+	{
+		if (directory.empty() || name.starts_with('/')) {
+			return std::string(name);
+		}
+		std::string result(directory);
+		result += '/';
+		result += name;
+		return result;
+	}
+
+	auto add_file(std::string path) -> std::uint32_t
+	{
+		files.push_back(std::move(path));
+		return static_cast<std::uint32_t>(files.size() - 1);
+	}
+
+	// DWARF 5 directory and file tables are self-describing
+	void read_v5_entries(
+	    Reader& reader, LineHeader& header, bool is_directory_table
+	)
+	{
+		auto format_count = reader.fixed<std::uint8_t>();
+		std::vector<std::pair<std::uint64_t, std::uint64_t>> formats;
+		for (unsigned i = 0; i < format_count && !reader.failed; ++i) {
+			auto content_type = reader.uleb();
+			auto form = reader.uleb();
+			formats.emplace_back(content_type, form);
+		}
+
+		auto entry_count = reader.uleb();
+		for (std::uint64_t i = 0; i < entry_count && !reader.failed;
+		     ++i) {
+			std::string_view name;
+			std::uint64_t directory = 0;
+
+			for (auto [content_type, form] : formats) {
+				if (content_type == DW_LNCT_path) {
+					name = read_form_string(
+						   reader, form, header.offset_size
+					)
+					           .value_or("");
+				} else if (content_type ==
+				           DW_LNCT_directory_index) {
+					directory = skip_form(
+					    reader, form, header.offset_size
+					);
+				} else {
+					skip_form(reader, form, header.offset_size);
+				}
+			}
+
+			if (is_directory_table) {
+				header.directories.emplace_back(name);
+			} else {
+				std::string_view dir_name;
+				if (directory < header.directories.size()) {
+					dir_name = header.directories[directory];
+				}
+				header.files.push_back(
+				    add_file(join_path(dir_name, name))
+				);
+			}
+		}
+	}
+
+	void read_v4_entries(Reader& reader, LineHeader& header)
+	{
+		// Index 0 is the compilation directory, which this table omits
+		header.directories.emplace_back();
+		while (!reader.failed) {
+			auto directory = reader.cstring();
+			if (directory.empty()) {
+				break;
+			}
+			header.directories.emplace_back(directory);
+		}
+
+		// File indexes are 1-based before DWARF 5
+		header.files.push_back(add_file(""));
+		while (!reader.failed) {
+			auto name = reader.cstring();
+			if (name.empty()) {
+				break;
+			}
+			auto directory = reader.uleb();
+			reader.uleb(); // modification time
+			reader.uleb(); // file length
+
+			std::string_view dir_name;
+			if (directory < header.directories.size()) {
+				dir_name = header.directories[directory];
+			}
+			header.files.push_back(
+			    add_file(join_path(dir_name, name))
+			);
+		}
+	}
+
+	auto read_line_header(Reader& unit, std::uint8_t offset_size)
+	    -> std::optional<LineHeader>
+	{
+		LineHeader header;
+		header.offset_size = offset_size;
+		header.version = unit.fixed<std::uint16_t>();
+
+		if (header.version < 2 || header.version > 5) {
+			return std::nullopt;
+		}
+		if (header.version >= 5) {
+			header.address_size = unit.fixed<std::uint8_t>();
+			unit.fixed<std::uint8_t>(); // segment selector size
+		}
+
+		auto header_length = unit.sized(offset_size);
+		if (unit.failed || header_length > unit.remaining()) {
+			return std::nullopt;
+		}
+		auto* program_start = unit.pos + header_length;
+
+		header.min_instruction_length = unit.fixed<std::uint8_t>();
+		if (header.version >= 4) {
+			unit.fixed<std::uint8_t>(); // max ops per instruction
+		}
+		header.default_is_stmt = unit.fixed<std::uint8_t>() != 0;
+		header.line_base = unit.fixed<std::int8_t>();
+		header.line_range = unit.fixed<std::uint8_t>();
+		header.opcode_base = unit.fixed<std::uint8_t>();
+		header.opcode_lengths = unit.pos;
+		unit.skip(header.opcode_base > 0 ? header.opcode_base - 1 : 0);
+
+		if (header.version >= 5) {
+			read_v5_entries(unit, header, true);
+			read_v5_entries(unit, header, false);
+		} else {
+			read_v4_entries(unit, header);
+		}
+
+		if (unit.failed || header.line_range == 0 ||
+		    header.files.empty()) {
+			return std::nullopt;
+		}
+		unit.pos = program_start;
+		return header;
+	}
+
+	void read_line_unit(Reader& unit, std::uint8_t offset_size)
+	{
+		auto header = read_line_header(unit, offset_size);
+		if (!header) {
+			return;
+		}
+
+		// The line number state machine (DWARF 5, section 6.2.2)
+		std::uintptr_t address = 0;
+		std::uint64_t file = (header->version >= 5) ? 0 : 1;
+		std::int64_t line = 1;
+
+		auto emit = [&](bool end_sequence) {
+			auto file_index = (file < header->files.size())
+			                      ? header->files[file]
+			                      : header->files[0];
+			rows.push_back(
+			    { address,
+			      file_index,
+			      static_cast<std::uint32_t>(line),
+			      end_sequence }
+			);
+		};
+		auto reset = [&]() {
+			address = 0;
+			file = (header->version >= 5) ? 0 : 1;
+			line = 1;
+		};
+
+		while (unit.remaining() > 0 && !unit.failed) {
+			auto opcode = unit.fixed<std::uint8_t>();
+
+			if (opcode >= header->opcode_base) {
+				auto adjusted = opcode - header->opcode_base;
+				address += (adjusted / header->line_range) *
+				           header->min_instruction_length;
+				line += header->line_base +
+				        adjusted % header->line_range;
+				emit(false);
+				continue;
+			}
+
+			switch (opcode) {
+			case 0: {
+				auto length = unit.uleb();
+				if (length == 0 || length > unit.remaining()) {
+					return;
+				}
+				auto* next = unit.pos + length;
+				auto sub_opcode = unit.fixed<std::uint8_t>();
+
+				if (sub_opcode == DW_LNE_end_sequence) {
+					emit(true);
+					reset();
+				} else if (sub_opcode == DW_LNE_set_address) {
+					address = static_cast<std::uintptr_t>(
+					    unit.sized(length - 1)
+					);
+				} else if (sub_opcode == DW_LNE_define_file) {
+					auto name = unit.cstring();
+					header->files.push_back(
+					    add_file(std::string(name))
+					);
+				}
+				unit.pos = next;
+				break;
+			}
+			case DW_LNS_copy:
+				emit(false);
+				break;
+			case DW_LNS_advance_pc:
+				address += unit.uleb() *
+				           header->min_instruction_length;
+				break;
+			case DW_LNS_advance_line:
+				line += unit.sleb();
+				break;
+			case DW_LNS_set_file:
+				file = unit.uleb();
+				break;
+			case DW_LNS_const_add_pc:
+				address += ((255 - header->opcode_base) /
+				            header->line_range) *
+				           header->min_instruction_length;
+				break;
+			case DW_LNS_fixed_advance_pc:
+				address += unit.fixed<std::uint16_t>();
+				break;
+			default:
+				// Includes the opcodes that only touch registers
+				// we do not track (column, is_stmt, isa, ...)
+				for (unsigned arg = 0;
+				     arg < header->opcode_lengths[opcode - 1];
+				     ++arg) {
+					unit.uleb();
+				}
+				break;
+			}
+		}
+	}
+
+	std::string path;
+	void* mapping = nullptr;
+	std::size_t mapping_size = 0;
+
+	std::string_view debug_line_str;
+	std::string_view debug_str;
+
+	std::vector<Segment> segments;
+	std::vector<Symbol> symbols;
+	std::vector<LineRow> rows;
+	std::vector<std::string> files;
+};
+
+auto ElfSymbolizer::global() -> ElfSymbolizer&
+{
+	// Never destroyed: exceptions thrown during static destruction still
+	// need it
+	static auto* instance = new ElfSymbolizer();
+	return *instance;
+}
+
+ElfSymbolizer::ElfSymbolizer() = default;
+ElfSymbolizer::~ElfSymbolizer() = default;
+
+void ElfSymbolizer::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	modules.clear();
+	images.clear();
+}
+
+void ElfSymbolizer::enumerate_modules()
+{
+	modules.clear();
+	dl_iterate_phdr(
+	    [](dl_phdr_info* info, size_t, void* data) -> int {
+		    auto& modules = *static_cast<std::vector<LoadedModule>*>(data);
+		    LoadedModule module;
+
+		    module.path = (info->dlpi_name != nullptr)
+		                      ? info->dlpi_name
+		                      : "";
+		    if (module.path.empty() && modules.empty()) {
+			    // The first entry is the main program
+			    module.path = "/proc/self/exe";
+		    }
+		    module.bias = info->dlpi_addr;
+
+		    for (int i = 0; i < info->dlpi_phnum; ++i) {
+			    const auto& segment = info->dlpi_phdr[i];
+			    if (segment.p_type == PT_LOAD) {
+				    auto start = info->dlpi_addr + segment.p_vaddr;
+				    module.ranges.emplace_back(
+					start, start + segment.p_memsz
+				    );
+			    }
+		    }
+		    if (!module.path.empty()) {
+			    modules.push_back(std::move(module));
+		    }
+		    return 0;
+	    },
+	    &modules
+	);
+}
+
+auto ElfSymbolizer::find_module(std::uintptr_t address) -> const LoadedModule*
+{
+	auto search = [this, address]() -> const LoadedModule* {
+		for (const auto& module : modules) {
+			for (auto [start, end] : module.ranges) {
+				if (address >= start && address < end) {
+					return &module;
+				}
+			}
+		}
+		return nullptr;
+	};
+
+	auto* module = search();
+	if (module == nullptr) {
+		// Possibly dlopen()'d since the last scan
+		enumerate_modules();
+		module = search();
+	}
+	return module;
+}
+
+auto ElfSymbolizer::image_for(const std::string& path) -> ElfImage*
+{
+	for (auto& [image_path, image] : images) {
+		if (image_path == path) {
+			return image.get();
+		}
+	}
+	images.emplace_back(path, std::make_unique<ElfImage>(path));
+	return images.back().second.get();
+}
+
+auto ElfSymbolizer::resolve(const void* address) -> std::optional<SymbolInfo>
+{
+	ElfImage* image = nullptr;
+	std::uintptr_t file_address = 0;
+	std::string module_path;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto runtime_address = reinterpret_cast<std::uintptr_t>(address);
+		const auto* module = find_module(runtime_address);
+
+		if (module == nullptr) {
+			return std::nullopt;
+		}
+		file_address = runtime_address - module->bias;
+		module_path = module->path;
+		image = image_for(module->path);
+	}
+
+	auto info = image->lookup(file_address);
+	if (module_path == "/proc/self/exe") {
+		std::error_code error;
+		auto exe = std::filesystem::read_symlink(module_path, error);
+		if (!error) {
+			info.module = exe.string();
+		}
+	}
+	return info;
+}
+
+auto ElfSymbolizer::resolveInFile(
+    const std::filesystem::path& elf_file, std::uintptr_t file_address
+) -> std::optional<SymbolInfo>
+{
+	ElfImage* image = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		image = image_for(elf_file.string());
+	}
+	return image->lookup(file_address);
+}
+
+auto ElfSymbolizer::resolveFileOffset(
+    const std::filesystem::path& elf_file, std::uint64_t file_offset
+) -> std::optional<SymbolInfo>
+{
+	ElfImage* image = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		image = image_for(elf_file.string());
+	}
+
+	auto address = image->offsetToAddress(file_offset);
+	if (!address) {
+		return std::nullopt;
+	}
+	return image->lookup(*address);
+}
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=marker foldmarker=#region,#endregion textwidth=80 ts=8 sts=0 sw=8  noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,119 @@
+/* epoch.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sys/epoch.hpp"
+
+#include "Exception.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace {
+// One cache line per thread; epoch 0 means "not reading"
+struct alignas(64) ReaderSlot {
+	std::atomic<std::uint64_t> epoch{ 0 };
+	std::atomic<bool> claimed{ false };
+};
+
+std::atomic<std::uint64_t> global_epoch{ 1 };
+std::array<ReaderSlot, IOCore::kMaxEpochThreads> reader_slots;
+
+struct ThreadRecord {
+	ReaderSlot* slot = nullptr;
+	unsigned depth = 0;
+
+	~ThreadRecord()
+	{
+		if (slot != nullptr) {
+			slot->epoch.store(0, std::memory_order_release);
+			slot->claimed.store(false, std::memory_order_release);
+		}
+	}
+};
+thread_local ThreadRecord thread_record;
+
+auto claim_slot() -> ReaderSlot*
+{
+	for (auto& slot : reader_slots) {
+		bool expected = false;
+		if (!slot.claimed.load(std::memory_order_relaxed) &&
+		    slot.claimed.compare_exchange_strong(
+			expected, true, std::memory_order_acq_rel
+		    )) {
+			return &slot;
+		}
+	}
+	throw IOCore::Exception("Too many threads reading epoch-protected data");
+}
+} // namespace
+
+namespace IOCore {
+
+EpochGuard::EpochGuard()
+{
+	auto& record = thread_record;
+	if (record.depth++ > 0) {
+		return;
+	}
+	if (record.slot == nullptr) {
+		try {
+			record.slot = claim_slot();
+		} catch (...) {
+			record.depth = 0;
+			throw;
+		}
+	}
+	record.slot->epoch.store(
+	    global_epoch.load(std::memory_order_acquire),
+	    std::memory_order_relaxed
+	);
+	// Orders the announcement before every read the guard protects
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+EpochGuard::~EpochGuard()
+{
+	auto& record = thread_record;
+	if (--record.depth == 0) {
+		record.slot->epoch.store(0, std::memory_order_release);
+	}
+}
+
+auto epoch_advance() noexcept -> std::uint64_t
+{
+	// Readers announcing the returned epoch or earlier may still hold
+	// what was unpublished before this call; later ones cannot
+	return global_epoch.fetch_add(1, std::memory_order_seq_cst);
+}
+
+auto epoch_reached(std::uint64_t retired) noexcept -> bool
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	for (const auto& slot : reader_slots) {
+		auto epoch = slot.epoch.load(std::memory_order_acquire);
+		if (epoch != 0 && epoch <= retired) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void epoch_synchronize(std::uint64_t retired) noexcept
+{
+	while (!epoch_reached(retired)) {
+		std::this_thread::yield();
+	}
+}
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,233 @@
+/* startup_profiler.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sys/startup_profiler.hpp"
+
+#include "Exception.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct PhaseRecord {
+	std::string_view name;
+	std::string detail;
+	Clock::time_point start;
+	Clock::time_point end;
+	unsigned thread;
+};
+
+struct ProfilerState {
+	Clock::time_point epoch = Clock::now();
+	std::atomic<bool> enabled{ false };
+	std::atomic<bool> flushed{ false };
+	std::string output_path;
+
+	std::mutex mutex;
+	std::vector<PhaseRecord> phases;
+	std::atomic<unsigned> next_thread{ 1 };
+
+	ProfilerState()
+	{
+		if (const char* path = std::getenv(IOCore::kStartupTraceVariable)) {
+			output_path = path;
+			enabled.store(!output_path.empty(), std::memory_order_relaxed);
+		}
+	}
+};
+
+auto state() -> ProfilerState&
+{
+	static ProfilerState instance;
+	return instance;
+}
+
+// Fixes the epoch (and reads the environment) during static
+// initialization, before main() and anything it constructs
+[[maybe_unused]] const bool kStateInitialized = (state(), true);
+
+// Small sequential ids read better in trace viewers than native thread ids
+auto current_thread_index() -> unsigned
+{
+	thread_local unsigned index = state().next_thread.fetch_add(
+	    1, std::memory_order_relaxed
+	);
+	return index;
+}
+
+void append_json_string(std::string& output, std::string_view text)
+{
+	output += '"';
+	for (char character : text) {
+		switch (character) {
+		case '"':
+			output += "\\\"";
+			break;
+		case '\\':
+			output += "\\\\";
+			break;
+		case '\n':
+			output += "\\n";
+			break;
+		case '\t':
+			output += "\\t";
+			break;
+		default:
+			if (static_cast<unsigned char>(character) < 0x20) {
+				char escaped[8];
+				std::snprintf(
+				    escaped,
+				    sizeof(escaped),
+				    "\\u%04x",
+				    static_cast<unsigned>(character)
+				);
+				output += escaped;
+			} else {
+				output += character;
+			}
+		}
+	}
+	output += '"';
+}
+
+auto microseconds_since(Clock::time_point epoch, Clock::time_point time)
+    -> std::string
+{
+	auto elapsed = std::chrono::duration<double, std::micro>(time - epoch);
+	char buffer[32];
+	std::snprintf(buffer, sizeof(buffer), "%.3f", elapsed.count());
+	return buffer;
+}
+} // namespace
+
+namespace IOCore {
+
+StartupPhase::StartupPhase(std::string_view name, std::string_view detail)
+    : name(name)
+{
+	if (!state().enabled.load(std::memory_order_relaxed)) {
+		return;
+	}
+	this->recording = true;
+	this->detail = detail;
+	this->start = Clock::now();
+}
+
+StartupPhase::~StartupPhase()
+{
+	if (!this->recording) {
+		return;
+	}
+	auto end = Clock::now();
+	auto thread = current_thread_index();
+
+	auto& profiler = state();
+	std::lock_guard lock(profiler.mutex);
+	profiler.phases.push_back(PhaseRecord{
+	    this->name, std::move(this->detail), this->start, end, thread });
+}
+
+auto startup_profiling_enabled() noexcept -> bool
+{
+	return state().enabled.load(std::memory_order_relaxed);
+}
+
+void enable_startup_profiling(bool enabled) noexcept
+{
+	state().enabled.store(enabled, std::memory_order_relaxed);
+}
+
+auto startup_trace_json() -> std::string
+{
+	auto& profiler = state();
+	std::lock_guard lock(profiler.mutex);
+
+#if defined(__unix__) || defined(__APPLE__)
+	auto pid = std::to_string(::getpid());
+#else
+	std::string pid = "1";
+#endif
+
+	std::string output = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (const auto& phase : profiler.phases) {
+		if (!first) {
+			output += ',';
+		}
+		first = false;
+
+		output += "\n{\"name\":";
+		append_json_string(output, phase.name);
+		output += ",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":";
+		output += microseconds_since(profiler.epoch, phase.start);
+		output += ",\"dur\":";
+		output += microseconds_since(phase.start, phase.end);
+		output += ",\"pid\":" + pid;
+		output += ",\"tid\":" + std::to_string(phase.thread);
+		if (!phase.detail.empty()) {
+			output += ",\"args\":{\"detail\":";
+			append_json_string(output, phase.detail);
+			output += '}';
+		}
+		output += '}';
+	}
+	output += "\n]}\n";
+	return output;
+}
+
+void write_startup_trace(const std::filesystem::path& path)
+{
+	auto json = startup_trace_json();
+	std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+	stream << json;
+	stream.flush();
+	if (!stream) {
+		throw IOCore::Exception(
+		    "Error writing startup trace to " + path.string()
+		);
+	}
+}
+
+void flush_startup_trace()
+{
+	auto& profiler = state();
+	if (profiler.output_path.empty() ||
+	    profiler.flushed.exchange(true, std::memory_order_acq_rel)) {
+		return;
+	}
+	write_startup_trace(profiler.output_path);
+
+	// Startup is over; stop recording, or a long-running process would
+	// keep appending a phase for every later config read
+	profiler.enabled.store(false, std::memory_order_relaxed);
+	clear_startup_trace();
+}
+
+void clear_startup_trace()
+{
+	auto& profiler = state();
+	std::lock_guard lock(profiler.mutex);
+	profiler.phases.clear();
+}
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,120 @@
+/* symbol_cache.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sys/symbol_cache.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace IOCore {
+
+auto SymbolCache::global() noexcept -> SymbolCache&
+{
+	// Never destroyed: exceptions thrown during static destruction still
+	// need it
+	static auto* instance = new SymbolCache();
+	return *instance;
+}
+
+SymbolCache::~SymbolCache()
+{
+	clear();
+}
+
+auto SymbolCache::slot_index(const void* address) noexcept -> std::size_t
+{
+	static_assert((kCapacity & (kCapacity - 1)) == 0);
+	constexpr std::uint64_t kFibonacciMultiplier = 0x9E3779B97F4A7C15ULL;
+
+	auto key = static_cast<std::uint64_t>(
+	    reinterpret_cast<std::uintptr_t>(address)
+	);
+	return static_cast<std::size_t>((key >> 2) * kFibonacciMultiplier >> 32) &
+	       (kCapacity - 1);
+}
+
+auto SymbolCache::lookup(const void* address) noexcept -> const char*
+{
+	auto index = slot_index(address);
+
+	for (std::size_t probe = 0; probe < kMaxProbes; ++probe) {
+		auto& slot = slots[(index + probe) & (kCapacity - 1)];
+		auto* key = slot.address.load(std::memory_order_acquire);
+
+		if (key == address) {
+			// The slot may be claimed but not yet published
+			auto* text = slot.text.load(std::memory_order_acquire);
+			if (text != nullptr) {
+				hits.fetch_add(1, std::memory_order_relaxed);
+				return text;
+			}
+			break;
+		}
+		if (key == nullptr) {
+			break;
+		}
+	}
+	misses.fetch_add(1, std::memory_order_relaxed);
+	return nullptr;
+}
+
+auto SymbolCache::insert(const void* address, std::string_view text)
+    -> const char*
+{
+	auto index = slot_index(address);
+
+	for (std::size_t probe = 0; probe < kMaxProbes; ++probe) {
+		auto& slot = slots[(index + probe) & (kCapacity - 1)];
+		const void* expected = nullptr;
+
+		if (slot.address.compare_exchange_strong(
+			expected, address, std::memory_order_acq_rel
+		    )) {
+			auto* copy = new char[text.size() + 1];
+			std::memcpy(copy, text.data(), text.size());
+			copy[text.size()] = '\0';
+
+			slot.text.store(copy, std::memory_order_release);
+			entries.fetch_add(1, std::memory_order_relaxed);
+			return copy;
+		}
+		if (expected == address) {
+			// Another thread won the race; its text is equivalent
+			return slot.text.load(std::memory_order_acquire);
+		}
+	}
+	rejected.fetch_add(1, std::memory_order_relaxed);
+	return nullptr;
+}
+
+auto SymbolCache::getStats() const noexcept -> SymbolCacheStats
+{
+	return { hits.load(std::memory_order_relaxed),
+		 misses.load(std::memory_order_relaxed),
+		 entries.load(std::memory_order_relaxed),
+		 rejected.load(std::memory_order_relaxed) };
+}
+
+void SymbolCache::clear() noexcept
+{
+	for (auto& slot : slots) {
+		delete[] slot.text.exchange(nullptr, std::memory_order_relaxed);
+		slot.address.store(nullptr, std::memory_order_relaxed);
+	}
+	hits.store(0, std::memory_order_relaxed);
+	misses.store(0, std::memory_order_relaxed);
+	entries.store(0, std::memory_order_relaxed);
+	rejected.store(0, std::memory_order_relaxed);
+}
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8  noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,179 @@
+/* throw_sites.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sys/throw_sites.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+
+namespace IOCore {
+namespace {
+using Clock = std::chrono::system_clock;
+
+auto now_ns() noexcept -> std::int64_t
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		   Clock::now().time_since_epoch()
+	)
+	    .count();
+}
+
+auto from_ns(std::int64_t nanoseconds) -> Clock::time_point
+{
+	return Clock::time_point(std::chrono::duration_cast<Clock::duration>(
+	    std::chrono::nanoseconds(nanoseconds)
+	));
+}
+} // namespace
+
+auto ThrowSiteRegistry::Site::publishStackTrace(std::string text)
+    -> const std::string*
+{
+	const std::string* expected = nullptr;
+	auto* candidate = new std::string(std::move(text));
+
+	if (trace.compare_exchange_strong(
+		expected, candidate, std::memory_order_acq_rel
+	    )) {
+		return candidate;
+	}
+	delete candidate;
+	return expected;
+}
+
+auto ThrowSiteRegistry::global() noexcept -> ThrowSiteRegistry&
+{
+	// Never destroyed: exceptions thrown during static destruction still
+	// need it
+	static auto* instance = new ThrowSiteRegistry();
+	return *instance;
+}
+
+ThrowSiteRegistry::~ThrowSiteRegistry()
+{
+	clear();
+}
+
+auto ThrowSiteRegistry::hashFrames(const StackFrames& frames) noexcept
+    -> std::uint64_t
+{
+	// FNV-1a over the return addresses
+	constexpr std::uint64_t kOffsetBasis = 0xcbf29ce484222325ULL;
+	constexpr std::uint64_t kPrime = 0x100000001b3ULL;
+
+	std::uint64_t hash = kOffsetBasis;
+	for (void* address : frames) {
+		hash ^= reinterpret_cast<std::uintptr_t>(address);
+		hash *= kPrime;
+	}
+	// 0 marks an empty slot
+	return (hash != 0) ? hash : 1;
+}
+
+auto ThrowSiteRegistry::record(const StackFrames& frames) noexcept -> Site*
+{
+	auto hash = hashFrames(frames);
+	auto timestamp = now_ns();
+
+	for (std::size_t probe = 0; probe < kMaxProbes; ++probe) {
+		auto& site = sites[(hash + probe) % kCapacity];
+		std::uint64_t expected = 0;
+
+		if (site.hash.compare_exchange_strong(
+			expected, hash, std::memory_order_acq_rel
+		    )) {
+			site.first_seen_ns.store(
+			    timestamp, std::memory_order_relaxed
+			);
+			expected = hash;
+		}
+		if (expected == hash) {
+			site.last_seen_ns.store(
+			    timestamp, std::memory_order_relaxed
+			);
+			site.count.fetch_add(1, std::memory_order_relaxed);
+			return &site;
+		}
+	}
+	return nullptr;
+}
+
+auto ThrowSiteRegistry::snapshot() const -> std::vector<ThrowSiteStats>
+{
+	std::vector<ThrowSiteStats> results;
+
+	for (const auto& site : sites) {
+		auto hash = site.hash.load(std::memory_order_acquire);
+		auto count = site.count.load(std::memory_order_relaxed);
+		if (hash == 0 || count == 0) {
+			continue;
+		}
+
+		ThrowSiteStats stats;
+		stats.hash = hash;
+		stats.count = count;
+		stats.first_seen = from_ns(
+		    site.first_seen_ns.load(std::memory_order_relaxed)
+		);
+		stats.last_seen =
+		    from_ns(site.last_seen_ns.load(std::memory_order_relaxed));
+		if (const auto* trace = site.stackTrace()) {
+			stats.stack_trace = *trace;
+		}
+		results.push_back(std::move(stats));
+	}
+
+	std::sort(
+	    results.begin(),
+	    results.end(),
+	    [](const ThrowSiteStats& lhs, const ThrowSiteStats& rhs) {
+		    return lhs.count > rhs.count;
+	    }
+	);
+	return results;
+}
+
+void ThrowSiteRegistry::dump(std::ostream& output) const
+{
+	for (const auto& stats : snapshot()) {
+		output << fmt::format(
+		    "site {:016x}: {} throws, first {:%F %T}, last {:%F %T}\n",
+		    stats.hash,
+		    stats.count,
+		    stats.first_seen,
+		    stats.last_seen
+		);
+		output << (stats.stack_trace.empty() ? "\t(not symbolized)\n"
+		                                     : stats.stack_trace);
+	}
+	output.flush();
+}
+
+void ThrowSiteRegistry::clear() noexcept
+{
+	for (auto& site : sites) {
+		delete site.trace.exchange(nullptr, std::memory_order_relaxed);
+		site.count.store(0, std::memory_order_relaxed);
+		site.first_seen_ns.store(0, std::memory_order_relaxed);
+		site.last_seen_ns.store(0, std::memory_order_relaxed);
+		site.hash.store(0, std::memory_order_relaxed);
+	}
+}
+
+} // namespace IOCore
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8  noexpandtab ft=cpp.doxygen :
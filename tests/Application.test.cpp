@@ -11,8 +11,16 @@
 #include "IOCore/Exception.hpp"
 
 #include "test-utils/common.hpp"
+#include <catch2/generators/catch_generators.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <thread>
+
+#include <pthread.h>
+
 namespace {
 struct SimulatedLaunch {
 	static const char* argv[];
@@ -32,9 +40,12 @@ BEGIN_TEST_SUITE("IOCore::Application")
 	using namespace IOCore;
 	struct MockApplicationClass : public Application {
 		MockApplicationClass(
-		    int argc, c::const_string argv[], c::const_string env[]
+		    int argc,
+		    c::const_string argv[],
+		    c::const_string env[],
+		    ArgumentStorage storage = ArgumentStorage::Arena
 		)
-		    : Application(argc, argv, env)
+		    : Application(argc, argv, env, storage)
 		{
 		}
 		auto run() -> int override { return 0; }
@@ -70,6 +81,119 @@ BEGIN_TEST_SUITE("IOCore::Application")
 		);
 	};
 
+	TEST("IOCore::Application - string_view accessors in both storage modes")
+	{
+		auto storage = GENERATE(
+		    ArgumentStorage::Arena, ArgumentStorage::InPlace
+		);
+		MockApplicationClass app(
+		    3, SimulatedLaunch::argv, SimulatedLaunch::env, storage
+		);
+
+		CHECK(app.getArgumentCount() == 3);
+		CHECK(app.getArgument(1) == "param2");
+		CHECK(app.getArgument(3).empty());
+
+		CHECK(app.getEnv("VAR2") == "TWO");
+		CHECK(app.getEnv("REQUEST_URI") == "markdown?msg=hello-world");
+		CHECK_FALSE(app.getEnv("MISSING").has_value());
+
+		bool points_at_caller =
+		    app.getArgument(0).data() == SimulatedLaunch::argv[0];
+		CHECK(points_at_caller == (storage == ArgumentStorage::InPlace));
+	};
+
+	TEST("IOCore::Application - lifecycle requests update the state word")
+	{
+		MockApplicationClass app(
+		    3, SimulatedLaunch::argv, SimulatedLaunch::env
+		);
+		CHECK_FALSE(app.shutdownRequested());
+		CHECK(app.reloadGeneration() == 0);
+
+		app.requestReload();
+		app.requestReload();
+		CHECK(app.reloadGeneration() == 2);
+
+		app.requestShutdown();
+		CHECK(app.shutdownRequested());
+		CHECK(app.reloadGeneration() == 2);
+	}
+
+	TEST("IOCore::Application - drain() gives up after its deadline")
+	{
+		MockApplicationClass app(
+		    3, SimulatedLaunch::argv, SimulatedLaunch::env
+		);
+		std::atomic<bool> release{ false };
+		app.getExecutor().submit([&release]() {
+			while (!release) {
+				std::this_thread::yield();
+			}
+		});
+
+		app.setDrainTimeout(std::chrono::milliseconds{ 10 });
+		CHECK_FALSE(app.drain());
+		CHECK((app.lifecycleState() & Application::Draining) != 0);
+
+		release = true;
+		app.setDrainTimeout(std::chrono::seconds{ 10 });
+		CHECK(app.drain());
+	}
+
+	TEST("IOCore::Application - run() drains before returning")
+	{
+		struct DaemonApplication : MockApplicationClass {
+			using MockApplicationClass::MockApplicationClass;
+			auto run() -> int override { return Application::run(); }
+			std::atomic<bool> task_done{ false };
+		};
+		DaemonApplication app(3, SimulatedLaunch::argv, SimulatedLaunch::env);
+
+		// The task uses a subclass member, which ~Application would be
+		// too late to wait for
+		app.getExecutor().submit([&app]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds{ 20 });
+			app.task_done = true;
+		});
+		app.getReactor();
+		app.requestShutdown();
+
+		CHECK(app.run() == 0);
+		CHECK(app.task_done);
+		CHECK((app.lifecycleState() & Application::Draining) != 0);
+	}
+
+#if defined(__linux__)
+	TEST("IOCore::Application - SIGHUP reloads and SIGTERM stops run()")
+	{
+		struct SignalledApplication : MockApplicationClass {
+			using MockApplicationClass::MockApplicationClass;
+			auto run() -> int override { return Application::run(); }
+			void onReload() override { ++reloads; }
+			int reloads = 0;
+		};
+		SignalledApplication app(
+		    3, SimulatedLaunch::argv, SimulatedLaunch::env
+		);
+		app.handleSignals();
+
+		// Only this thread blocks the signals; a process-directed one
+		// could reach a thread another test left running
+		REQUIRE(::pthread_kill(::pthread_self(), SIGHUP) == 0);
+		app.getReactor().runOnce(std::chrono::seconds{ 1 });
+		CHECK(app.reloads == 1);
+		CHECK(app.reloadGeneration() == 1);
+
+		REQUIRE(::pthread_kill(::pthread_self(), SIGTERM) == 0);
+		CHECK(app.run() == 0);
+		CHECK(app.shutdownRequested());
+
+		app.getExecutor();
+		REQUIRE_THROWS_AS(app.handleSignals(), IOCore::Exception);
+	}
+#endif
+
 	TEST("IOCore::DoubleConstructionException error message is correct")
 	{
 		try {
@@ -0,0 +1,89 @@
+/* Assert.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/Assert.hpp"
+#include "IOCore/Exception.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <catch2/matchers/catch_matchers_string.hpp>
+
+#include <string>
+
+namespace Match = Catch::Matchers;
+
+BEGIN_TEST_SUITE("IOCore::Assert")
+{
+	auto failure_message = [](auto&& check) -> std::string {
+		try {
+			check();
+		} catch (const IOCore::AssertionException& error) {
+			return error.what();
+		}
+		return {};
+	};
+
+	TEST("ASSERT - passing checks do not throw")
+	{
+		int value = 1;
+		REQUIRE_NOTHROW([&value]() { ASSERT(value == 1); }());
+		REQUIRE_NOTHROW([&value]() {
+			ASSERT_MSG(value == 1, "unused");
+		}());
+	}
+
+	TEST("ASSERT_MSG - failures report condition, reason and location")
+	{
+		auto message = failure_message([] {
+			int value = 1;
+			ASSERT_MSG(value == 2, std::string("value must be two"));
+		});
+
+		REQUIRE_THAT(message, Match::ContainsSubstring("value == 2 is false!"));
+		REQUIRE_THAT(message, Match::ContainsSubstring("value must be two"));
+		REQUIRE_THAT(message, Match::ContainsSubstring("Assert.test.cpp"));
+	}
+
+	TEST("IOCORE_VERIFY - formats its message with fmt")
+	{
+		auto message = failure_message([] {
+			int index = 7;
+			IOCORE_VERIFY(index < 4, "index {} out of {}", index, 4);
+		});
+
+		REQUIRE_THAT(message, Match::ContainsSubstring("index 7 out of 4"));
+	}
+
+	TEST("IOCORE_VERIFY - message arguments are only evaluated on failure")
+	{
+		int evaluations = 0;
+		auto count = [&evaluations]() { return ++evaluations; };
+
+		IOCORE_VERIFY(evaluations == 0, "evaluated {} times", count());
+		REQUIRE(evaluations == 0);
+
+		REQUIRE_THROWS_AS(
+		    [&]() {
+			    IOCORE_VERIFY(
+				evaluations == 1, "evaluated {} times", count()
+			    );
+		    }(),
+		    IOCore::AssertionException
+		);
+		REQUIRE(evaluations == 1);
+	}
+
+	TEST("AssertionException - can be caught as IOCore::Exception")
+	{
+		REQUIRE_THROWS_AS([]() { ASSERT(1 + 1 == 3); }(), IOCore::Exception);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,124 @@
+/* CommandLine.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/CommandLine.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace {
+struct BuildOptions {
+	bool build = false;
+	bool clean = false;
+	int verbosity = 0;
+	unsigned jobs = 1;
+	double ratio = 0.0;
+	std::string_view output;
+	std::optional<int> limit;
+	std::string target;
+};
+
+namespace CommandLine = IOCore::CommandLine;
+
+constexpr auto kBuildSchema = CommandLine::make_schema(
+    CommandLine::subcommand<&BuildOptions::build>("build"),
+    CommandLine::subcommand<&BuildOptions::clean>("clean"),
+    CommandLine::flag<&BuildOptions::verbosity>("verbose", 'v'),
+    CommandLine::option<&BuildOptions::jobs>("jobs", 'j', "worker count"),
+    CommandLine::option<&BuildOptions::ratio>("ratio"),
+    CommandLine::option<&BuildOptions::output>("output", 'o'),
+    CommandLine::option<&BuildOptions::limit>("limit"),
+    CommandLine::positional<&BuildOptions::target>("target")
+);
+
+struct MacroOptions {
+	bool force = false;
+	int retries = 0;
+};
+constexpr auto kMacroSchema = IOCORE_CLI_OPTIONS(MacroOptions, force, retries);
+
+auto parse(std::initializer_list<std::string_view> arguments) -> BuildOptions
+{
+	BuildOptions result;
+	kBuildSchema.parseInto(result, { arguments.begin(), arguments.size() });
+	return result;
+}
+} // namespace
+
+BEGIN_TEST_SUITE("IOCore::CommandLine")
+{
+	TEST("CommandLine::Schema - option names resolve at compile time")
+	{
+		STATIC_REQUIRE(kBuildSchema.find("jobs") != nullptr);
+		STATIC_REQUIRE(kBuildSchema.find("jobs")->short_name == 'j');
+		STATIC_REQUIRE(kBuildSchema.find("job") == nullptr);
+		STATIC_REQUIRE(kBuildSchema.find("target") == nullptr);
+		STATIC_REQUIRE(kBuildSchema.find('o') != nullptr);
+		STATIC_REQUIRE(kMacroSchema.find("retries") != nullptr);
+	}
+
+	TEST("CommandLine::Schema - parses every accepted form")
+	{
+		auto options = parse({ "build",
+				       "-vv",
+				       "--jobs=8",
+				       "-o",
+				       "out.bin",
+				       "--ratio",
+				       "0.5",
+				       "--limit=3",
+				       "app" });
+
+		CHECK(options.build);
+		CHECK_FALSE(options.clean);
+		CHECK(options.verbosity == 2);
+		CHECK(options.jobs == 8);
+		CHECK(options.ratio == 0.5);
+		CHECK(options.output == "out.bin");
+		CHECK(options.limit == 3);
+		CHECK(options.target == "app");
+	}
+
+	TEST("CommandLine::Schema - short values and the end of options")
+	{
+		auto options = parse({ "-j4", "-vo", "file", "--", "-not-a-flag" });
+
+		CHECK(options.jobs == 4);
+		CHECK(options.verbosity == 1);
+		CHECK(options.output == "file");
+		CHECK(options.target == "-not-a-flag");
+	}
+
+	TEST("CommandLine::Schema - reports bad input")
+	{
+		using IOCore::CommandLineException;
+
+		REQUIRE_THROWS_AS(parse({ "--unknown" }), CommandLineException);
+		REQUIRE_THROWS_AS(parse({ "--jobs=many" }), CommandLineException);
+		REQUIRE_THROWS_AS(parse({ "--jobs" }), CommandLineException);
+		REQUIRE_THROWS_AS(parse({ "--verbose=1" }), CommandLineException);
+		REQUIRE_THROWS_AS(parse({ "a", "b" }), CommandLineException);
+	}
+
+	TEST("CommandLine::Schema - parses main()-style argv")
+	{
+		const char* argv[] = { "program", "--force", "--retries", "5" };
+		auto options = kMacroSchema.parse(4, argv);
+
+		CHECK(options.force);
+		CHECK(options.retries == 5);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,145 @@
+/* ConfigSubscriptions.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/ConfigSubscriptions.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+BEGIN_TEST_SUITE("IOCore::ConfigSubscriptions")
+{
+	using IOCore::ConfigSubscriptions;
+	using IOCore::TomlTable;
+	using Paths = std::vector<std::string>;
+
+	auto parse(std::string_view text) -> toml::table
+	{
+		return toml::parse(text);
+	}
+
+	TEST("IOCore::diff_toml - reports changed, added and removed leaves")
+	{
+		auto before = parse(R"(
+			name = "iocore"
+			[server]
+			port = 80
+			hosts = ["a", "b"]
+			[server.limits]
+			max_conn = 10
+			timeout = 5
+		)"sv);
+		auto after = parse(R"(
+			name = "iocore"
+			[server]
+			port = 80
+			hosts = ["a", "c"]
+			tls = true
+			[server.limits]
+			max_conn = 20
+		)"sv);
+
+		REQUIRE(IOCore::diff_toml(before, before).empty());
+		REQUIRE(
+		    IOCore::diff_toml(before, after) ==
+		    Paths{ "server.hosts",
+		           "server.limits.max_conn",
+		           "server.limits.timeout",
+		           "server.tls" }
+		);
+	}
+
+	TEST("IOCore::diff_toml - reports a replaced table once")
+	{
+		auto before = parse("[server]\nport = 80\nhost = \"a\"\n"sv);
+		auto after = parse("server = 1\n"sv);
+
+		REQUIRE(IOCore::diff_toml(before, after) == Paths{ "server" });
+		REQUIRE(IOCore::diff_toml(after, toml::table{}) == Paths{ "server" });
+	}
+
+	TEST("IOCore::ConfigSubscriptions - fires only the affected subscribers")
+	{
+		ConfigSubscriptions subscriptions;
+		TomlTable config;
+		std::vector<std::string> fired;
+		auto record = [&fired](std::string name) {
+			return [&fired, name](const TomlTable&) {
+				fired.push_back(name);
+			};
+		};
+
+		subscriptions.subscribe("server.limits.max_conn", record("max_conn"));
+		subscriptions.subscribe("server.port", record("port"));
+		subscriptions.subscribe("server", record("server"));
+		subscriptions.subscribe("", record("all"));
+		subscriptions.subscribe("logging", record("logging"));
+
+		// A leaf change reaches its own subscribers and its ancestors'
+		REQUIRE(
+		    subscriptions.notify(
+			{ "server.limits.max_conn", "server.limits.timeout" }, config
+		    ) == 3
+		);
+		REQUIRE(fired == Paths{ "max_conn", "server", "all" });
+
+		// Replacing a table reaches everything beneath it
+		fired.clear();
+		subscriptions.notify({ "server" }, config);
+		REQUIRE(fired == Paths{ "max_conn", "port", "server", "all" });
+
+		fired.clear();
+		REQUIRE(subscriptions.notify({}, config) == 0);
+		REQUIRE(fired.empty());
+	}
+
+	TEST("IOCore::ConfigSubscriptions - unsubscribe stops callbacks")
+	{
+		ConfigSubscriptions subscriptions;
+		TomlTable config;
+		int calls = 0;
+
+		auto id = subscriptions.subscribe(
+		    "a.b", [&calls](const TomlTable&) { ++calls; }
+		);
+		subscriptions.notify({ "a.b" }, config);
+		subscriptions.unsubscribe(id);
+		subscriptions.unsubscribe(id);
+		subscriptions.notify({ "a.b" }, config);
+
+		REQUIRE(calls == 1);
+		REQUIRE(subscriptions.size() == 0);
+	}
+
+	TEST("IOCore::ConfigSubscriptions - a throwing callback runs the rest")
+	{
+		ConfigSubscriptions subscriptions;
+		TomlTable config;
+		int calls = 0;
+
+		subscriptions.subscribe("a", [](const TomlTable&) {
+			throw std::runtime_error("first");
+		});
+		subscriptions.subscribe("a", [&calls](const TomlTable&) {
+			++calls;
+		});
+
+		REQUIRE_THROWS_AS(
+		    subscriptions.notify({ "a" }, config), std::runtime_error
+		);
+		REQUIRE(calls == 1);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,116 @@
+/* CrashHandler.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/sys/crash_handler.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <csignal>
+#include <cstdint>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(ELF_STACKTRACER)
+#include "IOCore/sys/elf_symbolizer.hpp"
+#endif
+
+namespace {
+auto current_segv_handler() -> void*
+{
+	struct sigaction current {};
+	sigaction(SIGSEGV, nullptr, &current);
+	return reinterpret_cast<void*>(current.sa_sigaction);
+}
+
+// A real fault, so the report's first frame lies inside this function
+[[gnu::noinline]] void store_through_null()
+{
+	volatile int* volatile target = nullptr;
+	*target = 1;
+}
+
+// Runs store_through_null() in a child reporting to a pipe; returns the
+// report, and the signal that killed the child in \p signal_number
+auto crash_child(int& signal_number) -> std::string
+{
+	int fds[2];
+	REQUIRE(::pipe(fds) == 0);
+
+	auto child = ::fork();
+	REQUIRE(child >= 0);
+	if (child == 0) {
+		::close(fds[0]);
+		IOCore::install_crash_handler(fds[1]);
+		store_through_null();
+		::_exit(0);
+	}
+
+	::close(fds[1]);
+	std::string report;
+	char buffer[4096];
+	ssize_t count = 0;
+	while ((count = ::read(fds[0], buffer, sizeof(buffer))) > 0) {
+		report.append(buffer, static_cast<std::size_t>(count));
+	}
+	::close(fds[0]);
+
+	int status = 0;
+	::waitpid(child, &status, 0);
+	signal_number = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+	return report;
+}
+} // namespace
+
+BEGIN_TEST_SUITE("IOCore::crash_handler")
+{
+	TEST("IOCore::install_crash_handler - installs and restores handlers")
+	{
+		auto* original = current_segv_handler();
+
+		REQUIRE_NOTHROW(IOCore::install_crash_handler());
+		REQUIRE(current_segv_handler() != original);
+
+		IOCore::uninstall_crash_handler();
+		REQUIRE(current_segv_handler() == original);
+	}
+
+	TEST("IOCore::install_crash_handler - reports the faulting function first")
+	{
+		int signal_number = 0;
+		auto report = crash_child(signal_number);
+
+		REQUIRE(signal_number == SIGSEGV);
+		REQUIRE(report.find("signal 11 SIGSEGV\n") != std::string::npos);
+
+		auto line = report.find("\nframe ");
+		REQUIRE(line != std::string::npos);
+		auto frame0 = std::stoull(report.substr(line + 7), nullptr, 16);
+
+		// The faulting store sits early in the function, behind any
+		// sanitizer checks
+		auto entry = reinterpret_cast<std::uintptr_t>(&store_through_null);
+		REQUIRE(frame0 >= entry);
+		REQUIRE(frame0 - entry < 1024);
+#if defined(ELF_STACKTRACER)
+		// Forked from this process, so its mappings are ours
+		auto info = IOCore::ElfSymbolizer::global().resolve(
+		    reinterpret_cast<const void*>(frame0)
+		);
+		REQUIRE(info.has_value());
+		REQUIRE(info->function.find("store_through_null") !=
+		        std::string::npos);
+#endif
+		REQUIRE(report.ends_with("end\n"));
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,46 @@
+/* Debuginfo.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/sys/debuginfo.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <array>
+
+BEGIN_TEST_SUITE("IOCore::debuginfo")
+{
+	TEST("IOCore::walk_frame_pointers - respects the depth limit")
+	{
+		std::array<void*, 2> buffer{};
+		auto depth =
+		    IOCore::walk_frame_pointers(buffer.data(), buffer.size());
+
+		REQUIRE(depth >= 1);
+		REQUIRE(depth <= buffer.size());
+		REQUIRE(buffer[0] != nullptr);
+	}
+
+	TEST("IOCore::walk_frame_pointers - a zero depth writes nothing")
+	{
+		void* sentinel = nullptr;
+		REQUIRE(IOCore::walk_frame_pointers(&sentinel, 0) == 0);
+		REQUIRE(sentinel == nullptr);
+	}
+
+	TEST("IOCore::capture_stackframes_fp - frames can be symbolized")
+	{
+		auto frames = IOCore::capture_stackframes_fp();
+
+		REQUIRE_FALSE(frames.empty());
+		REQUIRE_FALSE(IOCore::symbolize_stacktrace(frames).empty());
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,201 @@
+/* DurableWrite.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/Exception.hpp"
+#include "IOCore/sys/durable_write.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+BEGIN_TEST_SUITE("IOCore::write_file_atomically")
+{
+	using IOCore::SyncMode;
+	using IOCore::durable_write_detail::SyncEvent;
+	using IOCore::write_file_atomically;
+
+	auto scratch_directory(const char* name) -> fs::path
+	{
+		auto directory =
+		    fs::temp_directory_path() /
+		    (std::string("iocore-durable-") + std::to_string(::getpid()) +
+		     "-" + name);
+		fs::remove_all(directory);
+		fs::create_directories(directory);
+		return directory;
+	}
+
+	auto slurp(const fs::path& path) -> std::string
+	{
+		std::ifstream stream(path, std::ios::binary);
+		return { std::istreambuf_iterator<char>(stream), {} };
+	}
+
+	auto entry_count(const fs::path& directory) -> std::size_t
+	{
+		auto entries = fs::directory_iterator(directory);
+		return static_cast<std::size_t>(
+		    std::distance(begin(entries), end(entries))
+		);
+	}
+
+	TEST("write_file_atomically - replaces contents and leaves no temp")
+	{
+		auto directory = scratch_directory("replace");
+		auto path = directory / "config.toml";
+		{
+			std::ofstream stream(path);
+			stream << "a much longer original content that must vanish";
+		}
+		fs::permissions(path, fs::perms::owner_read | fs::perms::owner_write);
+
+		write_file_atomically(path, "short");
+
+		REQUIRE(slurp(path) == "short");
+		REQUIRE(
+		    fs::status(path).permissions() ==
+		    (fs::perms::owner_read | fs::perms::owner_write)
+		);
+		REQUIRE(entry_count(directory) == 1);
+		fs::remove_all(directory);
+	}
+
+	TEST("write_file_atomically - writes through symlinks")
+	{
+		auto directory = scratch_directory("symlink");
+		auto real = directory / "real.toml";
+		auto link = directory / "link.toml";
+		{
+			std::ofstream stream(real);
+			stream << "old";
+		}
+		fs::create_symlink(real, link);
+
+		write_file_atomically(link, "new");
+
+		REQUIRE(fs::is_symlink(link));
+		REQUIRE(slurp(real) == "new");
+		fs::remove_all(directory);
+	}
+
+	TEST("write_file_atomically - failures leave the target untouched")
+	{
+		auto directory = scratch_directory("failure");
+		auto path = directory / "missing" / "config.toml";
+
+		REQUIRE_THROWS_AS(
+		    write_file_atomically(path, "contents"), IOCore::Exception
+		);
+		REQUIRE(!fs::exists(path));
+		REQUIRE(entry_count(directory) == 0);
+		fs::remove_all(directory);
+	}
+
+	// Holds the first directory fsync open until released, counting the
+	// writers that join a batch meanwhile
+	struct HeldSync {
+		std::mutex mutex;
+		std::condition_variable changed;
+		int joined = 0;
+		bool armed = true;
+		bool holding = false;
+		bool released = false;
+	};
+	HeldSync held;
+
+	void hold_first_sync(SyncEvent event)
+	{
+		std::unique_lock lock(held.mutex);
+		if (event == SyncEvent::Joined) {
+			++held.joined;
+		} else if (std::exchange(held.armed, false)) {
+			held.holding = true;
+			held.changed.notify_all();
+			held.changed.wait(lock, []() { return held.released; });
+		}
+		held.changed.notify_all();
+	}
+
+	TEST("write_file_atomically - group commit shares directory fsyncs")
+	{
+		auto directory = scratch_directory("group");
+		constexpr int kWriters = 8;
+
+		auto before = IOCore::directory_sync_stats();
+		IOCore::durable_write_detail::set_sync_hook(hold_first_sync);
+
+		std::thread leader([&directory]() {
+			write_file_atomically(
+			    directory / "leader.toml", "leader", SyncMode::GroupCommit
+			);
+		});
+		{
+			std::unique_lock lock(held.mutex);
+			held.changed.wait(lock, []() { return held.holding; });
+		}
+
+		// Everyone arriving while the leader syncs gathers into one batch
+		std::vector<std::thread> writers;
+		for (int writer = 0; writer < kWriters; ++writer) {
+			writers.emplace_back([&directory, writer]() {
+				write_file_atomically(
+				    directory / ("file-" + std::to_string(writer) + ".toml"),
+				    std::to_string(writer),
+				    SyncMode::GroupCommit
+				);
+			});
+		}
+		{
+			std::unique_lock lock(held.mutex);
+			held.changed.wait(lock, []() {
+				return held.joined == 1 + kWriters;
+			});
+			REQUIRE(IOCore::directory_sync_stats().syncs - before.syncs == 1);
+			held.released = true;
+		}
+		held.changed.notify_all();
+
+		leader.join();
+		for (auto& writer : writers) {
+			writer.join();
+		}
+		IOCore::durable_write_detail::set_sync_hook(nullptr);
+		auto after = IOCore::directory_sync_stats();
+
+		REQUIRE(
+		    after.requests - before.requests ==
+		    static_cast<std::uint64_t>(1 + kWriters)
+		);
+		// The leader's fsync, then exactly one for all the writers
+		REQUIRE(after.syncs - before.syncs == 2);
+		for (int writer = 0; writer < kWriters; ++writer) {
+			auto path =
+			    directory / ("file-" + std::to_string(writer) + ".toml");
+			REQUIRE(slurp(path) == std::to_string(writer));
+		}
+		REQUIRE(entry_count(directory) == 1 + kWriters);
+		fs::remove_all(directory);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,58 @@
+/* ElfSymbolizer.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/sys/elf_symbolizer.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <catch2/matchers/catch_matchers_string.hpp>
+
+namespace Match = Catch::Matchers;
+
+[[gnu::noinline]] void elf_symbolizer_probe_function()
+{
+	asm volatile("");
+}
+
+BEGIN_TEST_SUITE("IOCore::ElfSymbolizer")
+{
+	using IOCore::ElfSymbolizer;
+
+	TEST("IOCore::ElfSymbolizer - resolves functions in the test binary")
+	{
+		auto* address =
+		    reinterpret_cast<const void*>(&elf_symbolizer_probe_function);
+		auto info = ElfSymbolizer::global().resolve(address);
+
+		REQUIRE(info.has_value());
+		REQUIRE_THAT(
+		    info->function,
+		    Match::ContainsSubstring("elf_symbolizer_probe_function")
+		);
+		CHECK(info->offset == 0);
+	}
+
+	TEST("IOCore::ElfSymbolizer - addresses outside any module are unknown")
+	{
+		REQUIRE_FALSE(ElfSymbolizer::global().resolve(nullptr));
+	}
+
+	TEST("IOCore::ElfSymbolizer - a missing file yields no symbols")
+	{
+		ElfSymbolizer symbolizer;
+		auto info = symbolizer.resolveInFile("/nonexistent/binary", 0x1000);
+
+		REQUIRE(info.has_value());
+		CHECK(info->function.empty());
+		CHECK(info->file.empty());
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,121 @@
+/* Epoch.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/sys/epoch.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+BEGIN_TEST_SUITE("IOCore::RcuPointer")
+{
+	using IOCore::EpochGuard;
+	using IOCore::RcuPointer;
+
+	struct Tracked {
+		explicit Tracked(int value, std::atomic<int>& live)
+		    : value(value), live(live)
+		{
+			++live;
+		}
+		~Tracked() { --live; }
+
+		int value;
+		std::atomic<int>& live;
+	};
+
+	TEST("IOCore::RcuPointer - readers see the latest published value")
+	{
+		std::atomic<int> live{ 0 };
+		RcuPointer<Tracked> pointer(std::make_unique<Tracked>(1, live));
+
+		REQUIRE(pointer.read()->value == 1);
+		pointer.publish(std::make_unique<Tracked>(2, live));
+		REQUIRE(pointer.read()->value == 2);
+	}
+
+	TEST("IOCore::RcuPointer - old values outlive their readers")
+	{
+		std::atomic<int> live{ 0 };
+		{
+			RcuPointer<Tracked> pointer(
+			    std::make_unique<Tracked>(1, live)
+			);
+
+			{
+				auto reader = pointer.read();
+				pointer.publish(std::make_unique<Tracked>(2, live));
+
+				// The reader pins the first value
+				REQUIRE(reader->value == 1);
+				REQUIRE(pointer.collect() == 1);
+				REQUIRE(live == 2);
+			}
+
+			REQUIRE(pointer.collect() == 0);
+			REQUIRE(live == 1);
+		}
+		REQUIRE(live == 0);
+	}
+
+	TEST("IOCore::RcuPointer - nested guards keep the outer epoch")
+	{
+		std::atomic<int> live{ 0 };
+		RcuPointer<Tracked> pointer(std::make_unique<Tracked>(1, live));
+
+		EpochGuard outer;
+		{
+			auto reader = pointer.read();
+		}
+		pointer.publish(std::make_unique<Tracked>(2, live));
+
+		// The outer guard still protects whatever it may have loaded
+		REQUIRE(pointer.collect() == 1);
+	}
+
+	TEST("IOCore::RcuPointer - concurrent readers and a writer")
+	{
+		std::atomic<int> live{ 0 };
+		RcuPointer<Tracked> pointer(std::make_unique<Tracked>(0, live));
+		std::atomic<bool> stop{ false };
+		std::atomic<bool> went_backwards{ false };
+
+		std::vector<std::thread> readers;
+		for (int i = 0; i < 4; ++i) {
+			readers.emplace_back([&]() {
+				int last = 0;
+				while (!stop.load(std::memory_order_relaxed)) {
+					auto reader = pointer.read();
+					if (reader->value < last) {
+						went_backwards = true;
+					}
+					last = reader->value;
+				}
+			});
+		}
+
+		for (int value = 1; value <= 2000; ++value) {
+			pointer.publish(std::make_unique<Tracked>(value, live));
+		}
+		stop = true;
+		for (auto& reader : readers) {
+			reader.join();
+		}
+
+		REQUIRE_FALSE(went_backwards);
+		REQUIRE(pointer.collect() == 0);
+		REQUIRE(live == 1);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
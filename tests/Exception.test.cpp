@@ -17,6 +17,7 @@
 #include <exception>
 #include <iostream>
 #include <optional>
+#include <source_location>
 #include <stdexcept>
 
 namespace Match = Catch::Matchers;
@@ -127,6 +128,116 @@ BEGIN_TEST_SUITE("IOCore::Exception")
 		}
 	}
 
+	TEST("IOCore::Exception - stack trace is formatted lazily")
+	{
+		IOCore::Exception original("Lazy");
+
+		SECTION(" a: stacktrace() is available without calling what()")
+		{
+			REQUIRE_FALSE(original.stacktrace().empty());
+		}
+		SECTION(" b: copies produce the same message")
+		{
+			IOCore::Exception copy(original);
+			REQUIRE(std::string(copy.what()) == original.what());
+			REQUIRE(copy.stacktrace() == original.stacktrace());
+		}
+		SECTION(" c: copies share one payload")
+		{
+			IOCore::Exception copy(original);
+			REQUIRE(copy.what() == original.what());
+			STATIC_REQUIRE(sizeof(IOCore::Exception) <= 2 * sizeof(void*));
+		}
+	}
+
+	TEST("IOCore::Exception - stack capture policy is per exception type")
+	{
+		using IOCore::StackCapture;
+		struct QuietException : public IOCore::Exception {
+			QuietException()
+			    : Exception("quiet", capturePolicy<QuietException>())
+			{
+			}
+		};
+
+		IOCore::Exception::setStackCapture<QuietException>(
+		    StackCapture::None
+		);
+
+		SECTION(" a: None skips the trace for that type only")
+		{
+			QuietException quiet;
+			IOCore::Exception loud("loud");
+
+			REQUIRE(quiet.stacktrace().empty());
+			REQUIRE_THAT(quiet.what(), Match::ContainsSubstring("quiet"));
+			REQUIRE_FALSE(loud.stacktrace().empty());
+		}
+		SECTION(" b: RawAddresses prints unsymbolized frames")
+		{
+			IOCore::Exception::setStackCapture<QuietException>(
+			    StackCapture::RawAddresses
+			);
+			QuietException quiet;
+
+			REQUIRE_THAT(
+			    quiet.stacktrace(), Match::StartsWith("0x")
+			);
+		}
+		SECTION(" c: Sampled keeps one trace per N throws from a site")
+		{
+			constexpr unsigned kRate = 4;
+			IOCore::Exception::setStackCapture<QuietException>(
+			    StackCapture::Sampled, kRate
+			);
+
+			// Counters are process-wide, so another test may have
+			// advanced this one; any 2 * kRate consecutive throws
+			// still hold exactly two samples
+			unsigned traced = 0;
+			for (unsigned i = 0; i < kRate * 2; ++i) {
+				QuietException quiet;
+				traced += quiet.stacktrace().empty() ? 0 : 1;
+			}
+			REQUIRE(traced == 2);
+		}
+		SECTION(" d: Sampled counts throw sites, not constructors")
+		{
+			struct SitedException : public IOCore::Exception {
+				explicit SitedException(
+				    std::source_location site =
+				        std::source_location::current()
+				)
+				    : Exception(
+					  "sited", capturePolicy<SitedException>(), site
+				      )
+				{
+				}
+			};
+			IOCore::Exception::setStackCapture<SitedException>(
+			    StackCapture::Sampled, 2
+			);
+
+			// Alternating sites: one shared counter would sample
+			// every throw from one site and none from the other,
+			// whatever its starting value
+			unsigned traced_first = 0;
+			unsigned traced_second = 0;
+			for (int i = 0; i < 4; ++i) {
+				SitedException first;
+				SitedException second;
+				traced_first += first.stacktrace().empty() ? 0 : 1;
+				traced_second += second.stacktrace().empty() ? 0 : 1;
+			}
+			REQUIRE(traced_first == 2);
+			REQUIRE(traced_second == 2);
+		}
+
+		IOCore::Exception::setStackCapture<QuietException>(
+		    StackCapture::Symbolized
+		);
+	}
+
 	TEST("IOCore::Exception::what() - contains stacktrace with Catch2 "
 	     "runtime method names")
 	{
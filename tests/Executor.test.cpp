@@ -0,0 +1,137 @@
+/* Executor.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/Exception.hpp"
+#include "IOCore/Executor.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+BEGIN_TEST_SUITE("IOCore::Executor")
+{
+	using IOCore::Executor;
+
+	TEST("IOCore::Executor - runs every submitted task")
+	{
+		Executor executor(4);
+		std::atomic<int> counter{ 0 };
+
+		for (int index = 0; index < 10000; ++index) {
+			executor.submit([&counter]() { ++counter; });
+		}
+		executor.waitIdle();
+		REQUIRE(counter == 10000);
+
+		// Too large for the inline buffer
+		std::array<char, 256> payload{};
+		executor.submit([&counter, payload]() {
+			counter += static_cast<int>(payload.size());
+		});
+		executor.bulkSubmit(100, [&counter](std::size_t index) {
+			counter += static_cast<int>(index);
+		});
+		executor.waitIdle();
+		REQUIRE(counter == 10000 + 256 + 4950);
+	}
+
+	TEST("IOCore::Executor - parallelFor covers the range, also nested")
+	{
+		Executor executor(4);
+		std::vector<long> values(100000);
+
+		executor.parallelFor(0, values.size(), [&values](std::size_t i) {
+			values[i] = static_cast<long>(i);
+		});
+		REQUIRE(
+		    std::accumulate(values.begin(), values.end(), 0L) ==
+		    4999950000L
+		);
+
+		std::atomic<long> total{ 0 };
+		executor.parallelFor(0, 16, [&](std::size_t) {
+			executor.parallelFor(0, 100, [&total](std::size_t j) {
+				total += static_cast<long>(j);
+			});
+		});
+		REQUIRE(total == 16 * 4950);
+	}
+
+	TEST("IOCore::Executor - task exceptions reach the waiting thread")
+	{
+		Executor executor(2);
+
+		REQUIRE_THROWS_AS(
+		    executor.parallelFor(
+			0,
+			100,
+			[](std::size_t index) {
+				if (index == 42) {
+					throw IOCore::Exception("chunk failed");
+				}
+			}
+		    ),
+		    IOCore::Exception
+		);
+
+		executor.submit([]() { throw std::runtime_error("task failed"); });
+		REQUIRE_THROWS_AS(executor.waitIdle(), std::runtime_error);
+		REQUIRE_NOTHROW(executor.waitIdle());
+	}
+
+	TEST("IOCore::Executor - bounded waits and discarding queued work")
+	{
+		Executor executor(1);
+		std::atomic<bool> started{ false };
+		std::atomic<bool> release{ false };
+		std::atomic<int> counter{ 0 };
+
+		executor.submit([&]() {
+			started = true;
+			while (!release) {
+				std::this_thread::yield();
+			}
+		});
+		while (!started) {
+			std::this_thread::yield();
+		}
+		for (int index = 0; index < 10; ++index) {
+			executor.submit([&counter]() { ++counter; });
+		}
+
+		REQUIRE(executor.discardQueued() == 10);
+		REQUIRE_FALSE(executor.waitIdleFor(std::chrono::milliseconds{ 10 }));
+
+		release = true;
+		REQUIRE(executor.waitIdleFor(std::chrono::seconds{ 10 }));
+		REQUIRE(counter == 0);
+	}
+
+	TEST("IOCore::Executor - destruction finishes queued work")
+	{
+		std::atomic<int> counter{ 0 };
+		{
+			Executor executor(2);
+			for (int index = 0; index < 1000; ++index) {
+				executor.submit([&counter]() { ++counter; });
+			}
+		}
+		REQUIRE(counter == 1000);
+		REQUIRE(Executor::defaultThreadCount() >= 1);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
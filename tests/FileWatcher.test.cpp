@@ -0,0 +1,129 @@
+/* FileWatcher.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/Exception.hpp"
+#include "IOCore/FileWatcher.hpp"
+#include "IOCore/Reactor.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+namespace fs = std::filesystem;
+
+BEGIN_TEST_SUITE("IOCore::FileWatcher")
+{
+	using IOCore::FileWatcher;
+	using IOCore::Reactor;
+
+	auto make_directory() -> fs::path
+	{
+		auto directory = fs::temp_directory_path() /
+		                 ("iocore-watch-" + std::to_string(::getpid()));
+		fs::remove_all(directory);
+		fs::create_directories(directory);
+		return directory;
+	}
+
+	void write_file(const fs::path& path, const std::string& contents)
+	{
+		std::ofstream stream(path, std::ios::trunc);
+		stream << contents;
+	}
+
+	TEST("IOCore::FileWatcher - notices writes in place")
+	{
+		auto directory = make_directory();
+		auto target = directory / "config.toml";
+		write_file(target, "a = 1\n");
+
+		Reactor reactor;
+		int changes = 0;
+		FileWatcher watcher(reactor, target, [&]() { ++changes; });
+
+		write_file(target, "a = 2\n");
+		reactor.runOnce(1s);
+		REQUIRE(changes == 1);
+
+		fs::remove_all(directory);
+	}
+
+	TEST("IOCore::FileWatcher - follows atomic replacement")
+	{
+		auto directory = make_directory();
+		auto target = directory / "config.toml";
+		write_file(target, "a = 1\n");
+
+		Reactor reactor;
+		int changes = 0;
+		FileWatcher watcher(reactor, target, [&]() { ++changes; });
+
+		// Unrelated files in the same directory are ignored
+		write_file(directory / "other.toml", "b = 1\n");
+		reactor.runOnce(50ms);
+		REQUIRE(changes == 0);
+
+		for (int round = 1; round <= 2; ++round) {
+			write_file(directory / ".config.toml.tmp", "a = 3\n");
+			changes = 0;
+			reactor.runOnce(50ms);
+			fs::rename(directory / ".config.toml.tmp", target);
+			reactor.runOnce(1s);
+			REQUIRE(changes == 1);
+		}
+
+		fs::remove_all(directory);
+	}
+
+	TEST("IOCore::FileWatcher - re-watches a recreated directory")
+	{
+		auto directory = make_directory();
+		auto target = directory / "config.toml";
+		write_file(target, "a = 1\n");
+
+		Reactor reactor;
+		int changes = 0;
+		FileWatcher watcher(reactor, target, [&]() { ++changes; });
+
+		fs::remove_all(directory);
+		fs::create_directories(directory);
+		reactor.runOnce(1s);
+		REQUIRE(changes == 1);
+
+		changes = 0;
+		write_file(target, "a = 2\n");
+		reactor.runOnce(1s);
+		REQUIRE(changes == 1);
+
+		fs::remove_all(directory);
+	}
+
+	TEST("IOCore::FileWatcher - reports a directory that is gone")
+	{
+		auto directory = make_directory();
+		auto target = directory / "config.toml";
+
+		Reactor reactor;
+		int changes = 0;
+		FileWatcher watcher(reactor, target, [&]() { ++changes; });
+
+		fs::remove_all(directory);
+		REQUIRE_THROWS_AS(reactor.runOnce(1s), IOCore::Exception);
+		REQUIRE(changes == 0);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
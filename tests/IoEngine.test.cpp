@@ -0,0 +1,287 @@
+/* IoEngine.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/Exception.hpp"
+#include "IOCore/Executor.hpp"
+#include "IOCore/IoEngine.hpp"
+#include "IOCore/Reactor.hpp"
+#include "IOCore/Task.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+namespace fs = std::filesystem;
+
+BEGIN_TEST_SUITE("IOCore::IoEngine")
+{
+	using IOCore::Executor;
+	using IOCore::IoEngine;
+	using IOCore::IoResult;
+	using IOCore::sync_wait;
+
+	auto scratch_path(const char* name) -> fs::path
+	{
+		return fs::temp_directory_path() /
+		       (std::string("iocore-io-") + std::to_string(::getpid()) +
+		        "-" + name);
+	}
+
+	// Every backend this machine can run
+	auto make_engines(Executor& executor)
+	    -> std::vector<std::unique_ptr<IoEngine>>
+	{
+		std::vector<std::unique_ptr<IoEngine>> engines;
+		engines.push_back(
+		    IoEngine::create(executor, IoEngine::Backend::ThreadPool)
+		);
+		if (auto engine = IOCore::io_detail::create_io_uring_engine(64)) {
+			engines.push_back(std::move(engine));
+		}
+		return engines;
+	}
+
+	// Runs completions on a dedicated thread while \p body blocks
+	template<typename TBody>
+	void with_poller(IoEngine& engine, TBody&& body)
+	{
+		std::atomic<bool> stop{ false };
+		std::thread poller([&]() {
+			while (!stop.load()) {
+				engine.wait(5ms);
+			}
+		});
+		body();
+		stop = true;
+		poller.join();
+	}
+
+	TEST("IOCore::IoEngine - coroutines write and read whole files")
+	{
+		Executor executor(2);
+		auto path = scratch_path("roundtrip");
+
+		for (auto& engine : make_engines(executor)) {
+			std::string contents(100000, 'x');
+			contents.replace(0, 5, "hello");
+
+			with_poller(*engine, [&]() {
+				sync_wait(engine->writeFile(path, contents));
+				REQUIRE(sync_wait(engine->readFile(path)) == contents);
+				REQUIRE_THROWS_AS(
+				    sync_wait(engine->readFile(path.string() + ".missing")),
+				    IOCore::Exception
+				);
+			});
+			REQUIRE(engine->inFlight() == 0);
+		}
+		fs::remove(path);
+	}
+
+	TEST("IOCore::IoEngine - batches callbacks into one submission")
+	{
+		Executor executor(2);
+		auto path = scratch_path("batch");
+		{
+			std::ofstream stream(path, std::ios::binary);
+			for (int block = 0; block < 16; ++block) {
+				stream << std::string(512, static_cast<char>('a' + block));
+			}
+		}
+
+		for (auto& engine : make_engines(executor)) {
+			int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			REQUIRE(fd >= 0);
+
+			std::array<std::array<std::byte, 512>, 16> blocks{};
+			int completed = 0;
+			for (std::size_t block = 0; block < blocks.size(); ++block) {
+				engine->read(
+				    fd, blocks[block], block * 512, [&](IoResult result) {
+					    REQUIRE(result.value == 512);
+					    ++completed;
+				    }
+				);
+			}
+			REQUIRE(completed == 0);
+			REQUIRE(engine->submit() == 16);
+
+			while (completed < 16) {
+				engine->wait(1s);
+			}
+			for (std::size_t block = 0; block < blocks.size(); ++block) {
+				REQUIRE(
+				    blocks[block][511] ==
+				    static_cast<std::byte>('a' + block)
+				);
+			}
+			::close(fd);
+		}
+		fs::remove(path);
+	}
+
+	TEST("IOCore::IoEngine - registered buffers, files and stat")
+	{
+		Executor executor(2);
+		auto path = scratch_path("registered");
+		{
+			std::ofstream stream(path, std::ios::binary);
+			stream << "registered";
+		}
+
+		for (auto& engine : make_engines(executor)) {
+			int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			std::array<std::byte, 64> buffer{};
+			std::span<std::byte> region(buffer);
+
+			// A locked-memory limit may refuse buffers; reads still work
+			engine->registerBuffers({ &region, 1 });
+			REQUIRE(engine->registerFiles({ &fd, 1 }));
+
+			IoResult read_result{ -1 };
+			IOCore::FileStatus status;
+			IoResult stat_result{ -1 };
+			IoResult missing{ 0 };
+			engine->read(fd, region.subspan(0, 10), 0, [&](IoResult r) {
+				read_result = r;
+			});
+			engine->stat(path, status, [&](IoResult r) { stat_result = r; });
+			engine->open(
+			    path.string() + ".missing", O_RDONLY, 0, [&](IoResult r) {
+				    missing = r;
+			    }
+			);
+
+			engine->submit();
+			while (engine->inFlight() > 0) {
+				engine->wait(1s);
+			}
+
+			REQUIRE(read_result.value == 10);
+			REQUIRE(
+			    std::string(reinterpret_cast<char*>(buffer.data()), 10) ==
+			    "registered"
+			);
+			REQUIRE(stat_result.ok());
+			REQUIRE(status.size == 10);
+			REQUIRE(missing.error() == ENOENT);
+
+			engine->registerFiles({});
+			engine->registerBuffers({});
+			::close(fd);
+		}
+		fs::remove(path);
+	}
+
+	TEST("IOCore::IoEngine - work the executor discards completes cancelled")
+	{
+		Executor executor(1);
+		auto engine =
+		    IoEngine::create(executor, IoEngine::Backend::ThreadPool);
+
+		// Occupy the only worker so the engine's job stays queued
+		std::atomic<bool> blocking{ false };
+		std::atomic<bool> released{ false };
+		executor.submit([&]() {
+			blocking = true;
+			while (!released) {
+				std::this_thread::yield();
+			}
+		});
+		while (!blocking) {
+			std::this_thread::yield();
+		}
+
+		IoResult closed{ 0 };
+		engine->close(-1, [&](IoResult result) { closed = result; });
+		engine->submit();
+		REQUIRE(executor.discardQueued() == 1);
+		released = true;
+
+		REQUIRE(engine->wait(1s) == 1);
+		REQUIRE(closed.error() == ECANCELED);
+		REQUIRE(engine->inFlight() == 0);
+	}
+
+#if defined(__linux__)
+	TEST("IOCore::IoEngine - io_uring keeps completions within its ring")
+	{
+		// Four submission slots, and eight completion slots
+		auto engine = IOCore::io_detail::create_io_uring_engine(4);
+		if (engine == nullptr) {
+			return; // no io_uring on this machine
+		}
+		auto directory = fs::temp_directory_path();
+
+		std::array<IOCore::FileStatus, 12> statuses{};
+		int completed = 0;
+		for (auto& status : statuses) {
+			engine->stat(directory, status, [&](IoResult result) {
+				completed += result.ok() ? 1 : 0;
+			});
+			engine->submit();
+		}
+		// The last four wait in the submission ring, which is now full
+		REQUIRE(engine->inFlight() == 8);
+		IOCore::FileStatus extra;
+		REQUIRE_THROWS_AS(
+		    engine->stat(directory, extra, [](IoResult) {}),
+		    IOCore::Exception
+		);
+
+		while (engine->inFlight() > 0) {
+			engine->wait(1s);
+		}
+		REQUIRE(completed == 12);
+	}
+
+	TEST("IOCore::IoEngine - completions run on an attached reactor")
+	{
+		Executor executor(2);
+		auto path = scratch_path("reactor");
+
+		for (auto& engine : make_engines(executor)) {
+			IOCore::Reactor reactor;
+			engine->attach(reactor);
+
+			IoResult opened{ -1 };
+			engine->open(
+			    path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644,
+			    [&](IoResult result) { opened = result; }
+			);
+			engine->submit();
+			for (int round = 0; round < 100 && !opened.ok(); ++round) {
+				reactor.runOnce(100ms);
+			}
+
+			REQUIRE(opened.ok());
+			::close(static_cast<int>(opened.value));
+			engine->detach();
+		}
+		fs::remove(path);
+	}
+#endif
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
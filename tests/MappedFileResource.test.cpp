@@ -0,0 +1,81 @@
+/* MappedFileResource.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/MappedFileResource.hpp"
+#include "IOCore/types.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+c::string_constant kMappedFilePath = "/tmp/test_mapped_file.txt";
+
+BEGIN_TEST_SUITE("IOCore::MappedFileResource")
+{
+	using IOCore::MappedFileResource;
+
+	TEST("IOCore::MappedFileResource - exposes the file without copying")
+	{
+		{
+			std::ofstream stream(kMappedFilePath, std::ios::trunc);
+			stream << "key = \"value\"\n";
+		}
+		MappedFileResource file(kMappedFilePath);
+
+		REQUIRE(file.size() == 14);
+		REQUIRE(file.view() == "key = \"value\"\n");
+		REQUIRE(file.bytes().size() == file.size());
+		REQUIRE(file.bytes()[0] == std::byte{ 'k' });
+		REQUIRE(file.advise(MappedFileResource::Advice::Sequential));
+		REQUIRE(file.advise(MappedFileResource::Advice::WillNeed));
+
+		fs::remove(kMappedFilePath);
+	}
+
+	TEST("IOCore::MappedFileResource - maps empty files as empty views")
+	{
+		fs::remove(kMappedFilePath);
+		MappedFileResource file(kMappedFilePath);
+
+		REQUIRE(file.empty());
+		REQUIRE(file.view().empty());
+		REQUIRE_FALSE(file.remap());
+
+		fs::remove(kMappedFilePath);
+	}
+
+	TEST("IOCore::MappedFileResource - remaps when the file grows")
+	{
+		{
+			std::ofstream stream(kMappedFilePath, std::ios::trunc);
+			stream << "a = 1\n";
+		}
+		MappedFileResource file(kMappedFilePath);
+		REQUIRE_FALSE(file.remap());
+
+		{
+			std::ofstream stream(kMappedFilePath, std::ios::app);
+			stream << std::string(8192, '#') << "\nb = 2\n";
+		}
+		REQUIRE(file.remap());
+		REQUIRE(file.size() == 6 + 8192 + 7);
+		REQUIRE(file.view().substr(0, 6) == "a = 1\n");
+		REQUIRE(file.view().substr(file.size() - 6) == "b = 2\n");
+
+		fs::remove(kMappedFilePath);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,127 @@
+/* ParsedConfigCache.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/ParsedConfigCache.hpp"
+#include "IOCore/Exception.hpp"
+#include "IOCore/TomlConfigFile.hpp"
+#include "IOCore/types.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+c::string_constant kCachedFilePath = "/tmp/test_cached_config.toml";
+c::string_constant kOtherFilePath = "/tmp/test_cached_other.toml";
+c::string_constant kLinkPath = "/tmp/test_cached_link.toml";
+
+BEGIN_TEST_SUITE("IOCore::ParsedConfigCache")
+{
+	using IOCore::ParsedConfigCache;
+
+	void write_file(const char* path, const std::string& contents)
+	{
+		std::ofstream stream(path, std::ios::trunc);
+		stream << contents;
+	}
+
+	TEST("IOCore::ParsedConfigCache - reuses unchanged files")
+	{
+		write_file(kCachedFilePath, "port = 80\n");
+		ParsedConfigCache cache;
+
+		auto first = cache.load(kCachedFilePath);
+		auto second = cache.load(kCachedFilePath);
+		REQUIRE(first == second);
+		REQUIRE((*first)["port"].value_or(0) == 80);
+
+		auto stats = cache.stats();
+		REQUIRE(stats.hits == 1);
+		REQUIRE(stats.misses == 1);
+		REQUIRE(stats.entries == 1);
+
+		fs::remove(kCachedFilePath);
+	}
+
+	TEST("IOCore::ParsedConfigCache - notices same-size rewrites")
+	{
+		write_file(kCachedFilePath, "port = 80\n");
+		ParsedConfigCache cache;
+		auto before = cache.load(kCachedFilePath);
+
+		// Likely within the same mtime tick; the content hash catches it
+		write_file(kCachedFilePath, "port = 81\n");
+		auto after = cache.load(kCachedFilePath);
+
+		REQUIRE(before != after);
+		REQUIRE((*after)["port"].value_or(0) == 81);
+		REQUIRE((*before)["port"].value_or(0) == 80);
+
+		fs::remove(kCachedFilePath);
+	}
+
+	TEST("IOCore::ParsedConfigCache - symlinks share an entry")
+	{
+		write_file(kCachedFilePath, "port = 80\n");
+		fs::remove(kLinkPath);
+		fs::create_symlink(kCachedFilePath, kLinkPath);
+		ParsedConfigCache cache;
+
+		REQUIRE(cache.load(kCachedFilePath) == cache.load(kLinkPath));
+		REQUIRE(cache.stats().entries == 1);
+
+		fs::remove(kLinkPath);
+		fs::remove(kCachedFilePath);
+	}
+
+	TEST("IOCore::ParsedConfigCache - evicts the least recently used file")
+	{
+		write_file(kCachedFilePath, "a = 1\n");
+		write_file(kOtherFilePath, "b = 2\n");
+		ParsedConfigCache cache(1);
+
+		auto first = cache.load(kCachedFilePath);
+		cache.load(kOtherFilePath);
+		REQUIRE(cache.stats().evictions == 1);
+		REQUIRE(cache.load(kCachedFilePath) != first);
+		REQUIRE(cache.stats().misses == 3);
+
+		cache.setCapacity(0);
+		REQUIRE(cache.stats().entries == 0);
+
+		fs::remove(kOtherFilePath);
+		fs::remove(kCachedFilePath);
+	}
+
+	TEST("IOCore::ParsedConfigCache - missing files throw")
+	{
+		ParsedConfigCache cache;
+		REQUIRE_THROWS_AS(
+		    cache.load("/hades/tmp/dne/file.toml"), IOCore::Exception
+		);
+	}
+
+	TEST("IOCore::TomlConfigFile - shares parsed tables through the cache")
+	{
+		write_file(kCachedFilePath, "key = \"value\"\n");
+		IOCore::TomlConfigFile first(kCachedFilePath);
+		IOCore::TomlConfigFile second(kCachedFilePath);
+
+		REQUIRE(first.readShared() == second.readShared());
+		REQUIRE(second.read()["key"] == "value");
+
+		fs::remove(kCachedFilePath);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,172 @@
+/* Reactor.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/Reactor.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+BEGIN_TEST_SUITE("IOCore::Reactor")
+{
+	using IOCore::Reactor;
+
+	TEST("IOCore::Reactor - dispatches fd readiness")
+	{
+		Reactor reactor;
+		int pipe_fds[2];
+		REQUIRE(::pipe2(pipe_fds, O_NONBLOCK | O_CLOEXEC) == 0);
+
+		std::size_t bytes = 0;
+		reactor.watchFd(
+		    pipe_fds[0], Reactor::Readable, [&](std::uint64_t events) {
+			    REQUIRE((events & Reactor::Readable) != 0);
+			    char buffer[16];
+			    ssize_t count = 0;
+			    while ((count = ::read(pipe_fds[0], buffer, 16)) > 0) {
+				    bytes += static_cast<std::size_t>(count);
+			    }
+		    }
+		);
+
+		REQUIRE(::write(pipe_fds[1], "hello", 5) == 5);
+		REQUIRE(reactor.runOnce(1s) == 1);
+		REQUIRE(bytes == 5);
+
+		::close(pipe_fds[0]);
+		::close(pipe_fds[1]);
+	}
+
+	TEST("IOCore::Reactor - timers repeat until removed")
+	{
+		Reactor reactor;
+		std::uint64_t ticks = 0;
+		Reactor::SourceId timer = 0;
+
+		timer = reactor.addTimer(1ms, 1ms, [&](std::uint64_t count) {
+			ticks += count;
+			if (ticks >= 3) {
+				reactor.remove(timer);
+				reactor.stop(0);
+			}
+		});
+		REQUIRE(reactor.run() == 0);
+		REQUIRE(ticks >= 3);
+	}
+
+	TEST("IOCore::Reactor - notifiers and stop() work across threads")
+	{
+		Reactor reactor;
+		Reactor::Notifier notifier;
+		std::uint64_t notifications = 0;
+
+		reactor.addNotifier(
+		    [&](std::uint64_t count) {
+			    notifications += count;
+			    if (notifications >= 3) {
+				    reactor.stop(42);
+			    }
+		    },
+		    &notifier
+		);
+
+		std::thread producer([&notifier]() {
+			for (int index = 0; index < 3; ++index) {
+				notifier.notify();
+			}
+		});
+		REQUIRE(reactor.run() == 42);
+		producer.join();
+		REQUIRE(notifications == 3);
+	}
+
+	TEST("IOCore::Reactor - delivers signals through signalfd")
+	{
+		Reactor reactor;
+		std::uint64_t received = 0;
+
+		auto source = reactor.addSignal(SIGUSR2, [&](std::uint64_t signal) {
+			received = signal;
+		});
+		// Only this thread blocks it; see addSignal()
+		REQUIRE(::pthread_kill(::pthread_self(), SIGUSR2) == 0);
+		REQUIRE(reactor.runOnce(1s) == 1);
+		REQUIRE(received == SIGUSR2);
+
+		reactor.remove(source);
+	}
+
+	TEST("IOCore::Reactor - remove() restores the signal mask it found")
+	{
+		auto blocked = [](int signal_number) {
+			sigset_t mask;
+			::pthread_sigmask(SIG_BLOCK, nullptr, &mask);
+			return sigismember(&mask, signal_number) == 1;
+		};
+		Reactor reactor;
+
+		SECTION(" a: a pending signal is consumed, then unblocked")
+		{
+			auto source =
+			    reactor.addSignal(SIGUSR2, [](std::uint64_t) {});
+			REQUIRE(blocked(SIGUSR2));
+
+			// Default action would end the test runner
+			REQUIRE(::pthread_kill(::pthread_self(), SIGUSR2) == 0);
+			reactor.remove(source);
+			REQUIRE_FALSE(blocked(SIGUSR2));
+		}
+		SECTION(" b: a signal the caller blocked stays blocked")
+		{
+			sigset_t signals;
+			sigemptyset(&signals);
+			sigaddset(&signals, SIGUSR1);
+			::pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+			reactor.remove(
+			    reactor.addSignal(SIGUSR1, [](std::uint64_t) {})
+			);
+			REQUIRE(blocked(SIGUSR1));
+			::pthread_sigmask(SIG_UNBLOCK, &signals, nullptr);
+		}
+	}
+
+	TEST("IOCore::Reactor - a throwing callback does not cut a batch short")
+	{
+		Reactor reactor;
+		Reactor::Notifier first;
+		Reactor::Notifier second;
+		int calls = 0;
+
+		auto throwing = [&calls](std::uint64_t) {
+			++calls;
+			throw std::runtime_error("callback failed");
+		};
+		reactor.addNotifier(throwing, &first);
+		reactor.addNotifier(throwing, &second);
+		first.notify();
+		second.notify();
+
+		REQUIRE_THROWS_AS(reactor.runOnce(1s), std::runtime_error);
+		REQUIRE(calls == 2);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
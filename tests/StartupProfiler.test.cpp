@@ -0,0 +1,98 @@
+/* StartupProfiler.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/FileResource.hpp"
+#include "IOCore/sys/startup_profiler.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+BEGIN_TEST_SUITE("IOCore::StartupProfiler")
+{
+	/// Restores the profiler's state when a test case ends
+	struct ScopedProfiling {
+		ScopedProfiling()
+		    : was_enabled(IOCore::startup_profiling_enabled())
+		{
+			IOCore::clear_startup_trace();
+			IOCore::enable_startup_profiling(true);
+		}
+		~ScopedProfiling()
+		{
+			IOCore::enable_startup_profiling(was_enabled);
+			IOCore::clear_startup_trace();
+		}
+		bool was_enabled;
+	};
+
+	TEST("IOCore::StartupPhase - records nothing while disabled")
+	{
+		ScopedProfiling profiling;
+		IOCore::enable_startup_profiling(false);
+		{
+			IOCore::StartupPhase phase("disabled phase");
+		}
+		auto json = IOCore::startup_trace_json();
+		REQUIRE(json.find("disabled phase") == std::string::npos);
+	}
+
+	TEST("IOCore::StartupPhase - emits Chrome trace complete events")
+	{
+		ScopedProfiling profiling;
+		{
+			IOCore::StartupPhase outer("outer");
+			IOCore::StartupPhase inner("inner", "quote \" and \\ slash");
+		}
+		auto json = IOCore::startup_trace_json();
+
+		REQUIRE(json.starts_with("{\"displayTimeUnit\":\"ms\""));
+		REQUIRE(json.find("\"name\":\"outer\"") != std::string::npos);
+		REQUIRE(json.find("\"name\":\"inner\"") != std::string::npos);
+		REQUIRE(json.find("\"ph\":\"X\"") != std::string::npos);
+		REQUIRE(
+		    json.find("\"detail\":\"quote \\\" and \\\\ slash\"") !=
+		    std::string::npos
+		);
+	}
+
+	TEST("IOCore::StartupPhase - instruments FileResource creation")
+	{
+		ScopedProfiling profiling;
+		auto directory = std::filesystem::temp_directory_path() /
+		                 "iocore_profiler_test";
+		std::filesystem::remove_all(directory);
+
+		IOCore::FileResource file(
+		    directory / "file.txt", IOCore::CreateDirs::Enabled
+		);
+
+		auto trace_path = directory / "trace.json";
+		IOCore::write_startup_trace(trace_path);
+		std::ifstream stream(trace_path);
+		std::stringstream contents;
+		contents << stream.rdbuf();
+
+		REQUIRE(
+		    contents.str().find("FileResource::FileResource") !=
+		    std::string::npos
+		);
+		REQUIRE(
+		    contents.str().find("FileResource create_directories") !=
+		    std::string::npos
+		);
+		std::filesystem::remove_all(directory);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,156 @@
+/* Subsystems.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/Executor.hpp"
+#include "IOCore/Subsystems.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+BEGIN_TEST_SUITE("IOCore::SubsystemGraph")
+{
+	using IOCore::Executor;
+	using IOCore::SubsystemException;
+	using IOCore::SubsystemGraph;
+
+	TEST("IOCore::SubsystemGraph - respects dependency order")
+	{
+		Executor executor(4);
+		SubsystemGraph graph;
+		std::mutex mutex;
+		std::vector<std::string> order;
+		auto record = [&](const char* name) {
+			return [&, name]() {
+				std::lock_guard lock(mutex);
+				order.emplace_back(name);
+			};
+		};
+
+		// Registered out of order on purpose
+		graph.add("server", { "config", "cache", "pool" }, record("server"));
+		graph.add("cache", { "config" }, record("cache"));
+		graph.add("config", {}, record("config"));
+		graph.add("pool", {}, record("pool"));
+		graph.initialize(executor);
+
+		auto position = [&](const std::string& name) {
+			return std::find(order.begin(), order.end(), name) -
+			       order.begin();
+		};
+		REQUIRE(order.size() == 4);
+		REQUIRE(position("config") < position("cache"));
+		REQUIRE(position("cache") < position("server"));
+		REQUIRE(position("pool") < position("server"));
+
+		auto timings = graph.timings();
+		REQUIRE(timings.size() == 4);
+		REQUIRE(timings[0].name == "server");
+		REQUIRE(timings[0].ran);
+	}
+
+	TEST("IOCore::SubsystemGraph - runs independent subsystems concurrently")
+	{
+		Executor executor(4);
+		SubsystemGraph graph;
+		std::atomic<int> running{ 0 };
+		std::atomic<int> peak{ 0 };
+
+		for (int index = 0; index < 4; ++index) {
+			graph.add("leaf" + std::to_string(index), {}, [&]() {
+				auto now = ++running;
+				auto seen = peak.load();
+				while (now > seen &&
+				       !peak.compare_exchange_weak(seen, now)) {
+				}
+				std::this_thread::sleep_for(20ms);
+				--running;
+			});
+		}
+		graph.initialize(executor);
+		REQUIRE(peak > 1);
+	}
+
+	TEST("IOCore::SubsystemGraph - rejects unknown dependencies and cycles")
+	{
+		Executor executor(1);
+		{
+			SubsystemGraph graph;
+			graph.add("a", { "missing" }, []() {});
+			REQUIRE_THROWS_AS(graph.initialize(executor), SubsystemException);
+		}
+		{
+			SubsystemGraph graph;
+			bool ran = false;
+			graph.add("root", {}, [&ran]() { ran = true; });
+			graph.add("a", { "root", "c" }, []() {});
+			graph.add("b", { "a" }, []() {});
+			graph.add("c", { "b" }, []() {});
+			try {
+				graph.initialize(executor);
+				FAIL("cycle not detected");
+			} catch (const SubsystemException& error) {
+				std::string message = error.what();
+				REQUIRE(message.find("a -> c -> b -> a") !=
+				        std::string::npos);
+			}
+			REQUIRE_FALSE(ran); // nothing runs when the graph is invalid
+		}
+		{
+			SubsystemGraph graph;
+			graph.add("a", {}, []() {});
+			REQUIRE_THROWS_AS(
+			    graph.add("a", {}, []() {}), SubsystemException
+			);
+		}
+	}
+
+	TEST("IOCore::SubsystemGraph - failures skip dependents only")
+	{
+		Executor executor(2);
+		SubsystemGraph graph;
+		std::atomic<bool> dependent_ran{ false };
+		std::atomic<bool> independent_ran{ false };
+
+		graph.add("broken", {}, []() {
+			throw std::runtime_error("disk on fire");
+		});
+		graph.add("needs-broken", { "broken" }, [&]() {
+			dependent_ran = true;
+		});
+		graph.add("independent", {}, [&]() { independent_ran = true; });
+
+		try {
+			graph.initialize(executor);
+			FAIL("failure not reported");
+		} catch (const SubsystemException& error) {
+			REQUIRE(error.subsystem == "broken");
+			REQUIRE(std::string(error.what()).find("disk on fire") !=
+			        std::string::npos);
+			REQUIRE_THROWS_AS(
+			    std::rethrow_exception(error.inner), std::runtime_error
+			);
+		}
+		REQUIRE_FALSE(dependent_ran);
+		REQUIRE(independent_ran);
+		REQUIRE_FALSE(graph.timings()[1].ran);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,64 @@
+/* SymbolCache.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/sys/debuginfo.hpp"
+#include "IOCore/sys/symbol_cache.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <string>
+
+using IOCore::SymbolCache;
+
+BEGIN_TEST_SUITE("IOCore::SymbolCache")
+{
+	int sample_a = 0;
+	int sample_b = 0;
+
+	TEST("IOCore::SymbolCache - lookup after insert is a hit")
+	{
+		SymbolCache cache;
+
+		REQUIRE(cache.lookup(&sample_a) == nullptr);
+		cache.insert(&sample_a, "frame a");
+
+		REQUIRE(std::string(cache.lookup(&sample_a)) == "frame a");
+		REQUIRE(cache.lookup(&sample_b) == nullptr);
+
+		auto stats = cache.getStats();
+		CHECK(stats.hits == 1);
+		CHECK(stats.misses == 2);
+		CHECK(stats.entries == 1);
+	}
+
+	TEST("IOCore::SymbolCache - clear() drops entries and counters")
+	{
+		SymbolCache cache;
+		cache.insert(&sample_a, "frame a");
+		cache.clear();
+
+		REQUIRE(cache.lookup(&sample_a) == nullptr);
+		CHECK(cache.getStats().entries == 0);
+	}
+
+	TEST("IOCore::SymbolCache - repeated stack traces hit the global cache")
+	{
+		auto frames = IOCore::capture_stackframes();
+		IOCore::symbolize_stacktrace(frames);
+
+		auto before = SymbolCache::global().getStats();
+		IOCore::symbolize_stacktrace(frames);
+		auto after = SymbolCache::global().getStats();
+
+		REQUIRE(after.hits - before.hits == frames.count);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
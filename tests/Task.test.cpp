@@ -0,0 +1,180 @@
+/* Task.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/Executor.hpp"
+#include "IOCore/FileResource.hpp"
+#include "IOCore/Scheduler.hpp"
+#include "IOCore/Task.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+auto answer() -> IOCore::Task<int>
+{
+	co_return 42;
+}
+
+auto add_one(int depth) -> IOCore::Task<int>
+{
+	if (depth == 0) {
+		co_return 0;
+	}
+	co_return 1 + co_await add_one(depth - 1);
+}
+
+auto fail() -> IOCore::Task<void>
+{
+	throw std::runtime_error("task failed");
+	co_return;
+}
+
+auto count_synchronously(int iterations) -> IOCore::Task<int>
+{
+	int total = 0;
+	for (int index = 0; index < iterations; ++index) {
+		total += co_await answer();
+	}
+	co_return total;
+}
+} // namespace
+
+BEGIN_TEST_SUITE("IOCore::Task")
+{
+	using IOCore::Executor;
+	using IOCore::Scheduler;
+	using IOCore::sync_wait;
+	using IOCore::Task;
+
+	TEST("IOCore::Task - returns values and propagates exceptions")
+	{
+		REQUIRE(sync_wait(answer()) == 42);
+		REQUIRE(sync_wait(add_one(64)) == 64);
+		REQUIRE_THROWS_AS(sync_wait(fail()), std::runtime_error);
+	}
+
+	TEST("IOCore::Task - awaits tasks that complete synchronously")
+	{
+		REQUIRE(sync_wait(count_synchronously(10000)) == 420000);
+	}
+
+	TEST("IOCore::Task - coroutine frames are recycled")
+	{
+		REQUIRE(sync_wait(answer()) == 42);
+		auto before = IOCore::frame_allocator_stats();
+		for (int index = 0; index < 100; ++index) {
+			REQUIRE(sync_wait(add_one(4)) == 4);
+		}
+		auto after = IOCore::frame_allocator_stats();
+		REQUIRE(after.fresh == before.fresh);
+		REQUIRE(after.recycled > before.recycled);
+	}
+
+	TEST("IOCore::Scheduler - schedule() resumes on a pool worker")
+	{
+		Executor executor(2);
+		Scheduler scheduler(executor);
+
+		auto caller = std::this_thread::get_id();
+		auto body = [&]() -> Task<std::thread::id> {
+			co_await scheduler.schedule();
+			co_return std::this_thread::get_id();
+		};
+		REQUIRE(sync_wait(body()) != caller);
+	}
+
+	TEST("IOCore::Scheduler - spawned failures surface in waitIdle()")
+	{
+		Executor executor(2);
+		Scheduler scheduler(executor);
+
+		scheduler.spawn(fail());
+		REQUIRE_THROWS_AS(executor.waitIdle(), std::runtime_error);
+	}
+
+	TEST("IOCore::Scheduler - reads and writes FileResources")
+	{
+		Executor executor(2);
+		Scheduler scheduler(executor);
+		auto path = std::filesystem::temp_directory_path() /
+		            "iocore_task_test.txt";
+		IOCore::FileResource file(path);
+
+		sync_wait(scheduler.writeFile(file, "coroutine contents"));
+		REQUIRE(sync_wait(scheduler.readFile(file)) ==
+		        "coroutine contents");
+		std::filesystem::remove(path);
+	}
+
+	TEST("IOCore::Scheduler - loop awaitables need a reactor")
+	{
+		Executor executor(1);
+		Scheduler scheduler(executor);
+		REQUIRE_THROWS_AS(
+		    (void)scheduler.sleepFor(1ms), IOCore::Exception
+		);
+	}
+
+#if defined(__linux__)
+	TEST("IOCore::Scheduler - sleepFor() resumes on the loop thread")
+	{
+		Executor executor(2);
+		IOCore::Reactor reactor;
+		Scheduler scheduler(executor, &reactor);
+
+		auto loop_thread = std::this_thread::get_id();
+		bool on_loop = false;
+		auto body = [&]() -> Task<void> {
+			auto start = std::chrono::steady_clock::now();
+			co_await scheduler.sleepFor(5ms);
+			on_loop = std::this_thread::get_id() == loop_thread;
+			REQUIRE(std::chrono::steady_clock::now() - start >= 5ms);
+			reactor.stop(7);
+		};
+		scheduler.spawn(body());
+		REQUIRE(reactor.run() == 7);
+		REQUIRE(on_loop);
+		executor.waitIdle();
+	}
+
+	TEST("IOCore::Scheduler - concurrent sleeps wake in deadline order")
+	{
+		Executor executor(2);
+		IOCore::Reactor reactor;
+		Scheduler scheduler(executor, &reactor);
+
+		std::vector<int> woken;
+		auto body = [&](std::chrono::milliseconds delay, int id)
+		    -> Task<void> {
+			co_await scheduler.sleepFor(delay);
+			woken.push_back(id);
+			if (woken.size() == 3) {
+				reactor.stop(0);
+			}
+		};
+		scheduler.spawn(body(30ms, 3));
+		scheduler.spawn(body(5ms, 1));
+		scheduler.spawn(body(15ms, 2));
+		REQUIRE(reactor.run() == 0);
+		REQUIRE(woken == std::vector<int>{ 1, 2, 3 });
+		executor.waitIdle();
+	}
+#endif
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
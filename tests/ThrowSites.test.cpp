@@ -0,0 +1,94 @@
+/* ThrowSites.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/Exception.hpp"
+#include "IOCore/sys/throw_sites.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <catch2/matchers/catch_matchers_string.hpp>
+
+#include <sstream>
+
+namespace Match = Catch::Matchers;
+using IOCore::ThrowSiteRegistry;
+
+BEGIN_TEST_SUITE("IOCore::ThrowSiteRegistry")
+{
+	auto make_frames = [](std::uintptr_t seed) {
+		IOCore::StackFrames frames;
+		frames.addresses[0] = reinterpret_cast<void*>(seed);
+		frames.addresses[1] = reinterpret_cast<void*>(seed + 1);
+		frames.count = 2;
+		return frames;
+	};
+
+	TEST("IOCore::ThrowSiteRegistry - identical stacks share one site")
+	{
+		ThrowSiteRegistry registry;
+		auto* first = registry.record(make_frames(0x1000));
+		auto* second = registry.record(make_frames(0x1000));
+		auto* other = registry.record(make_frames(0x2000));
+
+		REQUIRE(first == second);
+		REQUIRE(first != other);
+
+		auto stats = registry.snapshot();
+		REQUIRE(stats.size() == 2);
+		CHECK(stats[0].count == 2);
+		CHECK(stats[1].count == 1);
+		CHECK(stats[0].first_seen <= stats[0].last_seen);
+	}
+
+	TEST("IOCore::ThrowSiteRegistry - the first published trace wins")
+	{
+		ThrowSiteRegistry registry;
+		auto* site = registry.record(make_frames(0x1000));
+
+		REQUIRE(site->stackTrace() == nullptr);
+		auto* winner = site->publishStackTrace("first");
+		auto* loser = site->publishStackTrace("second");
+
+		REQUIRE(winner == loser);
+		REQUIRE(*site->stackTrace() == "first");
+	}
+
+	TEST("IOCore::ThrowSiteRegistry - dump() lists counts and traces")
+	{
+		ThrowSiteRegistry registry;
+		registry.record(make_frames(0x1000))->publishStackTrace("trace\n");
+
+		std::stringstream output;
+		registry.dump(output);
+
+		REQUIRE_THAT(output.str(), Match::ContainsSubstring("1 throws"));
+		REQUIRE_THAT(output.str(), Match::ContainsSubstring("trace"));
+	}
+
+	TEST("IOCore::ThrowSiteRegistry - repeated throws reuse the trace")
+	{
+		std::string traces[2];
+		for (auto& trace : traces) {
+			IOCore::Exception error("counted");
+			trace = error.stacktrace();
+		}
+		REQUIRE(traces[0] == traces[1]);
+
+		bool found = false;
+		for (const auto& site : ThrowSiteRegistry::global().snapshot()) {
+			if (site.stack_trace == traces[0] && site.count >= 2) {
+				found = true;
+			}
+		}
+		REQUIRE(found);
+	}
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,170 @@
+/* TimerWheel.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/TimerWheel.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+BEGIN_TEST_SUITE("IOCore::TimerWheel")
+{
+	using IOCore::Timer;
+	using IOCore::TimerWheel;
+	const auto kStart = TimerWheel::Clock::time_point{} + 1h;
+
+	TEST("IOCore::TimerWheel - fires at the deadline, not before")
+	{
+		TimerWheel wheel(1ms, kStart);
+		Timer timer;
+		wheel.schedule(timer, 10ms);
+		REQUIRE(timer.armed());
+		REQUIRE(wheel.size() == 1);
+
+		std::size_t fired = 0;
+		auto count = [&fired](Timer&) { ++fired; };
+		REQUIRE(wheel.advance(kStart + 9ms, count) == 0);
+		REQUIRE(wheel.advance(kStart + 10ms, count) == 1);
+		REQUIRE(fired == 1);
+		REQUIRE_FALSE(timer.armed());
+		REQUIRE(wheel.size() == 0);
+	}
+
+	TEST("IOCore::TimerWheel - cancelled and destroyed timers never fire")
+	{
+		TimerWheel wheel(1ms, kStart);
+		Timer kept;
+		Timer cancelled;
+		wheel.schedule(kept, 5ms);
+		wheel.schedule(cancelled, 5ms);
+		{
+			Timer destroyed;
+			wheel.schedule(destroyed, 5ms);
+		}
+		wheel.cancel(cancelled);
+		REQUIRE(wheel.size() == 1);
+
+		std::vector<Timer*> fired;
+		wheel.advance(kStart + 1s, [&](Timer& timer) {
+			fired.push_back(&timer);
+		});
+		REQUIRE(fired == std::vector<Timer*>{ &kept });
+	}
+
+	TEST("IOCore::TimerWheel - cascades distant deadlines in order")
+	{
+		TimerWheel wheel(1ms, kStart);
+		const std::vector<std::chrono::milliseconds> kDelays = {
+			1ms, 255ms, 256ms, 300ms, 65537ms, 20000000ms,
+			// beyond the four levels, so parked in the overflow list
+			std::chrono::milliseconds{ std::int64_t{ 1 } << 33 },
+		};
+		std::vector<Timer> timers(kDelays.size());
+		for (std::size_t index = 0; index < kDelays.size(); ++index) {
+			wheel.schedule(timers[index], kDelays[index]);
+		}
+
+		for (std::size_t index = 0; index < kDelays.size(); ++index) {
+			auto deadline = kStart + kDelays[index];
+			REQUIRE(wheel.nextDeadline().value() <= deadline);
+
+			std::vector<Timer*> fired;
+			auto collect = [&fired](Timer& timer) {
+				fired.push_back(&timer);
+			};
+			wheel.advance(deadline - 1ms, collect);
+			REQUIRE(fired.empty());
+			wheel.advance(deadline, collect);
+			REQUIRE(fired == std::vector<Timer*>{ &timers[index] });
+		}
+		REQUIRE_FALSE(wheel.nextDeadline().has_value());
+	}
+
+	TEST("IOCore::TimerWheel - expiries are delivered as one batch")
+	{
+		TimerWheel wheel(1ms, kStart);
+		std::vector<Timer> timers(1000);
+		for (auto& timer : timers) {
+			wheel.schedule(timer, 7ms);
+		}
+
+		// Re-arming from the visitor lands in a later batch
+		std::size_t rearmed = 0;
+		auto rearm = [&](Timer& timer) {
+			if (rearmed++ < 10) {
+				wheel.schedule(timer, 1ms);
+			}
+		};
+		REQUIRE(wheel.advance(kStart + 7ms, rearm) == 1000);
+		REQUIRE(wheel.size() == 10);
+		REQUIRE(wheel.advance(kStart + 8ms, [](Timer&) {}) == 10);
+	}
+
+	TEST("IOCore::TimerWheel - matches a reference model")
+	{
+		TimerWheel wheel(1ms, kStart);
+		std::mt19937_64 random(1234);
+		std::uniform_int_distribution<std::int64_t> delay(0, 1 << 20);
+		std::uniform_int_distribution<std::int64_t> step(1, 1 << 12);
+
+		constexpr std::size_t kCount = 10000;
+		std::vector<Timer> timers(kCount);
+		std::vector<std::int64_t> deadlines(kCount);
+		for (std::size_t index = 0; index < kCount; ++index) {
+			deadlines[index] = delay(random);
+			wheel.schedule(
+			    timers[index], std::chrono::milliseconds{ deadlines[index] }
+			);
+		}
+
+		std::int64_t previous = 0;
+		std::size_t fired = 0;
+		while (wheel.size() > 0) {
+			auto now = previous + step(random);
+			wheel.advance(kStart + std::chrono::milliseconds{ now }, [&](Timer& timer) {
+				auto index = static_cast<std::size_t>(&timer - timers.data());
+				// Zero delays round up to the next tick
+				auto deadline = std::max<std::int64_t>(deadlines[index], 1);
+				REQUIRE(deadline <= now);
+				REQUIRE(deadline > previous);
+				++fired;
+			});
+			previous = now;
+		}
+		REQUIRE(fired == kCount);
+	}
+
+#if defined(__linux__)
+	TEST("IOCore::TimerWheel - runs from a reactor's timerfd")
+	{
+		static IOCore::Reactor* loop = nullptr;
+		IOCore::Reactor reactor;
+		loop = &reactor;
+
+		TimerWheel wheel(1ms);
+		wheel.attach(reactor);
+
+		Timer timer([](Timer&) { loop->stop(3); });
+		auto start = TimerWheel::Clock::now();
+		wheel.schedule(timer, 5ms);
+		REQUIRE(reactor.run() == 3);
+		REQUIRE(TimerWheel::Clock::now() - start >= 5ms);
+		wheel.detach();
+	}
+#endif
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,149 @@
+/* WatchedTomlConfigFile.test.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "IOCore/WatchedTomlConfigFile.hpp"
+#include "IOCore/Exception.hpp"
+#include "IOCore/Reactor.hpp"
+#include "IOCore/types.hpp"
+
+#include "test-utils/common.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace std::chrono_literals;
+namespace fs = std::filesystem;
+
+c::string_constant kWatchedFilePath = "/tmp/test_watched_config.toml";
+
+BEGIN_TEST_SUITE("IOCore::WatchedTomlConfigFile")
+{
+	using IOCore::WatchedTomlConfigFile;
+
+	void write_config(const std::string& contents)
+	{
+		std::ofstream stream(kWatchedFilePath, std::ios::trunc);
+		stream << contents;
+	}
+
+	TEST("IOCore::WatchedTomlConfigFile - snapshots survive reloads")
+	{
+		write_config("port = 80\n");
+		WatchedTomlConfigFile config(kWatchedFilePath);
+		REQUIRE(config.generation() == 1);
+
+		auto before = config.snapshot();
+		write_config("port = 8080\n");
+		config.reload();
+
+		REQUIRE(config.generation() == 2);
+		REQUIRE((*before)["port"].value_or(0) == 80);
+		REQUIRE((*config.snapshot())["port"].value_or(0) == 8080);
+
+		fs::remove(kWatchedFilePath);
+	}
+
+	TEST("IOCore::WatchedTomlConfigFile - a bad file keeps the last table")
+	{
+		write_config("port = 80\n");
+		WatchedTomlConfigFile config(kWatchedFilePath);
+
+		write_config("port = = 81\n");
+		REQUIRE_THROWS_AS(config.reload(), IOCore::Exception);
+		REQUIRE(config.generation() == 1);
+		REQUIRE((*config.snapshot())["port"].value_or(0) == 80);
+
+		fs::remove(kWatchedFilePath);
+	}
+
+	TEST("IOCore::WatchedTomlConfigFile - notifies subscribers of changes")
+	{
+		write_config("port = 80\nhost = \"a\"\n");
+		WatchedTomlConfigFile config(kWatchedFilePath);
+
+		int port_changes = 0;
+		int host_changes = 0;
+		config.subscribe("port", [&](const IOCore::TomlTable& table) {
+			REQUIRE(table["port"].value_or(0) == 81);
+			++port_changes;
+		});
+		config.subscribe("host", [&](const IOCore::TomlTable&) {
+			++host_changes;
+		});
+
+		write_config("port = 81\nhost = \"a\"\n");
+		config.reload();
+		config.reload();
+
+		REQUIRE(port_changes == 1);
+		REQUIRE(host_changes == 0);
+
+		fs::remove(kWatchedFilePath);
+	}
+
+#ifdef __linux__
+	TEST("IOCore::WatchedTomlConfigFile - reloads when the file is replaced")
+	{
+		write_config("port = 80\n");
+		WatchedTomlConfigFile config(kWatchedFilePath);
+		IOCore::Reactor reactor;
+		config.watch(reactor);
+
+		auto temporary = std::string(kWatchedFilePath) + ".tmp";
+		{
+			std::ofstream stream(temporary, std::ios::trunc);
+			stream << "port = 9090\n";
+		}
+		fs::rename(temporary, kWatchedFilePath);
+		reactor.runOnce(1s);
+
+		REQUIRE(config.generation() == 2);
+		REQUIRE(config.failedReloads() == 0);
+		REQUIRE((*config.snapshot())["port"].value_or(0) == 9090);
+
+		fs::remove(kWatchedFilePath);
+	}
+
+	TEST("IOCore::WatchedTomlConfigFile - subscriber errors are not parse "
+	     "failures")
+	{
+		write_config("port = 80\n");
+		WatchedTomlConfigFile config(kWatchedFilePath);
+		IOCore::Reactor reactor;
+		config.watch(reactor);
+
+		int later_calls = 0;
+		config.subscribe("port", [](const IOCore::TomlTable&) {
+			throw std::runtime_error("subscriber failed");
+		});
+		config.subscribe("port", [&](const IOCore::TomlTable&) {
+			++later_calls;
+		});
+
+		write_config("port = 81\n");
+		REQUIRE_THROWS_AS(reactor.runOnce(1s), std::runtime_error);
+		REQUIRE(config.generation() == 2);
+		REQUIRE(config.failedReloads() == 0);
+		REQUIRE(later_calls == 1);
+
+		write_config("port = = 82\n");
+		reactor.runOnce(1s);
+		REQUIRE(config.failedReloads() == 1);
+		REQUIRE(config.generation() == 2);
+
+		fs::remove(kWatchedFilePath);
+	}
+#endif
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=4 sts=0 sw=4 noexpandtab ft=cpp.doxygen :
@@ -0,0 +1,180 @@
+/* iocore-symbolize.cpp
+ * Copyright © 2024 Saul D. Beniquez
+ * License: Mozilla Public License v. 2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v.2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+// Turns the raw reports written by IOCore::install_crash_handler() into
+// readable stack traces, using the ELF files named in the report's memory
+// map (or copies of them found in --binary-dir).
+//
+// usage: iocore-symbolize [--binary-dir DIR] [REPORT]
+
+#include "IOCore/sys/elf_symbolizer.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+struct MappedRegion {
+	std::uintptr_t start = 0;
+	std::uintptr_t end = 0;
+	std::uint64_t offset = 0;
+	std::string path;
+};
+
+struct CrashReport {
+	std::vector<std::string> header;
+	std::vector<std::uintptr_t> frames;
+	std::vector<MappedRegion> regions;
+};
+
+auto parse_region(const std::string& line) -> std::optional<MappedRegion>
+{
+	// start-end perms offset dev inode [path]
+	std::istringstream fields(line);
+	std::string range, perms, offset, device, inode, path;
+	fields >> range >> perms >> offset >> device >> inode;
+	std::getline(fields >> std::ws, path);
+
+	auto dash = range.find('-');
+	if (dash == std::string::npos || path.empty() || path[0] != '/') {
+		return std::nullopt;
+	}
+
+	MappedRegion region;
+	region.start = std::stoull(range.substr(0, dash), nullptr, 16);
+	region.end = std::stoull(range.substr(dash + 1), nullptr, 16);
+	region.offset = std::stoull(offset, nullptr, 16);
+	region.path = path;
+	return region;
+}
+
+auto read_report(std::istream& input) -> CrashReport
+{
+	CrashReport report;
+	std::string line;
+	bool in_maps = false;
+
+	while (std::getline(input, line)) {
+		if (line == "end") {
+			break;
+		}
+		if (line == "maps") {
+			in_maps = true;
+		} else if (in_maps) {
+			if (auto region = parse_region(line)) {
+				report.regions.push_back(*region);
+			}
+		} else if (line.starts_with("frame ")) {
+			report.frames.push_back(
+			    std::stoull(line.substr(6), nullptr, 16)
+			);
+		} else {
+			report.header.push_back(line);
+		}
+	}
+	return report;
+}
+
+auto locate_binary(const std::string& path, const fs::path& binary_dir)
+    -> fs::path
+{
+	if (!binary_dir.empty()) {
+		auto candidate = binary_dir / fs::path(path).filename();
+		if (fs::exists(candidate)) {
+			return candidate;
+		}
+	}
+	return path;
+}
+
+void print_frame(
+    std::size_t index,
+    std::uintptr_t address,
+    const CrashReport& report,
+    const fs::path& binary_dir
+)
+{
+	static IOCore::ElfSymbolizer symbolizer;
+	std::cout << '#' << index << " 0x" << std::hex << address << std::dec;
+
+	for (const auto& region : report.regions) {
+		if (address < region.start || address >= region.end) {
+			continue;
+		}
+
+		// Frame 0 is the interrupted instruction itself; the others
+		// are return addresses, which point past the call
+		auto lookup = (index == 0) ? address : address - 1;
+		auto file_offset = lookup - region.start + region.offset;
+		auto binary = locate_binary(region.path, binary_dir);
+		auto info = symbolizer.resolveFileOffset(binary, file_offset);
+
+		if (info && !info->function.empty()) {
+			std::cout << ' ' << info->function;
+		}
+		if (info && !info->file.empty()) {
+			std::cout << " at " << info->file << ':' << info->line;
+		}
+		std::cout << " (" << region.path << ')';
+		break;
+	}
+	std::cout << '\n';
+}
+} // namespace
+
+auto main(int argc, const char* argv[]) -> int
+{
+	fs::path binary_dir;
+	fs::path report_path;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string_view argument(argv[i]);
+		if (argument == "--binary-dir" && i + 1 < argc) {
+			binary_dir = argv[++i];
+		} else if (argument == "-h" || argument == "--help") {
+			std::cout << "usage: " << argv[0]
+				  << " [--binary-dir DIR] [REPORT]\n";
+			return EXIT_SUCCESS;
+		} else {
+			report_path = argument;
+		}
+	}
+
+	CrashReport report;
+	if (report_path.empty()) {
+		report = read_report(std::cin);
+	} else {
+		std::ifstream input(report_path);
+		if (!input.is_open()) {
+			std::cerr << "cannot open " << report_path << '\n';
+			return EXIT_FAILURE;
+		}
+		report = read_report(input);
+	}
+
+	for (const auto& line : report.header) {
+		std::cout << line << '\n';
+	}
+	for (std::size_t i = 0; i < report.frames.size(); ++i) {
+		print_frame(i, report.frames[i], report, binary_dir);
+	}
+	return EXIT_SUCCESS;
+}
+
+// clang-format off
+// vim: set foldmethod=syntax textwidth=80 ts=8 sts=0 sw=8  noexpandtab ft=cpp.doxygen :